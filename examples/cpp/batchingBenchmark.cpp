@@ -0,0 +1,75 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string indexPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2.jffbin";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste1";
+    const int nClients = 16;
+    const int searchesPerClient = 20;
+    euclidean d;
+
+    // 1. Map the gallery and read the latents once
+    BinaryReader reader(indexPath);
+    Gallery<feature> gallery;
+    gallery.load(reader);
+    shift_searcher searcher(d);
+    searcher.load(reader, gallery.resolver());
+
+    std::vector<std::vector<std::vector<float>>> latents;
+    for (const auto &entry : fs::directory_iterator(queryPath))
+    {
+        if (entry.path().extension() != ".tpt")
+            continue;
+        std::vector<std::vector<float>> rows;
+        for (const auto &f : loadFile<feature>(entry.path().string(), false))
+        {
+            rows.push_back(f.values);
+        }
+        latents.push_back(rows);
+    }
+    std::cout << "Gallery: " << gallery.size() << " individuals, " << latents.size() << " latents\n\n";
+
+    // 2. Same load under several batch limits: (rows, wait in microseconds)
+    std::vector<std::pair<size_t, int>> settings = {{1, 0}, {256, 500}, {1024, 2000}, {4096, 5000}};
+    for (const auto &setting : settings)
+    {
+        ServerOptions options;
+        options.workers = 4;
+        options.maxBatchRows = setting.first;
+        options.maxBatchWait = std::chrono::microseconds(setting.second);
+        SearchServer<shift_searcher> server(gallery, searcher, options);
+        uint16_t port = server.listenTcp(0);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> clients;
+        for (int c = 0; c < nClients; ++c)
+        {
+            clients.emplace_back([&, c]()
+                                 {
+                SearchClient client = SearchClient::connectTcp("127.0.0.1", port);
+                for (int i = 0; i < searchesPerClient; ++i)
+                {
+                    client.search(latents[(c * searchesPerClient + i) % latents.size()], 5, 10);
+                } });
+        }
+        for (auto &client : clients)
+        {
+            client.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+
+        Protocol::ServerStats stats = server.stats();
+        std::cout << "Batch " << setting.first << " rows / " << setting.second << " us: "
+                  << stats.searches * 1000.0 / duration.count() << " searches/s, "
+                  << stats.meanBatchRequests << " searches per batch, "
+                  << "p50 " << stats.interactive.p50LatencyMs << " ms, p99 " << stats.interactive.p99LatencyMs << " ms\n";
+        server.stop();
+    }
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string queryDir = "C:/Users/jfcmp/Documentos/Griaule/data/teste1";
+    const size_t k = 5;
+
+    // 1. Build the fine searcher and the summaries of the cascade
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true);
+    Gallery<feature> built(galleryIndividuals, gallery);
+
+    euclidean d;
+    shift_searcher searcher(d);
+    CascadeSearcher<feature, euclidean> cascade(d, searcher);
+    built.attach(searcher);
+    built.attach(cascade);
+
+    // 2. Full scan: its best Individual is taken as the mate of each query
+    std::vector<std::vector<feature>> queries;
+    std::vector<uint32_t> mates;
+    double fullTime = 0;
+    for (const auto &entry : fs::directory_iterator(queryDir))
+    {
+        if (entry.path().extension() != ".tpt" && entry.path().extension() != ".npy")
+            continue;
+        queries.push_back(loadFile<feature>(entry.path().string(), false));
+
+        auto start = std::chrono::high_resolution_clock::now();
+        NNResult<feature> result;
+        for (auto &q : queries.back())
+        {
+            result.add(searcher.knn(q, k));
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        fullTime += std::chrono::duration<double>(end - start).count() * 1000;
+
+        auto best = result.pickBest(1);
+        mates.push_back(best.empty() ? 0 : best[0].first);
+    }
+    std::cout << "Full scan: " << fullTime / queries.size() << " ms/query\n\n";
+
+    // 3. Cascade: recall of the mate in the shortlist and at rank 1, for several M
+    for (size_t m : {5, 10, 25, 50, 100, 200})
+    {
+        cascade.setShortlistSize(m);
+        size_t inShortlist = 0, atRankOne = 0;
+        double time = 0;
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<uint32_t> shortlist = cascade.shortlist(queries[i]);
+            NNResult<feature> result(searcher.knnAmong(queries[i], k, shortlist));
+            auto end = std::chrono::high_resolution_clock::now();
+            time += std::chrono::duration<double>(end - start).count() * 1000;
+
+            inShortlist += std::find(shortlist.begin(), shortlist.end(), mates[i]) != shortlist.end();
+            auto best = result.pickBest(1);
+            atRankOne += !best.empty() && best[0].first == mates[i];
+        }
+        std::cout << "M = " << m << ": shortlist recall " << double(inShortlist) / queries.size()
+                  << ", rank-1 recall " << double(atRankOne) / queries.size()
+                  << ", " << time / queries.size() << " ms/query\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string checkpointPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2_selfjoin.ckpt";
+
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true);
+
+    // Progress is saved every 5 minutes; running again after an interruption resumes from it
+    SelfJoin<feature> join(10);
+    join.setCheckpoint(checkpointPath, 300.0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto candidates = join.run(gallery);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+
+    std::unordered_map<uint32_t, std::string> names;
+    for (const auto &individual : galleryIndividuals)
+    {
+        names[individual->getId()] = individual->name;
+    }
+
+    std::cout << "Duplicate candidates:\n";
+    for (size_t i = 0; i < 20 && i < candidates.size(); ++i)
+    {
+        std::cout << names[candidates[i].first] << " - " << names[candidates[i].second] << ": " << candidates[i].score << "\n";
+    }
+    std::cout << "Time: " << duration.count() << " ms\n";
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste1/b101-9_l.tpt";
+
+    // 1. Load the gallery keeping the minutia geometry (row = feature ID)
+    Minutiae galleryGeometry;
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true, false, nullptr, nullptr, &galleryGeometry);
+    shift_searcher::shiftAll(gallery);
+
+    euclidean d;
+    shift_searcher searcher(d);
+    searcher.addAll(gallery);
+
+    // 2. Search, keeping the neighbor lists as descriptor matches
+    Minutiae queryGeometry;
+    std::vector<feature> queries = loadFile<feature>(queryPath, true, &queryGeometry);
+    std::vector<NNList<feature>> lists;
+    NNResult<feature> nnResult;
+    for (auto &q : queries)
+    {
+        lists.push_back(searcher.knn(q, 5));
+        nnResult.add(lists.back());
+    }
+
+    // 3. Verify the 100 best candidates
+    auto candidates = nnResult.pickBest(100);
+    GeometricVerifier verifier(galleryGeometry);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t unverified = 0;
+    auto reranked = verifier.rerank(lists, queryGeometry, candidates, &unverified);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+
+    std::unordered_map<uint32_t, std::string> names;
+    for (const auto &individual : galleryIndividuals)
+    {
+        names[individual->getId()] = individual->name;
+    }
+
+    std::cout << "Votes: ";
+    for (size_t i = 0; i < 5 && i < candidates.size(); ++i)
+    {
+        std::cout << names[candidates[i].first] << " " << candidates[i].second << "; ";
+    }
+    std::cout << "\nGeometry: ";
+    for (size_t i = 0; i < 5 && i < reranked.size(); ++i)
+    {
+        std::cout << names[reranked[i].first] << " " << reranked[i].second << "; ";
+    }
+    std::cout << "\nRe-ranking time: " << duration.count() << " ms (" << unverified << " matches without geometry)\n";
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste1/b101-9_l.tpt";
+    std::string indexPath = "C:/Users/jfcmp/Documentos/Griaule/data/triplets.bin";
+
+    Minutiae galleryGeometry;
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true, false, nullptr, nullptr, &galleryGeometry);
+    Minutiae queryGeometry;
+    loadFile<feature>(queryPath, true, &queryGeometry);
+
+    std::cout << "Transparent huge pages " << (HugePages::transparentEnabled() ? "enabled" : "disabled")
+              << ", free reserved pages: " << HugePages::freePages(HugePages::size2MB) << " x 2 MB, "
+              << HugePages::freePages(HugePages::size1GB) << " x 1 GB\n";
+
+    const char *names[] = {"4 KB pages", "transparent", "explicit 2 MB", "explicit 1 GB"};
+    for (HugePageMode mode : {HugePageMode::Off, HugePageMode::Transparent, HugePageMode::Explicit2MB, HugePageMode::Explicit1GB})
+    {
+        // 1. kNN graph: the local join reads the packed rows of random nodes
+        NNDescent builder(20);
+        builder.setHugePages(mode);
+        auto start = std::chrono::high_resolution_clock::now();
+        KnnGraph graph = builder.build(gallery);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+        std::cout << names[static_cast<int>(mode)] << ": graph in " << duration.count() << " ms, "
+                  << builder.hugePageUsage().total() / 1024 << " KiB on huge pages\n";
+
+        // 2. Triplet table mapped from disk: every vote probes random slots
+        TripletIndex triplets;
+        triplets.setHugePages(mode);
+        triplets.load(indexPath);
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < 100; ++i)
+        {
+            triplets.candidates(queryGeometry, 100);
+        }
+        end = std::chrono::high_resolution_clock::now();
+        duration = (end - start) * 1000; // milliseconds
+        std::cout << names[static_cast<int>(mode)] << ": 100 triplet votes in " << duration.count() << " ms, "
+                  << triplets.hugePageUsage().total() / 1024 << " KiB on huge pages\n";
+    }
+
+    // 3. Everything the process holds in huge pages
+    HugePageUsage usage = HugePages::usage();
+    std::cout << "Process: " << usage.anonymousBytes / 1024 << " KiB transparent, " << usage.fileBytes / 1024
+              << " KiB file, " << usage.explicitBytes / 1024 << " KiB reserved\n";
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string graphPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2_knn20.jffbin";
+
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true);
+
+    // 1. Build the 20-NN graph of all gallery minutiae
+    NNDescent builder(20);
+    auto start = std::chrono::high_resolution_clock::now();
+    KnnGraph graph = builder.build(gallery);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+    std::cout << "Graph of " << graph.size() << " nodes in " << builder.iterations() << " iterations, " << duration.count() << " ms\n";
+
+    // 2. Recall against the exact neighbors of 500 sampled minutiae
+    std::cout << "Recall@20: " << builder.recall(graph, 500) << "\n";
+
+    // 3. Save it; node i is gallery[i], graph.nodeIds keeps the feature IDs
+    graph.save(graphPath);
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste1/b101-9_l.tpt";
+
+    // 1. Load and index the gallery
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true);
+    shift_searcher::shiftAll(gallery);
+
+    euclidean d;
+    shift_searcher searcher(d);
+    searcher.addAll(gallery);
+
+    // 2. Load the latent, keeping the minutia quality scores
+    Minutiae minutiae;
+    std::vector<feature> queries = loadFile<feature>(queryPath, true, &minutiae);
+    std::vector<size_t> order = minutiae.orderByScore();
+
+    std::unordered_map<uint32_t, std::string> names;
+    for (const auto &individual : galleryIndividuals)
+    {
+        names[individual->getId()] = individual->name;
+    }
+
+    // 3. Search best minutiae first, stopping once the leader is decided
+    for (bool guaranteed : {true, false})
+    {
+        IncrementalIdentifier<FrequencyVote> identifier(5, 1, guaranteed);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        IdentificationResult result = identifier.identify(searcher, queries, order);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+
+        std::cout << (guaranteed ? "Guaranteed" : "Heuristic") << ": searched " << result.processed << "/" << result.total << " minutiae in " << duration.count() << " ms\n";
+        for (auto &b : result.best)
+        {
+            std::cout << "Best: " << b.first << " (" << names[b.first] << ") " << b.second << "\n";
+        }
+        std::cout << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef SequentialSearcher<feature, euclidean> searcher_t;
+
+int main()
+{
+    // Gallery saved by Gallery::save, see saveLoadIndex.cpp
+    std::string indexPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2.jffbin";
+    std::string queryDir = "C:/Users/jfcmp/Documentos/Griaule/data/query";
+    euclidean d;
+
+    // 1. Plan for 512 MB from the file header alone
+    MemoryBudget budget(size_t(512) << 20);
+    budget.k = 5;
+    MemoryPlan plan = budget.plan(GalleryShape::ofFile(indexPath));
+    std::cout << "Plan: " << plan.describe() << "\n";
+
+    MemoryReport report;
+    report.begin("queries");
+    std::vector<feature> queries;
+    for (const auto &entry : fs::directory_iterator(queryDir))
+    {
+        for (const auto &f : loadFile<feature>(entry.path().string(), false))
+        {
+            queries.push_back(f);
+        }
+    }
+
+    // 2. Run the plan, one batch of plan.batchRows query minutiae at a time
+    auto searchBatches = [&](auto &searcher)
+    {
+        for (size_t begin = 0; begin < queries.size(); begin += plan.batchRows)
+        {
+            std::vector<feature> batch(queries.begin() + begin, queries.begin() + std::min(queries.size(), begin + plan.batchRows));
+            searcher.knnBatch(batch, budget.k);
+        }
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (plan.storage == StorageMode::Streamed)
+    {
+        report.begin("load individuals and resident features");
+        BinaryReader reader(indexPath, false);
+        Gallery<feature> gallery;
+        gallery.load(reader, "gallery", false);
+        StreamingSearcher<feature, euclidean> searcher(indexPath, d, gallery.resolver(), "gallery.features", plan.streaming);
+
+        report.begin("search");
+        searchBatches(searcher);
+    }
+    else
+    {
+        // A Reduced plan would project the gallery and queries with a PCA of plan.dimension, see pcaReduction.cpp
+        report.begin("load gallery");
+        Gallery<feature> gallery;
+        searcher_t searcher(d);
+        {
+            BinaryReader reader(indexPath);
+            gallery.load(reader);
+            gallery.attach(searcher);
+        }
+
+        report.begin("search");
+        searchBatches(searcher);
+    }
+    report.end();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+
+    // 3. Actual usage per stage against the budget
+    std::cout << queries.size() << " query minutiae in " << duration.count() << " ms\n";
+    report.print(std::cout, budget.bytes);
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef NumaSearcher<feature, euclidean> numa_searcher;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/query/1_1.tpt";
+    euclidean d;
+
+    // 1. Loaded by this thread only, so the whole gallery sits on one node
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true);
+    std::vector<feature> queries = loadFile<feature>(queryPath, false);
+
+    NumaTopology topology = NumaTopology::detect();
+    std::cout << topology.size() << " NUMA node(s):";
+    for (const auto &node : topology.getNodes())
+    {
+        std::cout << " node " << node.id << " (" << node.cpus.size() << " CPUs)";
+    }
+    std::cout << "\n";
+
+    // 2. Scan bandwidth per node before and after placement: one query minutia at a time, so the scan is memory bound
+    const char *names[] = {"unplaced (before)", "partitioned", "replicated"};
+    for (NumaPlacement placement : {NumaPlacement::Unplaced, NumaPlacement::Partitioned})
+    {
+        NumaOptions options;
+        options.placement = placement;
+        numa_searcher searcher(gallery, d, topology, options);
+
+        std::vector<double> bandwidth(topology.size(), 0.0);
+        for (auto &query : queries)
+        {
+            searcher.knn(query, 5);
+            std::vector<NumaNodeStats> nodeStats = searcher.lastStats();
+            for (size_t n = 0; n < topology.size(); ++n)
+            {
+                bandwidth[n] += nodeStats[n].gbPerSecond / static_cast<double>(queries.size());
+            }
+        }
+
+        std::cout << names[static_cast<int>(placement)] << ":";
+        for (size_t n = 0; n < topology.size(); ++n)
+        {
+            std::cout << " node " << topology.getNodes()[n].id << " " << bandwidth[n] << " GB/s";
+        }
+        std::cout << "\n";
+    }
+
+    // 3. Whole query in one batch (replication splits the query minutiae between nodes)
+    for (NumaPlacement placement : {NumaPlacement::Unplaced, NumaPlacement::Partitioned, NumaPlacement::Replicated})
+    {
+        NumaOptions options;
+        options.placement = placement;
+        numa_searcher searcher(gallery, d, topology, options);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        searcher.knnBatch(queries, 5);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+        std::cout << names[static_cast<int>(placement)] << " batch: " << duration.count() << " ms\n";
+    }
+
+    return 0;
+}
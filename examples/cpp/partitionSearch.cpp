@@ -0,0 +1,39 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste1/b101-9_l.tpt";
+
+    // 1. Load the gallery grouped by finger position ("_d07" in the file names)
+    std::vector<std::string> partitionNames;
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true, false, fingerPosition, &partitionNames);
+    Gallery<feature> built(galleryIndividuals, gallery, partitionNames);
+
+    euclidean d;
+    shift_searcher searcher(d);
+    built.attach(searcher);
+
+    // 2. Search only the fingers the latent may come from
+    Bitmap mask = built.partitionMask({"d07", "d08"});
+    SearchFilter filter = SearchFilter::inPartitions(mask);
+
+    std::vector<feature> queries = loadFile<feature>(queryPath, true);
+    NNResult<feature> nnResult;
+    for (auto &q : queries)
+    {
+        nnResult.add(searcher.knn(q, 5, filter));
+    }
+
+    for (auto &b : nnResult.pickBest(5))
+    {
+        std::cout << b.first << " (" << built.getIndividual(b.first)->name << ") " << b.second << "; ";
+    }
+    std::cout << "\n";
+
+    return 0;
+}
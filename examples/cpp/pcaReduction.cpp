@@ -0,0 +1,64 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste1/b101-9_l.tpt";
+    std::string indexPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2_pca32.jffbin";
+
+    // 1. Fit a 32-d PCA on the gallery and project it (Individual statistics are recomputed)
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    PCA pca(32);
+    pca.fit(gallery);
+    pca.projectAll(galleryIndividuals, gallery);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+    std::cout << "PCA " << pca.inputDimension() << " -> " << pca.outputDimension() << " keeps " << pca.explainedVariance() * 100
+              << "% of the variance (" << duration.count() << " ms)\n";
+
+    // 2. Save the reduced gallery with its transform, then restore both
+    {
+        Gallery<feature> built(galleryIndividuals, gallery);
+        BinaryWriter writer(indexPath);
+        built.save(writer);
+        pca.save(writer);
+        writer.close();
+    }
+
+    BinaryReader reader(indexPath);
+    Gallery<feature> reduced;
+    reduced.load(reader);
+    PCA loadedPca;
+    loadedPca.load(reader);
+
+    euclidean d;
+    shift_searcher searcher(d);
+    reduced.attach(searcher);
+
+    // 3. Queries go through the same transform
+    std::vector<feature> queries = loadFile<feature>(queryPath, true);
+    loadedPca.projectAll(queries);
+
+    NNResult<feature> nnResult;
+    start = std::chrono::high_resolution_clock::now();
+    for (auto &q : queries)
+    {
+        nnResult.add(searcher.knn(q, 5));
+    }
+    end = std::chrono::high_resolution_clock::now();
+    duration = (end - start) * 1000; // milliseconds
+
+    for (const auto &best : nnResult.pickBest(5))
+    {
+        std::cout << reduced.getIndividual(best.first)->name << " " << best.second << "\n";
+    }
+    std::cout << "Search time: " << duration.count() << " ms\n";
+
+    return 0;
+}
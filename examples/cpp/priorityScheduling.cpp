@@ -0,0 +1,87 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string indexPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2.jffbin";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste1";
+    euclidean d;
+
+    // 1. Map the gallery and read the latents once
+    BinaryReader reader(indexPath);
+    Gallery<feature> gallery;
+    gallery.load(reader);
+    shift_searcher searcher(d);
+    searcher.load(reader, gallery.resolver());
+
+    std::vector<std::vector<std::vector<float>>> latents;
+    for (const auto &entry : fs::directory_iterator(queryPath))
+    {
+        if (entry.path().extension() != ".tpt")
+            continue;
+        std::vector<std::vector<float>> rows;
+        for (const auto &f : loadFile<feature>(entry.path().string(), false))
+        {
+            rows.push_back(f.values);
+        }
+        latents.push_back(rows);
+    }
+
+    // 2. Bulk gets at most 20% of the workers while interactive searches wait
+    ServerOptions options;
+    options.workers = 4;
+    options.bulkShare = 0.2;
+    SearchServer<shift_searcher> server(gallery, searcher, options);
+    uint16_t port = server.listenTcp(0);
+
+    // 3. Two clients re-match every latent in bulk...
+    std::vector<std::thread> bulkClients;
+    for (int c = 0; c < 2; ++c)
+    {
+        bulkClients.emplace_back([&]()
+                                 {
+            SearchClient client = SearchClient::connectTcp("127.0.0.1", port);
+            for (const auto &latent : latents)
+            {
+                Protocol::SearchRequest request;
+                request.priority = Protocol::Priority::Bulk;
+                request.rows = static_cast<uint32_t>(latent.size());
+                request.dimension = static_cast<uint32_t>(latent[0].size());
+                for (const auto &row : latent)
+                {
+                    request.values.insert(request.values.end(), row.begin(), row.end());
+                }
+                client.search(request);
+            } });
+    }
+
+    // 4. ...while an examiner runs one-off searches
+    SearchClient examiner = SearchClient::connectTcp("127.0.0.1", port);
+    for (size_t i = 0; i < 20 && i < latents.size(); ++i)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<Protocol::Candidate> candidates = examiner.search(latents[i], 5, 1);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+        std::cout << "Interactive " << i << ": " << candidates[0].name << " in " << duration.count() << " ms\n";
+    }
+
+    for (auto &client : bulkClients)
+    {
+        client.join();
+    }
+
+    // 5. Per-class counters
+    Protocol::ServerStats stats = server.stats();
+    for (const auto &entry : {std::make_pair("Interactive", stats.interactive), std::make_pair("Bulk", stats.bulk)})
+    {
+        std::cout << entry.first << ": " << entry.second.searches << " searches, " << entry.second.busyMs << " ms busy, "
+                  << "p50 " << entry.second.p50LatencyMs << " ms, p99 " << entry.second.p99LatencyMs << " ms\n";
+    }
+    std::cout << "Bulk chunks: " << stats.bulkChunks << "\n";
+
+    return 0;
+}
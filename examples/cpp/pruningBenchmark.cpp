@@ -0,0 +1,79 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string queryDir = "C:/Users/jfcmp/Documentos/Griaule/data/teste1";
+    const size_t k = 5;
+
+    // 1. Build the searcher
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true);
+    shift_searcher::shiftAll(gallery);
+
+    euclidean d;
+    shift_searcher searcher(d);
+    searcher.addAll(gallery);
+
+    std::unordered_map<std::string, uint32_t> idByName;
+    for (const auto &individual : galleryIndividuals)
+    {
+        idByName[fs::path(individual->name).stem().string()] = individual->getId();
+    }
+
+    // 2. Load the latents with their minutia metadata; the mate of "x_l" is "x_t"
+    std::vector<std::vector<feature>> queries;
+    std::vector<Minutiae> queryMinutiae;
+    std::vector<uint32_t> mates;
+    for (const auto &entry : fs::directory_iterator(queryDir))
+    {
+        if (entry.path().extension() != ".tpt")
+            continue;
+        std::string stem = entry.path().stem().string();
+        if (stem.size() < 2 || stem.substr(stem.size() - 2) != "_l")
+            continue;
+        auto mate = idByName.find(stem.substr(0, stem.size() - 2) + "_t");
+        if (mate == idByName.end())
+            continue;
+
+        Minutiae minutiae;
+        queries.push_back(loadFile<feature>(entry.path().string(), false, &minutiae));
+        queryMinutiae.push_back(std::move(minutiae));
+        mates.push_back(mate->second);
+    }
+    std::cout << queries.size() << " latents with a mate in the gallery\n\n";
+
+    // 3. Throughput and rank-1 hit rate for several score thresholds and minutia caps
+    for (float minScore : {0.0f, 0.2f, 0.4f, 0.6f})
+    {
+        for (size_t maxCount : {size_t(1000), size_t(40), size_t(20), size_t(10)})
+        {
+            size_t hits = 0, searched = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < queries.size(); ++i)
+            {
+                std::vector<feature> selected = selectFeatures(queries[i], queryMinutiae[i].select(minScore, maxCount));
+                searched += selected.size();
+
+                NNResult<feature> result;
+                for (auto &q : selected)
+                {
+                    result.add(searcher.knn(q, k));
+                }
+                auto best = result.pickBest(1);
+                hits += !best.empty() && best[0].first == mates[i];
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            double seconds = std::chrono::duration<double>(end - start).count();
+
+            std::cout << "score >= " << minScore << ", top " << maxCount << ": "
+                      << double(searched) / queries.size() << " minutiae/latent, "
+                      << queries.size() / seconds << " latents/s, rank-1 " << double(hits) / queries.size() << "\n";
+        }
+    }
+
+    return 0;
+}
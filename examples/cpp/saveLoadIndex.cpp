@@ -0,0 +1,44 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string indexPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2.jffbin";
+    euclidean d;
+
+    // 1. Build once: load the raw files, shift and save gallery + searcher in one file
+    if (!fs::exists(indexPath))
+    {
+        auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true);
+        Gallery<feature> built(galleryIndividuals, gallery);
+
+        shift_searcher searcher(d);
+        built.attach(searcher);
+
+        BinaryWriter writer(indexPath);
+        built.save(writer);
+        searcher.save(writer);
+        writer.close();
+    }
+
+    // 2. Every restart: map the file, no parsing or shifting
+    auto start = std::chrono::high_resolution_clock::now();
+
+    BinaryReader reader(indexPath);
+    Gallery<feature> gallery;
+    gallery.load(reader);
+
+    shift_searcher searcher(d);
+    searcher.load(reader, gallery.resolver());
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+    std::cout << "Loaded " << gallery.size() << " individuals, " << searcher.size() << " features\n";
+    std::cout << "Time: " << duration.count() << " ms\n";
+
+    return 0;
+}
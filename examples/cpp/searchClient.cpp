@@ -0,0 +1,40 @@
+#include "jff.hpp"
+
+int main()
+{
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste1/b101-9_l.tpt";
+
+    // 1. Connect to a running searchServer
+    SearchClient client = SearchClient::connectTcp("127.0.0.1", 5050);
+    client.setTimeout(10000);
+    std::cout << "Server healthy: " << client.health() << "\n";
+
+    // 2. Send the latent as it is on disk; the server parses it
+    std::ifstream file(queryPath);
+    std::stringstream content;
+    content << file.rdbuf();
+
+    Protocol::SearchRequest request;
+    request.format = Protocol::QueryFormat::Tpt;
+    request.tpt = content.str();
+    request.k = 5;
+    request.nBest = 10;
+    request.method = Protocol::VoteMethod::Frequency;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<Protocol::Candidate> candidates = client.search(request);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+
+    std::cout << "Round trip: " << duration.count() << " ms\n";
+    for (const auto &candidate : candidates)
+    {
+        std::cout << "Best: " << candidate.id << " (" << candidate.name << ") " << candidate.score << "\n";
+    }
+
+    // 3. Server counters
+    Protocol::ServerStats stats = client.stats();
+    std::cout << "Server: " << stats.searches << " searches, " << stats.interactive.queueDepth << " queued, mean latency " << stats.interactive.meanLatencyMs << " ms\n";
+
+    return 0;
+}
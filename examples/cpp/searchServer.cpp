@@ -0,0 +1,45 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    // Gallery and searcher saved together, see saveLoadIndex.cpp
+    std::string indexPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2.jffbin";
+    euclidean d;
+
+    // 1. Map the gallery once for the lifetime of the server
+    auto start = std::chrono::high_resolution_clock::now();
+
+    BinaryReader reader(indexPath);
+    Gallery<feature> gallery;
+    gallery.load(reader);
+
+    shift_searcher searcher(d);
+    searcher.load(reader, gallery.resolver());
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+    std::cout << "Loaded " << gallery.size() << " individuals, " << searcher.size() << " features in " << duration.count() << " ms\n";
+
+    // 2. Serve on localhost TCP with 4 search workers
+    ServerOptions options;
+    options.workers = 4;
+    SearchServer<shift_searcher> server(gallery, searcher, options);
+    uint16_t port = server.listenTcp(5050);
+    std::cout << "Listening on 127.0.0.1:" << port << ", press Enter to stop\n";
+
+    std::cin.get();
+
+    // 3. Report and shut down
+    Protocol::ServerStats stats = server.stats();
+    std::cout << "Searches: " << stats.searches << ", errors: " << stats.errors << ", rejected: " << stats.rejected << "\n";
+    std::cout << "Interactive latency: p50 " << stats.interactive.p50LatencyMs << " ms, p99 " << stats.interactive.p99LatencyMs << " ms, max " << stats.interactive.maxLatencyMs << " ms\n";
+    std::cout << "Bulk latency: p50 " << stats.bulk.p50LatencyMs << " ms, p99 " << stats.bulk.p99LatencyMs << " ms, max " << stats.bulk.maxLatencyMs << " ms\n";
+    std::cout << "Throughput: " << stats.throughput << " searches/s, " << stats.meanBatchRequests << " searches per batch\n";
+    server.stop();
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/query/1_1.tpt";
+    std::string shardPrefix = "C:/Users/jfcmp/Documentos/Griaule/data/teste2.shard";
+    const size_t nShards = 3;
+    euclidean d;
+
+    // 1. Split the gallery and save every shard with its own searcher
+    auto [galleryIndividuals, galleryFeatures] = loadIndividuals(galleryPath, true);
+    Gallery<feature> gallery(galleryIndividuals, galleryFeatures);
+
+    std::vector<std::string> shardFiles;
+    auto shards = splitGallery(gallery, nShards);
+    for (size_t i = 0; i < shards.size(); ++i)
+    {
+        shift_searcher searcher(d);
+        shards[i]->attach(searcher);
+
+        shardFiles.push_back(shardPrefix + std::to_string(i) + ".jffbin");
+        BinaryWriter writer(shardFiles.back());
+        shards[i]->save(writer);
+        searcher.save(writer);
+        writer.close();
+        shards[i]->detach(searcher);
+        std::cout << "Shard " << i << ": " << shards[i]->size() << " individuals\n";
+    }
+
+    // 2. One server process per shard (before this process starts any thread)
+    ServerOptions options;
+    options.workers = 2;
+    LocalShardCluster cluster;
+    cluster.start<shift_searcher>(shardFiles, d, options);
+
+    // 3. Reference: the whole gallery in this process
+    shift_searcher searcher(d);
+    gallery.attach(searcher);
+    SearchServer<shift_searcher> single(gallery, searcher, options);
+
+    std::ifstream file(queryPath);
+    std::stringstream tpt;
+    tpt << file.rdbuf();
+
+    Protocol::SearchRequest request;
+    request.k = 5;
+    request.nBest = 10;
+    request.format = Protocol::QueryFormat::Tpt;
+    request.tpt = tpt.str();
+
+    // 4. Scatter the query to every shard and merge
+    ShardRouter router(cluster.endpoints(), std::chrono::milliseconds(2000));
+
+    auto start = std::chrono::high_resolution_clock::now();
+    ShardedResult result = router.search(request);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+
+    std::vector<Protocol::Candidate> reference = single.search(request);
+    bool same = reference.size() == result.candidates.size();
+    for (size_t i = 0; same && i < reference.size(); ++i)
+    {
+        same = reference[i].id == result.candidates[i].id;
+    }
+    std::cout << "Sharded search: " << duration.count() << " ms, same ranking as one node: " << (same ? "yes" : "no") << "\n";
+    for (const auto &candidate : result.candidates)
+    {
+        std::cout << "  " << candidate.name << " " << candidate.score << "\n";
+    }
+
+    // 5. A frozen shard times out: the result comes from the others and is flagged partial
+    cluster.pause(1);
+    result = router.search(request);
+    std::cout << "Shard 1 paused: partial " << result.partial << " (" << result.shards[1].error << ", " << result.shards[1].latencyMs << " ms)\n";
+    cluster.resume(1);
+
+    result = router.search(request);
+    std::cout << "Shard 1 resumed: partial " << result.partial << "\n";
+
+    cluster.stop();
+
+    return 0;
+}
@@ -42,14 +42,15 @@ int main()
 
     // std::cout << nnResult << "\n\n";
 
-    auto best = nnResult.pickBest(2, "frequency");
+    auto best = nnResult.pickBest(2);
     std::cout << "Best: ";
     for (auto &b : best){
         std::cout << b.first << " (" << galleryIndividuals[b.first-1]->name << ") " << b.second << "; ";
     }
     std::cout << "\n\n";
 
-    auto best2 = nnResult.pickBest(2, "distance");
+    NNResult<feature, DistanceVote> nnResultByDistance(results);
+    auto best2 = nnResultByDistance.pickBest(2);
     std::cout << "Best: ";
     for (auto &b : best2){
         std::cout << b.first << " (" << galleryIndividuals[b.first-1]->name << ") " << b.second << "; ";
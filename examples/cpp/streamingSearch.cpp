@@ -0,0 +1,45 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+
+int main()
+{
+    // Gallery saved by Gallery::save, see saveLoadIndex.cpp
+    std::string indexPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2.jffbin";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/query/1_1.tpt";
+    euclidean d;
+
+    // 1. Only the Individuals stay in memory; checksums are skipped so the features are not read
+    BinaryReader reader(indexPath, false);
+    Gallery<feature> gallery;
+    gallery.load(reader, "gallery", false);
+
+    auto query = loadFile<feature>(queryPath, false);
+
+    // 2. Stream the features with a single, double and triple buffer of 8 MB chunks
+    for (unsigned buffers : {1u, 2u, 3u})
+    {
+        StreamingOptions options;
+        options.chunkBytes = 8 << 20;
+        options.buffers = buffers;
+        StreamingSearcher<feature, euclidean> searcher(indexPath, d, gallery.resolver(), "gallery.features", options);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<NNList<feature>> lists = searcher.knnBatch(query, 5);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+
+        const StreamingStats &stats = searcher.lastStats();
+        std::cout << buffers << " buffers: " << duration.count() << " ms, " << stats.chunks << " chunks, read " << stats.readMs << " ms, search "
+                  << stats.searchMs << " ms, stalled " << stats.stallMs << " ms, buffers " << stats.peakBufferBytes / (1 << 20) << " MB\n";
+
+        NNResult<feature> result(lists);
+        for (const auto &best : result.pickBest(5))
+        {
+            std::cout << "  " << gallery.getIndividual(best.first)->name << " " << best.second << "\n";
+        }
+    }
+
+    return 0;
+}
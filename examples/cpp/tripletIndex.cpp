@@ -0,0 +1,67 @@
+#include "jff.hpp"
+
+typedef ParentedFeature feature;
+typedef EuclideanDistance<feature> euclidean;
+typedef ShiftSequentialSearcher<feature, euclidean> shift_searcher;
+
+int main()
+{
+    std::string galleryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste2";
+    std::string queryPath = "C:/Users/jfcmp/Documentos/Griaule/data/teste1/b101-9_l.tpt";
+    std::string indexPath = "C:/Users/jfcmp/Documentos/Griaule/data/triplets.bin";
+
+    // 1. Load the gallery keeping the minutia geometry (row = feature ID)
+    Minutiae galleryGeometry;
+    auto [galleryIndividuals, gallery] = loadIndividuals(galleryPath, true, false, nullptr, nullptr, &galleryGeometry);
+    shift_searcher::shiftAll(gallery);
+
+    euclidean d;
+    shift_searcher searcher(d);
+    searcher.addAll(gallery);
+
+    // 2. Build the triplet table on all threads, save it and map it back
+    auto start = std::chrono::high_resolution_clock::now();
+    TripletIndex built;
+    built.build(galleryIndividuals, galleryGeometry);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
+    std::cout << "Indexed " << built.size() << " triangles (" << built.memoryUsage() / 1024 << " KiB) in " << duration.count() << " ms\n";
+
+    built.save(indexPath);
+    TripletIndex triplets;
+    triplets.load(indexPath);
+
+    // 3. Descriptor votes and triplet votes, then both fused
+    Minutiae queryGeometry;
+    std::vector<feature> queries = loadFile<feature>(queryPath, true, &queryGeometry);
+    NNResult<feature> nnResult;
+    for (auto &q : queries)
+    {
+        nnResult.add(searcher.knn(q, 5));
+    }
+
+    auto descriptorVotes = nnResult.pickBest(100);
+    auto tripletVotes = triplets.candidates(queryGeometry, 100);
+    auto fused = fuseScores(descriptorVotes, tripletVotes);
+
+    std::unordered_map<uint32_t, std::string> names;
+    for (const auto &individual : galleryIndividuals)
+    {
+        names[individual->getId()] = individual->name;
+    }
+
+    auto print = [&](const char *label, const std::vector<std::pair<uint32_t, double>> &ranking)
+    {
+        std::cout << label;
+        for (size_t i = 0; i < 5 && i < ranking.size(); ++i)
+        {
+            std::cout << names[ranking[i].first] << " " << ranking[i].second << "; ";
+        }
+        std::cout << "\n";
+    };
+    print("Descriptors: ", descriptorVotes);
+    print("Triplets: ", tripletVotes);
+    print("Fused: ", fused);
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#ifndef EPOCH_MANAGER_HPP
+#define EPOCH_MANAGER_HPP
+
+#include <atomic>     // For std::atomic
+#include <vector>
+#include <functional> // For std::function
+#include <mutex>      // For std::mutex, std::lock_guard
+#include <thread>     // For std::this_thread
+#include <limits>     // For std::numeric_limits
+#include <cstdint>    // For uint64_t
+
+/**
+ * @brief Epoch-based reclamation for data published through atomic pointers.
+ *
+ * Readers pin the current epoch for the duration of a read (see Guard) without taking any lock.
+ * Writers unlink an object, hand its deleter to retire(), and the deleter only runs once every
+ * reader pinned at or before the unlink has left its critical section.
+ */
+class EpochManager
+{
+public:
+    static constexpr size_t maxSlots = 256; ///< Maximum number of simultaneous readers
+
+    /**
+     * @brief RAII pin of the current epoch. Everything loaded while it lives stays valid.
+     */
+    class Guard
+    {
+    public:
+        explicit Guard(EpochManager &manager) : manager(&manager), slot(manager.enter()) {}
+
+        Guard(Guard &&other) noexcept : manager(other.manager), slot(other.slot)
+        {
+            other.manager = nullptr;
+        }
+
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+        Guard &operator=(Guard &&) = delete;
+
+        ~Guard()
+        {
+            if (manager)
+                manager->exit(slot);
+        }
+
+    private:
+        EpochManager *manager;
+        size_t slot;
+    };
+
+    EpochManager() : globalEpoch(1) {}
+
+    /**
+     * @brief Runs every pending deleter. No reader may be active.
+     */
+    ~EpochManager()
+    {
+        for (auto &item : retired)
+        {
+            item.deleter();
+        }
+    }
+
+    EpochManager(const EpochManager &) = delete;
+    EpochManager &operator=(const EpochManager &) = delete;
+
+    /**
+     * @brief Returns the process-wide manager shared by searchers and galleries.
+     */
+    static EpochManager &global()
+    {
+        static EpochManager manager;
+        return manager;
+    }
+
+    /**
+     * @brief Pins the current epoch until the returned guard is destroyed.
+     */
+    Guard pin()
+    {
+        return Guard(*this);
+    }
+
+    /**
+     * @brief Defers a deleter until no reader can still hold what it frees.
+     *
+     * Must be called after the object was unlinked (e.g. after the atomic pointer swap).
+     *
+     * @param deleter The function releasing the object.
+     */
+    void retire(std::function<void()> deleter)
+    {
+        {
+            std::lock_guard<std::mutex> lock(retiredMutex);
+            retired.push_back({globalEpoch.fetch_add(1), std::move(deleter)});
+        }
+        reclaim();
+    }
+
+    /**
+     * @brief Runs the deleters whose objects can no longer be reached by any reader.
+     *
+     * @return size_t The number of deleters run.
+     */
+    size_t reclaim()
+    {
+        uint64_t minActive = std::numeric_limits<uint64_t>::max();
+        for (const auto &slot : slots)
+        {
+            uint64_t epoch = slot.epoch.load();
+            if (epoch != 0 && epoch < minActive)
+                minActive = epoch;
+        }
+
+        std::vector<Retired> ready;
+        {
+            std::lock_guard<std::mutex> lock(retiredMutex);
+            size_t kept = 0;
+            for (size_t i = 0; i < retired.size(); ++i)
+            {
+                if (retired[i].epoch < minActive)
+                    ready.push_back(std::move(retired[i]));
+                else
+                    retired[kept++] = std::move(retired[i]);
+            }
+            retired.resize(kept);
+        }
+
+        for (auto &item : ready)
+        {
+            item.deleter();
+        }
+        return ready.size();
+    }
+
+    /**
+     * @brief Returns the number of deleters waiting for readers to move on.
+     */
+    size_t pending() const
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        return retired.size();
+    }
+
+private:
+    struct Retired
+    {
+        uint64_t epoch;               ///< Epoch at which the object was unlinked
+        std::function<void()> deleter; ///< Releases the object
+    };
+
+    /// One reader slot per cache line, 0 when free
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    size_t enter()
+    {
+        size_t start = std::hash<std::thread::id>{}(std::this_thread::get_id()) % maxSlots;
+        while (true)
+        {
+            for (size_t i = 0; i < maxSlots; ++i)
+            {
+                size_t index = (start + i) % maxSlots;
+                uint64_t expected = 0;
+                if (slots[index].epoch.compare_exchange_strong(expected, globalEpoch.load()))
+                    return index;
+            }
+            std::this_thread::yield(); // More than maxSlots readers
+        }
+    }
+
+    void exit(size_t slot)
+    {
+        slots[slot].epoch.store(0, std::memory_order_release);
+    }
+
+    Slot slots[maxSlots];             ///< Epochs pinned by active readers
+    std::atomic<uint64_t> globalEpoch; ///< Advanced on every retire()
+    std::vector<Retired> retired;      ///< Deleters waiting for readers
+    mutable std::mutex retiredMutex;   ///< Guards retired (writers only)
+};
+
+using EpochGuard = EpochManager::Guard;
+
+#endif // EPOCH_MANAGER_HPP
@@ -0,0 +1,330 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>            // For std::ifstream
+#include <sstream>            // For std::istringstream
+#include <thread>             // For std::thread
+#include <algorithm>          // For std::max
+#include <exception>          // For std::exception_ptr
+#include <functional>         // For std::function
+#include <mutex>              // For std::mutex, std::lock_guard, std::unique_lock
+#include <condition_variable> // For std::condition_variable
+#include <cstdint>            // For uint64_t
+
+#ifdef __linux__
+#include <sched.h> // For sched_setaffinity, CPU_SET
+#endif
+
+/**
+ * @brief One NUMA node: a memory controller and the CPUs closest to it.
+ */
+struct NumaNode
+{
+    unsigned id = 0;            ///< Node number, as in /sys/devices/system/node/node<id>
+    std::vector<unsigned> cpus; ///< Logical CPUs of the node
+};
+
+/**
+ * @brief NUMA nodes of the machine, read from sysfs on Linux.
+ *
+ * Elsewhere, or when sysfs is not available, the machine is a single node holding every CPU, so
+ * code written for several nodes runs unchanged. No library (libnuma) is needed: memory is placed
+ * on a node by the first-touch policy of the kernel, i.e. it is allocated and written by a thread
+ * pinned to that node (see runOnNode).
+ */
+class NumaTopology
+{
+public:
+    /**
+     * @brief Detects the nodes with CPUs.
+     */
+    static NumaTopology detect()
+    {
+        NumaTopology topology;
+#ifdef __linux__
+        for (unsigned id = 0; id < maxNodes; ++id)
+        {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string list;
+            if (!file.is_open() || !std::getline(file, list))
+                continue;
+
+            NumaNode node;
+            node.id = id;
+            node.cpus = parseCpuList(list);
+            if (!node.cpus.empty())
+                topology.nodes.push_back(node);
+        }
+#endif
+        if (topology.nodes.empty())
+            topology.nodes.push_back(singleNode());
+        return topology;
+    }
+
+    /**
+     * @brief Returns a topology of n nodes splitting the CPUs evenly, to exercise multi-node code
+     * paths on a single-node machine.
+     */
+    static NumaTopology simulated(unsigned n)
+    {
+        NumaNode all = singleNode();
+        NumaTopology topology;
+        n = std::max(1u, n);
+        for (unsigned i = 0; i < n; ++i)
+        {
+            NumaNode node;
+            node.id = i;
+            for (size_t c = i; c < all.cpus.size(); c += n)
+            {
+                node.cpus.push_back(all.cpus[c]);
+            }
+            if (node.cpus.empty())
+                node.cpus.push_back(all.cpus[i % all.cpus.size()]);
+            topology.nodes.push_back(node);
+        }
+        return topology;
+    }
+
+    const std::vector<NumaNode> &getNodes() const
+    {
+        return nodes;
+    }
+
+    size_t size() const
+    {
+        return nodes.size();
+    }
+
+    /**
+     * @brief Parses a sysfs CPU list such as "0-3,8-11".
+     */
+    static std::vector<unsigned> parseCpuList(const std::string &list)
+    {
+        std::vector<unsigned> cpus;
+        std::istringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ','))
+        {
+            if (range.empty() || range[0] < '0' || range[0] > '9')
+                continue;
+            size_t dash = range.find('-');
+            unsigned first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+            unsigned last = dash == std::string::npos ? first : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+            for (unsigned cpu = first; cpu <= last; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+private:
+    static constexpr unsigned maxNodes = 64; ///< Node numbers probed in sysfs
+
+    static NumaNode singleNode()
+    {
+        NumaNode node;
+        unsigned n = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < n; ++cpu)
+        {
+            node.cpus.push_back(cpu);
+        }
+        return node;
+    }
+
+    std::vector<NumaNode> nodes; ///< Nodes with at least one CPU
+};
+
+/**
+ * @brief Restricts the calling thread to some CPUs.
+ *
+ * @return bool False if pinning is not supported (non-Linux) or was refused.
+ */
+inline bool pinThread(const std::vector<unsigned> &cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+/**
+ * @brief Runs fn() on a thread pinned to the CPUs of a node and waits for it.
+ *
+ * Memory first written by fn() is placed on the node. An exception thrown by fn() is rethrown.
+ */
+template <typename Fn>
+void runOnNode(const NumaNode &node, Fn fn)
+{
+    std::exception_ptr failure;
+    std::thread thread([&]
+                       {
+        pinThread(node.cpus);
+        try
+        {
+            fn();
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+        } });
+    thread.join();
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+/**
+ * @brief Threads started once, pinned to the CPUs of their node, and reused by every run().
+ *
+ * Creating and pinning a thread costs more than a small search, so a searcher keeps one pool for
+ * its lifetime. The workers of node 0 come first, then those of node 1, and so on. run() calls are
+ * serialized.
+ */
+class NumaThreadPool
+{
+public:
+    /**
+     * @brief Starts the workers.
+     *
+     * @param topology The nodes.
+     * @param threadsPerNode The number of workers of each node.
+     * @param pin Pin every worker to the CPUs of its node.
+     */
+    NumaThreadPool(const NumaTopology &topology, const std::vector<size_t> &threadsPerNode, bool pin)
+    {
+        for (size_t n = 0; n < threadsPerNode.size(); ++n)
+        {
+            nodes.insert(nodes.end(), threadsPerNode[n], n);
+        }
+        for (size_t w = 0; w < nodes.size(); ++w)
+        {
+            const std::vector<unsigned> *cpus = pin ? &topology.getNodes()[nodes[w]].cpus : nullptr;
+            threads.emplace_back([this, w, cpus]
+                                 {
+                if (cpus)
+                    pinThread(*cpus);
+                work(w); });
+        }
+    }
+
+    NumaThreadPool(const NumaThreadPool &) = delete;
+    NumaThreadPool &operator=(const NumaThreadPool &) = delete;
+
+    ~NumaThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    /**
+     * @brief Returns the number of workers.
+     */
+    size_t size() const
+    {
+        return nodes.size();
+    }
+
+    /**
+     * @brief Returns the index in the topology of the node of a worker.
+     */
+    size_t nodeOf(size_t worker) const
+    {
+        return nodes[worker];
+    }
+
+    /**
+     * @brief Runs jobs[w] on worker w (empty jobs are skipped) and waits for all of them.
+     *
+     * The first exception thrown by a job is rethrown.
+     *
+     * @param jobs One job per worker.
+     */
+    void run(const std::vector<std::function<void()>> &jobs)
+    {
+        std::lock_guard<std::mutex> serial(runMutex);
+        std::unique_lock<std::mutex> lock(mutex);
+        current = &jobs;
+        pending = threads.size();
+        failure = nullptr;
+        ++generation;
+        wake.notify_all();
+        finished.wait(lock, [this]
+                      { return pending == 0; });
+        current = nullptr;
+        if (failure)
+            std::rethrow_exception(failure);
+    }
+
+private:
+    /**
+     * @brief Loop of worker w: waits for a run(), runs its job, reports.
+     */
+    void work(size_t w)
+    {
+        uint64_t seen = 0;
+        while (true)
+        {
+            const std::function<void()> *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]
+                          { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                job = w < current->size() ? &(*current)[w] : nullptr;
+            }
+
+            std::exception_ptr error;
+            if (job && *job)
+            {
+                try
+                {
+                    (*job)();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (error && !failure)
+                failure = error;
+            if (--pending == 0)
+                finished.notify_one();
+        }
+    }
+
+    std::vector<size_t> nodes;                                   ///< Node of each worker
+    std::vector<std::thread> threads;                            ///< The workers
+    std::mutex runMutex;                                         ///< Serializes run()
+    std::mutex mutex;                                            ///< Guards the fields below
+    std::condition_variable wake;                                ///< Signals a new run() or the shutdown
+    std::condition_variable finished;                            ///< Signals the last job of a run()
+    const std::vector<std::function<void()>> *current = nullptr; ///< Jobs of the running run()
+    uint64_t generation = 0;                                     ///< Incremented by every run()
+    size_t pending = 0;                                          ///< Workers still busy with the running run()
+    bool stopping = false;                                       ///< Set by the destructor
+    std::exception_ptr failure;                                  ///< First exception of the running run()
+};
+
+#endif // NUMA_HPP
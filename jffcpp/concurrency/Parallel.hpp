@@ -0,0 +1,46 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <vector>
+#include <thread>    // For std::thread
+#include <algorithm> // For std::max, std::min
+
+/**
+ * @brief Runs fn(begin, end) over [0, n) split in contiguous chunks, one per thread.
+ *
+ * @param n The number of items.
+ * @param nThreads The number of threads to use (0 means hardware concurrency).
+ * @param fn The function to run for each chunk.
+ */
+template <typename Fn>
+void parallelFor(size_t n, unsigned nThreads, Fn fn)
+{
+    if (nThreads == 0)
+    {
+        nThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    nThreads = static_cast<unsigned>(std::min<size_t>(nThreads, std::max<size_t>(n, 1)));
+
+    if (nThreads == 1)
+    {
+        fn(size_t(0), n);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    size_t chunk = (n + nThreads - 1) / nThreads;
+    for (unsigned t = 0; t < nThreads; ++t)
+    {
+        size_t begin = t * chunk;
+        size_t end = std::min(n, begin + chunk);
+        if (begin >= end)
+            break;
+        threads.emplace_back(fn, begin, end);
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+#endif // PARALLEL_HPP
@@ -0,0 +1,567 @@
+#ifndef BINARY_FILE_HPP
+#define BINARY_FILE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iterator>    // For std::istreambuf_iterator
+#include <stdexcept>   // For std::runtime_error
+#include <cstring>     // For std::memcpy
+#include <cstdint>     // For uint32_t, uint64_t
+#include <type_traits> // For std::is_trivially_copyable_v
+#include <algorithm>   // For std::min
+#include "HugePages.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>    // For open
+#include <sys/mman.h> // For mmap, munmap
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For close
+#endif
+
+/**
+ * @brief Versioned binary container used to persist galleries and searchers.
+ *
+ * Layout: an 8-byte magic and a format version, followed by named sections. Each section stores
+ * its name, payload size and the CRC-32 of the payload, and the payload starts on a 64-byte
+ * boundary so arrays can be used straight from a memory-mapped file.
+ */
+namespace BinaryFile
+{
+    constexpr char magic[8] = {'J', 'F', 'F', 'B', 'I', 'N', '\0', '\0'};
+    constexpr uint32_t formatVersion = 1;
+    constexpr uint64_t alignment = 64;
+
+    /**
+     * @brief Updates a CRC-32 (IEEE 802.3) with the given bytes.
+     *
+     * @param crc The CRC of the previous bytes (0 to start).
+     * @param data The bytes.
+     * @param size The number of bytes.
+     * @return uint32_t The updated CRC.
+     */
+    inline uint32_t crc32(uint32_t crc, const void *data, size_t size)
+    {
+        static const auto table = []()
+        {
+            std::vector<uint32_t> t(256);
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[i] = c;
+            }
+            return t;
+        }();
+
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    /**
+     * @brief Position of the payload of a section in the file.
+     */
+    struct SectionLocation
+    {
+        uint64_t offset; ///< Byte offset of the payload from the start of the file
+        uint64_t size;   ///< Payload size in bytes
+    };
+
+    /**
+     * @brief Locates every section by reading only the section headers, so that sections larger
+     * than memory can be streamed (see StreamingSearcher). Checksums are not verified.
+     *
+     * @param filename The path of the file.
+     * @throws std::runtime_error if the file is not a valid binary file.
+     */
+    inline std::map<std::string, SectionLocation> locateSections(const std::string &filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not open file: " + filename);
+        }
+        file.seekg(0, std::ios::end);
+        uint64_t end = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+
+        char header[16];
+        uint32_t version;
+        if (!file.read(header, sizeof(header)) || std::memcmp(header, magic, sizeof(magic)) != 0)
+        {
+            throw std::runtime_error("Not a binary index file: " + filename);
+        }
+        std::memcpy(&version, header + 8, sizeof(version));
+        if (version != formatVersion)
+        {
+            throw std::runtime_error("Unsupported binary file version " + std::to_string(version) + " in " + filename);
+        }
+
+        // Same walk as BinaryReader, with seeks instead of a mapping
+        auto align = [](uint64_t p, uint64_t to)
+        { return p + (to - p % to) % to; };
+        std::map<std::string, SectionLocation> sections;
+        uint64_t p = sizeof(header);
+        while (p < end)
+        {
+            uint32_t nameLength;
+            file.seekg(p);
+            if (!file.read(reinterpret_cast<char *>(&nameLength), sizeof(nameLength)) || nameLength > end - p - sizeof(nameLength))
+                throw std::runtime_error("Corrupted section header in " + filename);
+            std::string name(nameLength, '\0');
+            file.read(&name[0], nameLength);
+            p = align(p + sizeof(nameLength) + nameLength, 8);
+
+            uint64_t size;
+            file.seekg(p);
+            if (end - p < 16 || !file.read(reinterpret_cast<char *>(&size), sizeof(size)))
+                throw std::runtime_error("Corrupted section header in " + filename);
+            p = align(p + 16, alignment);
+
+            if (size > end - std::min(p, end))
+                throw std::runtime_error("Section " + name + " is truncated in " + filename);
+            sections[name] = {p, size};
+            p = align(p + size, 8);
+        }
+        return sections;
+    }
+} // namespace BinaryFile
+
+/**
+ * @brief Writes a BinaryFile section by section.
+ */
+class BinaryWriter
+{
+public:
+    /**
+     * @brief Creates the file and writes the file header.
+     *
+     * @param filename The path of the file.
+     */
+    explicit BinaryWriter(const std::string &filename)
+        : file(filename, std::ios::binary | std::ios::trunc), inSection(false), sectionCrc(0), sectionSize(0), sizePosition(0)
+    {
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not open file for writing: " + filename);
+        }
+        file.write(BinaryFile::magic, sizeof(BinaryFile::magic));
+        writeRaw(BinaryFile::formatVersion);
+        writeRaw(uint32_t(0));
+    }
+
+    /**
+     * @brief Starts a new section. Every write until endSection() goes to its payload.
+     *
+     * @param name Unique name of the section.
+     */
+    void beginSection(const std::string &name)
+    {
+        if (inSection)
+        {
+            throw std::logic_error("Section " + name + " started inside another section");
+        }
+        writeRaw(uint32_t(name.size()));
+        file.write(name.data(), name.size());
+        pad(8);
+
+        sizePosition = file.tellp();
+        writeRaw(uint64_t(0)); // Payload size, patched by endSection()
+        writeRaw(uint32_t(0)); // CRC-32, patched by endSection()
+        writeRaw(uint32_t(0));
+        pad(BinaryFile::alignment);
+
+        inSection = true;
+        sectionCrc = 0;
+        sectionSize = 0;
+    }
+
+    /**
+     * @brief Closes the current section, patching its size and checksum.
+     */
+    void endSection()
+    {
+        std::streampos end = file.tellp();
+        file.seekp(sizePosition);
+        writeRaw(sectionSize);
+        writeRaw(sectionCrc);
+        file.seekp(end);
+        pad(8);
+        inSection = false;
+    }
+
+    /**
+     * @brief Writes a trivially copyable value to the current section.
+     */
+    template <typename T>
+    void write(const T &value)
+    {
+        writeArray(&value, 1);
+    }
+
+    /**
+     * @brief Writes an array of trivially copyable values to the current section.
+     */
+    template <typename T>
+    void writeArray(const T *values, size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be written");
+        if (!inSection)
+        {
+            throw std::logic_error("Write outside of a section");
+        }
+        size_t bytes = count * sizeof(T);
+        sectionCrc = BinaryFile::crc32(sectionCrc, values, bytes);
+        sectionSize += bytes;
+        file.write(reinterpret_cast<const char *>(values), bytes);
+    }
+
+    /**
+     * @brief Writes a length-prefixed string to the current section.
+     */
+    void writeString(const std::string &value)
+    {
+        write(uint32_t(value.size()));
+        writeArray(value.data(), value.size());
+    }
+
+    /**
+     * @brief Flushes the file, throwing if any write failed.
+     */
+    void close()
+    {
+        file.flush();
+        if (!file)
+        {
+            throw std::runtime_error("Error while writing binary file");
+        }
+        file.close();
+    }
+
+private:
+    template <typename T>
+    void writeRaw(const T &value)
+    {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void pad(uint64_t to)
+    {
+        uint64_t position = static_cast<uint64_t>(file.tellp());
+        static const char zeros[BinaryFile::alignment] = {};
+        file.write(zeros, (to - position % to) % to);
+    }
+
+    std::ofstream file;
+    bool inSection;
+    uint32_t sectionCrc;
+    uint64_t sectionSize;
+    std::streampos sizePosition;
+};
+
+/**
+ * @brief Sequential reader over the payload of one section.
+ */
+class SectionReader
+{
+public:
+    SectionReader(const std::string &name, const char *data, size_t size) : name(name), data(data), size(size), position(0) {}
+
+    /**
+     * @brief Reads a trivially copyable value.
+     */
+    template <typename T>
+    T read()
+    {
+        T value;
+        readArray(&value, 1);
+        return value;
+    }
+
+    /**
+     * @brief Copies an array of trivially copyable values.
+     */
+    template <typename T>
+    void readArray(T *out, size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be read");
+        if (count > remaining() / sizeof(T))
+        {
+            throw std::runtime_error("Section " + name + " is truncated");
+        }
+        std::memcpy(out, view(count * sizeof(T)), count * sizeof(T));
+    }
+
+    /**
+     * @brief Reads an element count and checks the rest of the payload can hold that many elements.
+     *
+     * @tparam Count The type of the stored count.
+     * @param elementBytes The minimum size of one element in the payload (greater than 0).
+     * @throws std::runtime_error if the count exceeds the remaining payload.
+     */
+    template <typename Count>
+    size_t readCount(size_t elementBytes)
+    {
+        Count count = read<Count>();
+        if (count > remaining() / elementBytes)
+        {
+            throw std::runtime_error("Section " + name + " is truncated");
+        }
+        return static_cast<size_t>(count);
+    }
+
+    /**
+     * @brief Reads a length-prefixed string.
+     */
+    std::string readString()
+    {
+        uint32_t length = read<uint32_t>();
+        return std::string(view(length), length);
+    }
+
+    /**
+     * @brief Returns a pointer to the next bytes of the payload (inside the mapped file) and skips them.
+     *
+     * @param bytes The number of bytes.
+     */
+    const char *view(size_t bytes)
+    {
+        if (bytes > size - position)
+        {
+            throw std::runtime_error("Section " + name + " is truncated");
+        }
+        const char *p = data + position;
+        position += bytes;
+        return p;
+    }
+
+    /**
+     * @brief Returns the number of payload bytes not read yet, to validate counts before allocating.
+     */
+    size_t remaining() const
+    {
+        return size - position;
+    }
+
+    /**
+     * @brief Returns true once the whole payload was read.
+     */
+    bool atEnd() const
+    {
+        return position == size;
+    }
+
+private:
+    std::string name;
+    const char *data;
+    size_t size;
+    size_t position;
+};
+
+/**
+ * @brief Opens a BinaryFile, memory-mapping it where the platform allows, and indexes its sections.
+ */
+class BinaryReader
+{
+public:
+    /**
+     * @brief Maps the file and validates its header and section checksums.
+     *
+     * @param filename The path of the file.
+     * @param verify If false, checksums are not verified (faster restarts from trusted files).
+     * @param hugePages Pages of the mapping, for tables probed in place (see HugePages::mapFile).
+     * Falls back to a regular mapping when the file cannot be loaded on huge pages.
+     */
+    explicit BinaryReader(const std::string &filename, bool verify = true, HugePageMode hugePages = HugePageMode::Off)
+        : mapped(nullptr), mappedSize(0), hugePages(false)
+    {
+        map(filename, hugePages);
+
+        // The destructor does not run when the constructor throws: release the mapping here
+        try
+        {
+            indexSections(filename, verify);
+        }
+        catch (...)
+        {
+            unmap();
+            throw;
+        }
+    }
+
+    ~BinaryReader()
+    {
+        unmap();
+    }
+
+    BinaryReader(const BinaryReader &) = delete;
+    BinaryReader &operator=(const BinaryReader &) = delete;
+
+    /**
+     * @brief Returns true if the file has a section with the given name.
+     */
+    bool has(const std::string &name) const
+    {
+        return sections.count(name) > 0;
+    }
+
+    /**
+     * @brief Returns a reader over the payload of a section.
+     *
+     * @param name The name of the section.
+     * @throws std::runtime_error if the section does not exist.
+     */
+    SectionReader section(const std::string &name) const
+    {
+        auto it = sections.find(name);
+        if (it == sections.end())
+        {
+            throw std::runtime_error("Missing section: " + name);
+        }
+        return SectionReader(name, it->second.first, it->second.second);
+    }
+
+    /**
+     * @brief Returns how much of the file is held in huge pages.
+     */
+    HugePageUsage hugePageUsage() const
+    {
+        return HugePages::usageOf(data(), length());
+    }
+
+private:
+    /**
+     * @brief Validates the header and records the location of every section.
+     */
+    void indexSections(const std::string &filename, bool verify)
+    {
+        const char *end = data() + length();
+        const char *p = data();
+        if (length() < 16 || std::memcmp(p, BinaryFile::magic, sizeof(BinaryFile::magic)) != 0)
+        {
+            throw std::runtime_error("Not a binary index file: " + filename);
+        }
+        uint32_t version;
+        std::memcpy(&version, p + 8, sizeof(version));
+        if (version != BinaryFile::formatVersion)
+        {
+            throw std::runtime_error("Unsupported binary file version " + std::to_string(version) + " in " + filename);
+        }
+        p += 16;
+
+        // Every header read is checked against the bytes left, as in BinaryFile::locateSections
+        while (p < end)
+        {
+            uint32_t nameLength;
+            if (static_cast<size_t>(end - p) < sizeof(nameLength))
+                throw std::runtime_error("Corrupted section header in " + filename);
+            std::memcpy(&nameLength, p, sizeof(nameLength));
+            p += sizeof(nameLength);
+            if (nameLength > static_cast<size_t>(end - p))
+                throw std::runtime_error("Corrupted section header in " + filename);
+            std::string name(p, nameLength);
+            p = align(p + nameLength, 8);
+
+            uint64_t size;
+            uint32_t crc;
+            if (p > end || end - p < 16)
+                throw std::runtime_error("Corrupted section header in " + filename);
+            std::memcpy(&size, p, sizeof(size));
+            std::memcpy(&crc, p + 8, sizeof(crc));
+            p = align(p + 16, BinaryFile::alignment);
+
+            if (p > end || size > static_cast<uint64_t>(end - p))
+                throw std::runtime_error("Section " + name + " is truncated in " + filename);
+            if (verify && BinaryFile::crc32(0, p, size) != crc)
+                throw std::runtime_error("Checksum mismatch in section " + name + " of " + filename);
+
+            sections[name] = {p, size};
+            p = align(p + size, 8);
+        }
+    }
+
+    /**
+     * @brief Releases the mapping, if any.
+     */
+    void unmap()
+    {
+#ifndef _WIN32
+        if (hugePages)
+            HugePages::release(mapped);
+        else if (mapped)
+            munmap(mapped, mappedSize);
+#endif
+        mapped = nullptr;
+        mappedSize = 0;
+    }
+
+    const char *align(const char *p, uint64_t to) const
+    {
+        uint64_t offset = static_cast<uint64_t>(p - data());
+        return p + (to - offset % to) % to;
+    }
+
+    const char *data() const
+    {
+        return mapped ? static_cast<const char *>(mapped) : buffer.data();
+    }
+
+    size_t length() const
+    {
+        return mapped ? mappedSize : buffer.size();
+    }
+
+    void map(const std::string &filename, HugePageMode mode)
+    {
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd >= 0)
+        {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                if (mode != HugePageMode::Off)
+                {
+                    mapped = HugePages::mapFile(fd, st.st_size, mode);
+                    hugePages = mapped != nullptr;
+                }
+                void *p = mapped ? mapped : mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    mapped = p;
+                    mappedSize = st.st_size;
+                }
+            }
+            ::close(fd);
+            if (mapped)
+                return;
+        }
+#else
+        (void)mode;
+#endif
+        // Fallback: read the whole file
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not open file: " + filename);
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void *mapped;                                                 ///< Mapped file, nullptr when buffered
+    size_t mappedSize;                                            ///< Size of the mapping
+    bool hugePages;                                               ///< True if mapped by HugePages::mapFile
+    std::vector<char> buffer;                                     ///< File contents when not mapped
+    std::map<std::string, std::pair<const char *, size_t>> sections; ///< Payload of each section
+};
+
+#endif // BINARY_FILE_HPP
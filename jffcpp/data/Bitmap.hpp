@@ -0,0 +1,71 @@
+#ifndef BITMAP_HPP
+#define BITMAP_HPP
+
+#include <vector>
+#include <bitset>  // For std::bitset::count
+#include <cstdint> // For uint64_t
+
+/**
+ * @brief Compact set of small non-negative integers (partition indices, Individual IDs), one bit each.
+ */
+class Bitmap
+{
+public:
+    Bitmap() = default;
+
+    /**
+     * @brief Constructs a bitmap holding the given values.
+     */
+    Bitmap(const std::vector<uint32_t> &values)
+    {
+        for (uint32_t value : values)
+        {
+            set(value);
+        }
+    }
+
+    /**
+     * @brief Adds a value, growing the bitmap if needed.
+     */
+    void set(uint32_t value)
+    {
+        if (value / 64 >= words.size())
+            words.resize(value / 64 + 1, 0);
+        words[value / 64] |= uint64_t(1) << (value % 64);
+    }
+
+    /**
+     * @brief Removes a value.
+     */
+    void reset(uint32_t value)
+    {
+        if (value / 64 < words.size())
+            words[value / 64] &= ~(uint64_t(1) << (value % 64));
+    }
+
+    /**
+     * @brief Returns true if the value is in the set.
+     */
+    bool test(uint32_t value) const
+    {
+        return value / 64 < words.size() && (words[value / 64] >> (value % 64)) & 1;
+    }
+
+    /**
+     * @brief Returns the number of values in the set.
+     */
+    size_t count() const
+    {
+        size_t total = 0;
+        for (uint64_t word : words)
+        {
+            total += std::bitset<64>(word).count();
+        }
+        return total;
+    }
+
+private:
+    std::vector<uint64_t> words; ///< Bit i of word w is value 64 * w + i
+};
+
+#endif // BITMAP_HPP
@@ -6,6 +6,8 @@
 #include <cstdint>  // For uint32_t
 #include <iostream> // For std::ostream
 #include <cmath>    // For std::sqrt
+#include <atomic>   // For std::atomic
+#include <stdexcept> // For std::invalid_argument
 
 /**
  * @brief Class representing a feature.
@@ -29,15 +31,18 @@ public:
     Feature(uint32_t id, const std::vector<float> &vals)
         : id(id), values(vals)
     {
-        if (id >= nextId && id != 0)
-        {
-            nextId = id + 1;
-        }
-        else if (id < nextId && id != 0)
+        if (id == 0)
+            return;
+
+        uint32_t expected = nextId.load();
+        do
         {
-            // Throw an exception if the ID is already used
-            throw std::invalid_argument("ID already used");
-        }
+            if (id < expected)
+            {
+                // Throw an exception if the ID is already used
+                throw std::invalid_argument("ID already used");
+            }
+        } while (!nextId.compare_exchange_weak(expected, id + 1));
     }
 
     /**
@@ -195,15 +200,46 @@ public:
         return seed;
     }
 
+    /**
+     * @brief Makes sure automatically assigned IDs start at least at next.
+     *
+     * Used when features are restored with their saved IDs.
+     *
+     * @param next The smallest ID that may still be assigned.
+     */
+    static void reserveIds(uint32_t next)
+    {
+        uint32_t current = nextId.load();
+        while (current < next && !nextId.compare_exchange_weak(current, next))
+        {
+        }
+    }
+
     uint32_t id;              ///< Unique identifier
     std::vector<float> values; ///< Vector of values
 private:
     size_t printLimit = 5;  ///< 0 means no limit
-    static uint32_t nextId; ///< Next unique identifier
+    static std::atomic<uint32_t> nextId; ///< Next unique identifier (features are created by concurrent searches)
 };
 
 // Initialize the static member
-uint32_t Feature::nextId = 0;
+std::atomic<uint32_t> Feature::nextId{0};
+
+/**
+ * @brief Plain features have no parent, so they are never retired.
+ */
+inline bool isRetired(const Feature &)
+{
+    return false;
+}
+
+/**
+ * @brief Plain features have no parent; 0 is never a valid Individual ID.
+ */
+inline uint32_t representativeId(const Feature &)
+{
+    return 0;
+}
 
 namespace std
 {
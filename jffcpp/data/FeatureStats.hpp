@@ -0,0 +1,158 @@
+#ifndef FEATURE_STATS_HPP
+#define FEATURE_STATS_HPP
+
+#include <vector>
+#include <cmath>     // For std::sqrt
+#include <cstdint>   // For uint64_t
+#include <stdexcept> // For std::invalid_argument
+
+/**
+ * @brief Streaming per-dimension mean and standard deviation of a set of descriptors.
+ *
+ * Descriptors are added one at a time with Welford's update, so the statistics of a file are
+ * known as soon as it is parsed, in a single pass and without keeping the descriptors. Two
+ * accumulators over disjoint sets merge exactly (Chan et al.), so shards loaded on different
+ * threads, or descriptors enrolled later, combine without reading the old descriptors again.
+ *
+ * Accumulation is in double precision; the per-dimension loops have no dependency between
+ * dimensions and are vectorized by the compiler.
+ */
+class FeatureStats
+{
+public:
+    /**
+     * @brief Constructs empty statistics; the dimension is fixed by the first descriptor.
+     */
+    FeatureStats() = default;
+
+    /**
+     * @brief Reconstructs the statistics of count descriptors from their mean and (population)
+     * standard deviation, e.g. those saved with an Individual.
+     */
+    static FeatureStats fromMoments(uint64_t count, const std::vector<float> &mean, const std::vector<float> &stddev)
+    {
+        if (mean.size() != stddev.size())
+            throw std::invalid_argument("Mean and standard deviation sizes differ");
+
+        FeatureStats stats;
+        if (count == 0)
+            return stats;
+        stats.n = count;
+        stats.means.assign(mean.begin(), mean.end());
+        stats.m2.resize(mean.size());
+        for (size_t i = 0; i < mean.size(); ++i)
+        {
+            stats.m2[i] = static_cast<double>(stddev[i]) * stddev[i] * static_cast<double>(count);
+        }
+        return stats;
+    }
+
+    /**
+     * @brief Adds one descriptor.
+     *
+     * @param values Pointer to the descriptor values.
+     * @param size Number of values (must match the previous descriptors).
+     */
+    void add(const float *values, size_t size)
+    {
+        if (n == 0)
+        {
+            means.assign(size, 0.0);
+            m2.assign(size, 0.0);
+        }
+        else if (size != means.size())
+        {
+            throw std::invalid_argument("Descriptor size differs from the accumulated statistics");
+        }
+
+        ++n;
+        const double invN = 1.0 / static_cast<double>(n);
+        double *mean = means.data();
+        double *sq = m2.data();
+        for (size_t i = 0; i < size; ++i)
+        {
+            double delta = values[i] - mean[i];
+            mean[i] += delta * invN;
+            sq[i] += delta * (values[i] - mean[i]);
+        }
+    }
+
+    /**
+     * @brief Adds one descriptor.
+     */
+    void add(const std::vector<float> &values)
+    {
+        add(values.data(), values.size());
+    }
+
+    /**
+     * @brief Merges the statistics of a disjoint set of descriptors.
+     */
+    void merge(const FeatureStats &other)
+    {
+        if (other.n == 0)
+            return;
+        if (n == 0)
+        {
+            *this = other;
+            return;
+        }
+        if (other.means.size() != means.size())
+            throw std::invalid_argument("Cannot merge statistics of different dimensions");
+
+        const double total = static_cast<double>(n + other.n);
+        const double weight = static_cast<double>(other.n) / total;
+        const double cross = static_cast<double>(n) * static_cast<double>(other.n) / total;
+        for (size_t i = 0; i < means.size(); ++i)
+        {
+            double delta = other.means[i] - means[i];
+            means[i] += delta * weight;
+            m2[i] += other.m2[i] + delta * delta * cross;
+        }
+        n += other.n;
+    }
+
+    /**
+     * @brief Returns the number of descriptors added.
+     */
+    uint64_t count() const
+    {
+        return n;
+    }
+
+    /**
+     * @brief Returns the dimension of the descriptors (0 while empty).
+     */
+    size_t size() const
+    {
+        return means.size();
+    }
+
+    /**
+     * @brief Returns the mean of each dimension.
+     */
+    std::vector<float> mean() const
+    {
+        return std::vector<float>(means.begin(), means.end());
+    }
+
+    /**
+     * @brief Returns the population standard deviation of each dimension.
+     */
+    std::vector<float> stddev() const
+    {
+        std::vector<float> result(m2.size());
+        for (size_t i = 0; i < m2.size(); ++i)
+        {
+            result[i] = static_cast<float>(std::sqrt(m2[i] / static_cast<double>(n)));
+        }
+        return result;
+    }
+
+private:
+    uint64_t n = 0;             ///< Number of descriptors
+    std::vector<double> means;  ///< Running mean per dimension
+    std::vector<double> m2;     ///< Sum of squared deviations per dimension
+};
+
+#endif // FEATURE_STATS_HPP
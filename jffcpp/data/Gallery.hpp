@@ -0,0 +1,535 @@
+#ifndef GALLERY_HPP
+#define GALLERY_HPP
+
+#include <vector>
+#include <string>
+#include <memory>             // For std::shared_ptr
+#include <unordered_map>      // For std::unordered_map
+#include <algorithm>          // For std::remove
+#include <iterator>           // For std::next
+#include <mutex>              // For std::mutex, std::unique_lock
+#include <shared_mutex>       // For std::shared_mutex, std::shared_lock
+#include <thread>             // For std::thread
+#include <condition_variable> // For std::condition_variable
+#include <chrono>             // For std::chrono::milliseconds
+#include <stdexcept>          // For std::logic_error, std::runtime_error
+#include "Individual.hpp"
+#include "ParentedFeature.hpp"
+#include "Persistence.hpp"
+#include "Bitmap.hpp"
+#include "../indexing/GalleryIndex.hpp"
+#include "../concurrency/EpochManager.hpp"
+
+/**
+ * @brief Owns the enrolled Individuals and their features, and keeps attached indexes in sync.
+ *
+ * Individuals can be enrolled and retired at any time. Retiring only sets a tombstone on the
+ * Individual, so searches running at the same time simply skip it; the features are removed from
+ * the gallery and from every attached index by compact(), either explicitly or from a background
+ * thread started with startCompaction().
+ *
+ * Compacted Individuals are released through the global EpochManager, so a search result that
+ * points to one (ParentedFeature::representative) stays valid as long as the caller holds an
+ * EpochGuard taken before the search.
+ *
+ * @tparam F The type of the features (ParentedFeature).
+ */
+template <typename F>
+class Gallery
+{
+public:
+    using IndividualPtr = std::shared_ptr<Individual<F>>;
+
+    /**
+     * @brief Constructs an empty Gallery.
+     */
+    Gallery() : retiredCount(0), stopRequested(false) {}
+
+    /**
+     * @brief Constructs a Gallery from the result of loadIndividuals.
+     *
+     * @param individuals The loaded Individuals.
+     * @param features The features, with their representative already set.
+     * @param partitionNames Name of each partition index, as returned by loadIndividuals.
+     */
+    Gallery(std::vector<IndividualPtr> individuals, std::vector<F> features, std::vector<std::string> partitionNames = {})
+        : individuals(std::move(individuals)), features(std::move(features)), partitionNames(std::move(partitionNames)), retiredCount(0), stopRequested(false)
+    {
+        for (const auto &individual : this->individuals)
+        {
+            byId[individual->getId()] = individual;
+        }
+    }
+
+    ~Gallery()
+    {
+        stopCompaction();
+    }
+
+    Gallery(const Gallery &) = delete;
+    Gallery &operator=(const Gallery &) = delete;
+
+    /**
+     * @brief Attaches an index, adding every live feature to it.
+     *
+     * The index must outlive the Gallery or be detached first.
+     *
+     * @param index The index to keep in sync.
+     */
+    void attach(GalleryIndex<F> &index)
+    {
+        std::lock_guard<std::mutex> writeLock(updateMutex);
+
+        std::vector<F> live;
+        live.reserve(features.size());
+        for (const auto &f : features)
+        {
+            if (!isRetired(f))
+                live.push_back(f);
+        }
+        index.onEnroll(live);
+        indexes.push_back(&index);
+    }
+
+    /**
+     * @brief Detaches a previously attached index.
+     *
+     * @param index The index to detach.
+     */
+    void detach(GalleryIndex<F> &index)
+    {
+        std::lock_guard<std::mutex> writeLock(updateMutex);
+        indexes.erase(std::remove(indexes.begin(), indexes.end(), &index), indexes.end());
+    }
+
+    /**
+     * @brief Enrolls a new Individual with its descriptors.
+     *
+     * The mean and standard deviation of the Individual are computed from the descriptors, and
+     * the new features are appended to every attached index.
+     *
+     * @param name Name of the Individual.
+     * @param descriptors One descriptor per minutia.
+     * @param partition Partition index of the Individual (see partitionIndex).
+     * @return IndividualPtr The enrolled Individual.
+     */
+    IndividualPtr enroll(const std::string &name, std::vector<std::vector<float>> descriptors, uint32_t partition = 0)
+    {
+        auto individual = std::make_shared<Individual<F>>();
+        individual->name = name;
+        individual->partition = partition;
+
+        // Feature IDs are assigned automatically, so enrollment never collides with loaded IDs
+        std::vector<F> newFeatures;
+        newFeatures.reserve(descriptors.size());
+        for (auto &descriptor : descriptors)
+        {
+            F f(std::move(descriptor));
+            f.representative = individual.get();
+            individual->addFeature(f.getId());
+            newFeatures.push_back(std::move(f));
+        }
+
+        individual->calculateStatistics(newFeatures);
+
+        std::lock_guard<std::mutex> writeLock(updateMutex);
+        {
+            std::unique_lock<std::shared_mutex> lock(dataMutex);
+            individuals.push_back(individual);
+            byId[individual->getId()] = individual;
+            features.insert(features.end(), newFeatures.begin(), newFeatures.end());
+        }
+        for (auto *index : indexes)
+        {
+            index->onEnroll(newFeatures);
+        }
+
+        return individual;
+    }
+
+    /**
+     * @brief Retires an Individual, hiding it from every search immediately.
+     *
+     * @param individualId ID of the Individual.
+     * @return bool True if the Individual was found and was not retired yet.
+     */
+    bool retire(uint32_t individualId)
+    {
+        std::lock_guard<std::mutex> writeLock(updateMutex);
+        auto it = byId.find(individualId);
+        if (it == byId.end() || it->second->isRetired())
+            return false;
+
+        it->second->retire();
+        ++retiredCount;
+        return true;
+    }
+
+    /**
+     * @brief Removes the features of retired Individuals from the gallery and every attached index.
+     *
+     * @return size_t The number of features removed from the gallery.
+     */
+    size_t compact()
+    {
+        std::lock_guard<std::mutex> writeLock(updateMutex);
+        if (retiredCount == 0)
+            return 0;
+
+        // Indexes first, so none of them keeps a pointer to an Individual released below
+        for (auto *index : indexes)
+        {
+            index->compact();
+        }
+
+        std::vector<F> keptFeatures;
+        keptFeatures.reserve(features.size());
+        for (const auto &f : features)
+        {
+            if (!isRetired(f))
+                keptFeatures.push_back(f);
+        }
+        std::vector<IndividualPtr> keptIndividuals;
+        auto released = std::make_shared<std::vector<IndividualPtr>>();
+        keptIndividuals.reserve(individuals.size());
+        for (const auto &individual : individuals)
+        {
+            if (individual->isRetired())
+                released->push_back(individual);
+            else
+                keptIndividuals.push_back(individual);
+        }
+
+        size_t removed = features.size() - keptFeatures.size();
+        {
+            std::unique_lock<std::shared_mutex> lock(dataMutex);
+            features.swap(keptFeatures);
+            individuals.swap(keptIndividuals);
+            for (auto it = byId.begin(); it != byId.end();)
+            {
+                it = it->second->isRetired() ? byId.erase(it) : std::next(it);
+            }
+        }
+        retiredCount = 0;
+
+        // Readers that pinned an epoch before the swap may still reach them through old results
+        EpochManager::global().retire([released]()
+                                      { released->clear(); });
+        return removed;
+    }
+
+    /**
+     * @brief Starts a background thread that compacts the gallery periodically.
+     *
+     * @param interval Time between two compaction checks.
+     */
+    void startCompaction(std::chrono::milliseconds interval)
+    {
+        stopCompaction();
+        stopRequested = false;
+        compactionThread = std::thread([this, interval]()
+                                       {
+            std::unique_lock<std::mutex> lock(stopMutex);
+            while (!stopCondition.wait_for(lock, interval, [this]() { return stopRequested; }))
+            {
+                lock.unlock();
+                compact();
+                lock.lock();
+            } });
+    }
+
+    /**
+     * @brief Stops the background compaction thread, if running.
+     */
+    void stopCompaction()
+    {
+        {
+            std::lock_guard<std::mutex> lock(stopMutex);
+            stopRequested = true;
+        }
+        stopCondition.notify_all();
+        if (compactionThread.joinable())
+        {
+            compactionThread.join();
+        }
+    }
+
+    /**
+     * @brief Returns the Individual with the given ID, or nullptr if it is not in the gallery.
+     */
+    IndividualPtr getIndividual(uint32_t individualId) const
+    {
+        std::shared_lock<std::shared_mutex> lock(dataMutex);
+        auto it = byId.find(individualId);
+        return it == byId.end() ? nullptr : it->second;
+    }
+
+    /**
+     * @brief Returns a copy of the list of Individuals (retired ones included until compaction).
+     */
+    std::vector<IndividualPtr> getIndividuals() const
+    {
+        std::shared_lock<std::shared_mutex> lock(dataMutex);
+        return individuals;
+    }
+
+    /**
+     * @brief Returns a copy of the features (retired ones included until compaction).
+     */
+    std::vector<F> getFeatures() const
+    {
+        std::shared_lock<std::shared_mutex> lock(dataMutex);
+        return features;
+    }
+
+    /**
+     * @brief Returns the number of Individuals (retired ones included until compaction).
+     */
+    size_t size() const
+    {
+        std::shared_lock<std::shared_mutex> lock(dataMutex);
+        return individuals.size();
+    }
+
+    /**
+     * @brief Returns the number of features (retired ones included until compaction).
+     */
+    size_t numFeatures() const
+    {
+        std::shared_lock<std::shared_mutex> lock(dataMutex);
+        return features.size();
+    }
+
+    /**
+     * @brief Returns the index of a partition, adding it if it does not exist yet.
+     *
+     * Enrolled Individuals are appended at the end of the gallery, so only loaded partitions are
+     * stored contiguously. Real partitions are numbered from 1: the empty key is partition 0, the
+     * one of Individuals without partition.
+     *
+     * @param name The partition key (e.g. "d07").
+     */
+    uint32_t partitionIndex(const std::string &name)
+    {
+        if (name.empty())
+            return 0;
+        std::unique_lock<std::shared_mutex> lock(dataMutex);
+        if (partitionNames.empty())
+            partitionNames.push_back("");
+        auto it = std::find(partitionNames.begin(), partitionNames.end(), name);
+        if (it != partitionNames.end())
+            return static_cast<uint32_t>(it - partitionNames.begin());
+        partitionNames.push_back(name);
+        return static_cast<uint32_t>(partitionNames.size() - 1);
+    }
+
+    /**
+     * @brief Returns the name of each partition index, "" for partition 0 (empty if the gallery is
+     * not partitioned).
+     */
+    std::vector<std::string> getPartitionNames() const
+    {
+        std::shared_lock<std::shared_mutex> lock(dataMutex);
+        return partitionNames;
+    }
+
+    /**
+     * @brief Returns the mask of the named partitions, for SearchFilter. Unknown and empty names
+     * are ignored, so partition 0 (no partition) is never allowed by a mask.
+     */
+    Bitmap partitionMask(const std::vector<std::string> &names) const
+    {
+        std::shared_lock<std::shared_mutex> lock(dataMutex);
+        Bitmap mask;
+        for (const auto &name : names)
+        {
+            if (name.empty())
+                continue;
+            auto it = std::find(partitionNames.begin(), partitionNames.end(), name);
+            if (it != partitionNames.end())
+                mask.set(static_cast<uint32_t>(it - partitionNames.begin()));
+        }
+        return mask;
+    }
+
+    /**
+     * @brief Returns a resolver from Individual IDs to the Individuals of this gallery, to load searchers.
+     */
+    IndividualResolver resolver() const
+    {
+        return [this](uint32_t individualId)
+        { return getIndividual(individualId).get(); };
+    }
+
+    /**
+     * @brief Saves the live Individuals (ID, name, mean, std, feature IDs), their partitions and their features.
+     *
+     * @param writer The writer.
+     * @param prefix Prefix of the section names.
+     */
+    void save(BinaryWriter &writer, const std::string &prefix = "gallery") const
+    {
+        std::shared_lock<std::shared_mutex> lock(dataMutex);
+
+        std::vector<const Individual<F> *> live;
+        for (const auto &individual : individuals)
+        {
+            if (!individual->isRetired())
+                live.push_back(individual.get());
+        }
+
+        writer.beginSection(prefix + ".individuals");
+        writer.write(uint64_t(live.size()));
+        for (const auto *individual : live)
+        {
+            writer.write(individual->getId());
+            writer.writeString(individual->name);
+            writer.write(uint32_t(individual->mean.size()));
+            writer.writeArray(individual->mean.values.data(), individual->mean.size());
+            writer.writeArray(individual->stddev.values.data(), individual->stddev.size());
+            writer.write(uint64_t(individual->features.size()));
+            writer.writeArray(individual->features.data(), individual->features.size());
+        }
+        writer.endSection();
+
+        // Kept apart from the individual records, so files without partitions stay readable
+        writer.beginSection(prefix + ".partitions");
+        writer.write(uint32_t(partitionNames.size()));
+        for (const auto &name : partitionNames)
+        {
+            writer.writeString(name);
+        }
+        for (const auto *individual : live)
+        {
+            writer.write(individual->partition);
+        }
+        writer.endSection();
+
+        std::vector<const F *> liveFeatures;
+        liveFeatures.reserve(features.size());
+        for (const auto &f : features)
+        {
+            if (!isRetired(f))
+                liveFeatures.push_back(&f);
+        }
+        writeFeatures(writer, prefix + ".features", liveFeatures);
+    }
+
+    /**
+     * @brief Saves the gallery to its own file.
+     */
+    void save(const std::string &filename) const
+    {
+        BinaryWriter writer(filename);
+        save(writer);
+        writer.close();
+    }
+
+    /**
+     * @brief Loads a gallery saved by save(), restoring the saved IDs. The gallery must be empty.
+     *
+     * @param reader The reader.
+     * @param prefix Prefix of the section names.
+     * @param withFeatures If false, only the Individuals are loaded, e.g. to name the results of a
+     * StreamingSearcher reading the features from disk.
+     */
+    void load(const BinaryReader &reader, const std::string &prefix = "gallery", bool withFeatures = true)
+    {
+        std::lock_guard<std::mutex> writeLock(updateMutex);
+        if (!individuals.empty() || !indexes.empty())
+        {
+            throw std::logic_error("Gallery::load requires an empty gallery without attached indexes");
+        }
+
+        SectionReader section = reader.section(prefix + ".individuals");
+        uint64_t count = section.read<uint64_t>();
+        std::vector<IndividualPtr> loaded;
+        std::unordered_map<uint32_t, IndividualPtr> loadedById;
+        uint32_t maxId = 0;
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            auto individual = std::make_shared<Individual<F>>();
+            individual->id = section.read<uint32_t>();
+            individual->name = section.readString();
+
+            std::vector<float> meanValues(section.readCount<uint32_t>(2 * sizeof(float)));
+            std::vector<float> stdValues(meanValues.size());
+            section.readArray(meanValues.data(), meanValues.size());
+            section.readArray(stdValues.data(), stdValues.size());
+            individual->mean.values = std::move(meanValues);
+            individual->stddev.values = std::move(stdValues);
+
+            individual->features.resize(section.readCount<uint64_t>(sizeof(uint32_t)));
+            section.readArray(individual->features.data(), individual->features.size());
+            individual->statisticsCount = individual->mean.size() > 0 ? individual->features.size() : 0;
+
+            maxId = std::max(maxId, individual->id);
+            loadedById[individual->id] = individual;
+            loaded.push_back(std::move(individual));
+        }
+        Individual<F>::reserveIds(maxId + 1);
+
+        std::vector<std::string> loadedPartitions;
+        if (reader.has(prefix + ".partitions"))
+        {
+            SectionReader partitionSection = reader.section(prefix + ".partitions");
+            // Each name is at least its length prefix
+            loadedPartitions.resize(partitionSection.readCount<uint32_t>(sizeof(uint32_t)));
+            for (auto &name : loadedPartitions)
+            {
+                name = partitionSection.readString();
+            }
+            // Index 0 is reserved for Individuals without a partition
+            if (!loadedPartitions.empty() && !loadedPartitions[0].empty())
+                throw std::runtime_error("Partition 0 of section " + prefix + ".partitions is not reserved");
+            for (auto &individual : loaded)
+            {
+                individual->partition = partitionSection.read<uint32_t>();
+                if (individual->partition != 0 && individual->partition >= loadedPartitions.size())
+                    throw std::runtime_error("Unknown partition " + std::to_string(individual->partition) + " in section " + prefix + ".partitions");
+            }
+        }
+
+        std::vector<F> loadedFeatures;
+        if (withFeatures)
+        {
+            loadedFeatures = readFeatures<F>(reader, prefix + ".features", [&loadedById](uint32_t individualId)
+                                             {
+                auto it = loadedById.find(individualId);
+                return it == loadedById.end() ? nullptr : it->second.get(); });
+        }
+
+        std::unique_lock<std::shared_mutex> lock(dataMutex);
+        individuals.swap(loaded);
+        byId.swap(loadedById);
+        features.swap(loadedFeatures);
+        partitionNames.swap(loadedPartitions);
+    }
+
+    /**
+     * @brief Loads a gallery from its own file.
+     */
+    void load(const std::string &filename)
+    {
+        BinaryReader reader(filename);
+        load(reader);
+    }
+
+private:
+    std::vector<IndividualPtr> individuals;                ///< Enrolled Individuals, in enrollment order
+    std::unordered_map<uint32_t, IndividualPtr> byId;      ///< Individuals by ID
+    std::vector<F> features;                               ///< Features of all Individuals
+    std::vector<std::string> partitionNames;               ///< Name of each partition index
+    std::vector<GalleryIndex<F> *> indexes;                ///< Attached indexes
+    size_t retiredCount;                                   ///< Retirements since the last compaction
+
+    mutable std::shared_mutex dataMutex;                   ///< Guards the containers against readers
+    std::mutex updateMutex;                                ///< Serializes writers
+
+    std::thread compactionThread;                          ///< Background compaction
+    std::mutex stopMutex;                                  ///< Guards stopRequested
+    std::condition_variable stopCondition;                 ///< Wakes the compaction thread on stop
+    bool stopRequested;                                    ///< Set by stopCompaction()
+};
+
+#endif // GALLERY_HPP
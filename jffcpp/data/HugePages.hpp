@@ -0,0 +1,448 @@
+#ifndef HUGE_PAGES_HPP
+#define HUGE_PAGES_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>       // For std::ifstream
+#include <sstream>       // For std::istringstream
+#include <algorithm>     // For std::min, std::max
+#include <mutex>         // For std::mutex, std::lock_guard
+#include <unordered_map> // For std::unordered_map
+#include <new>           // For std::bad_alloc, ::operator new
+#include <cstdint>       // For uintptr_t
+#include <type_traits>   // For std::true_type
+
+#ifdef __linux__
+#include <sys/mman.h> // For mmap, munmap, madvise
+#include <unistd.h>   // For pread
+#endif
+
+#if defined(__linux__) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+/**
+ * @brief Page size requested for a large buffer.
+ */
+enum class HugePageMode
+{
+    Off,         ///< Regular 4 KB pages
+    Transparent, ///< 2 MB aligned and advised with MADV_HUGEPAGE; the kernel backs it with transparent huge pages when it can
+    Explicit2MB, ///< Reserved 2 MB pages (MAP_HUGETLB), falling back to Transparent
+    Explicit1GB  ///< Reserved 1 GB pages (MAP_HUGETLB), falling back to Explicit2MB
+};
+
+/**
+ * @brief Memory backed by huge pages, as counted by the kernel in /proc/self/smaps.
+ */
+struct HugePageUsage
+{
+    size_t anonymousBytes = 0; ///< Transparent huge pages of anonymous memory (AnonHugePages)
+    size_t fileBytes = 0;      ///< Transparent huge pages of mapped files (FilePmdMapped)
+    size_t explicitBytes = 0;  ///< Reserved huge pages (Private_Hugetlb + Shared_Hugetlb)
+
+    size_t total() const
+    {
+        return anonymousBytes + fileBytes + explicitBytes;
+    }
+};
+
+/**
+ * @brief Allocation of large buffers on huge pages, and the report of what the kernel granted.
+ *
+ * Scanning or probing gigabytes through 4 KB pages misses the TLB on nearly every random access;
+ * a 2 MB page covers 512 times more memory per entry, a 1 GB page 262144 times more. Explicit
+ * pages come from the pool reserved by the administrator (vm.nr_hugepages, or hugepagesz=1G at
+ * boot) and are all-or-nothing: when the pool is empty the mapping fails and the next mode of the
+ * chain Explicit1GB, Explicit2MB, Transparent is tried, so a request never fails for lack of huge
+ * pages. Transparent pages depend on /sys/kernel/mm/transparent_hugepage/enabled ("always" or
+ * "madvise") and on the kernel finding free 2 MB blocks, so what a buffer actually got is only
+ * known afterwards, from usage() or usageOf().
+ *
+ * Every buffer is its own mapping, rounded up to its page size: use huge pages for the few large
+ * arrays of a store or an index, not for small objects. Elsewhere than Linux, buffers come from
+ * operator new and no huge page is ever reported.
+ */
+class HugePages
+{
+public:
+    static constexpr size_t size2MB = size_t(1) << 21; ///< Transparent and 2 MB explicit page
+    static constexpr size_t size1GB = size_t(1) << 30; ///< 1 GB explicit page
+
+    /**
+     * @brief Allocates a buffer, on huge pages when possible.
+     *
+     * @param bytes The size of the buffer.
+     * @param mode The preferred page size.
+     * @return void* The buffer, aligned to its page size. Release it with release().
+     * @throws std::bad_alloc if no memory is left at all.
+     */
+    static void *allocate(size_t bytes, HugePageMode mode)
+    {
+        bytes = std::max<size_t>(bytes, 1);
+#ifdef __linux__
+        if (mode == HugePageMode::Explicit1GB)
+        {
+            if (void *p = mapExplicit(bytes, size1GB, 30))
+                return remember(p, roundUp(bytes, size1GB), HugePageMode::Explicit1GB);
+            mode = HugePageMode::Explicit2MB;
+        }
+        if (mode == HugePageMode::Explicit2MB)
+        {
+            if (void *p = mapExplicit(bytes, size2MB, 21))
+                return remember(p, roundUp(bytes, size2MB), HugePageMode::Explicit2MB);
+            mode = HugePageMode::Transparent;
+        }
+        if (mode == HugePageMode::Transparent)
+        {
+            size_t length = roundUp(bytes, size2MB);
+            if (void *p = mapAligned(length, size2MB))
+            {
+                madvise(p, length, MADV_HUGEPAGE);
+                return remember(p, length, HugePageMode::Transparent);
+            }
+            throw std::bad_alloc();
+        }
+        size_t length = roundUp(bytes, pageSize());
+        void *p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+        return remember(p, length, HugePageMode::Off);
+#else
+        (void)mode;
+        return remember(::operator new(bytes), bytes, HugePageMode::Off);
+#endif
+    }
+
+    /**
+     * @brief Loads a whole file into memory, on huge pages when possible.
+     *
+     * Transparent maps the file itself at a 2 MB aligned address and advises it, so the page cache
+     * stays shared; the kernel uses huge pages there only if the filesystem supports them (large
+     * folios, or CONFIG_READ_ONLY_THP_FOR_FS and khugepaged). The explicit modes copy the file into
+     * reserved pages, which a regular file cannot be mapped to, and fall back to a copy in
+     * transparent huge pages.
+     *
+     * @param fd A file open for reading.
+     * @param bytes The size of the file.
+     * @param mode The preferred page size (not Off).
+     * @return void* The contents, or nullptr if the file could not be mapped or read.
+     */
+    static void *mapFile(int fd, size_t bytes, HugePageMode mode)
+    {
+#ifdef __linux__
+        if (mode == HugePageMode::Transparent)
+        {
+            size_t length = roundUp(bytes, size2MB);
+            void *reserved = mapAligned(length, size2MB);
+            if (reserved == nullptr)
+                return nullptr;
+            void *p = mmap(reserved, bytes, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                munmap(reserved, length);
+                return nullptr;
+            }
+            madvise(p, bytes, MADV_HUGEPAGE);
+            return remember(p, length, HugePageMode::Transparent);
+        }
+
+        void *p = nullptr;
+        try
+        {
+            p = allocate(bytes, mode);
+        }
+        catch (const std::bad_alloc &)
+        {
+            return nullptr;
+        }
+        char *out = static_cast<char *>(p);
+        size_t done = 0;
+        while (done < bytes)
+        {
+            ssize_t n = pread(fd, out + done, bytes - done, static_cast<off_t>(done));
+            if (n <= 0)
+            {
+                release(p);
+                return nullptr;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return p;
+#else
+        (void)fd;
+        (void)bytes;
+        (void)mode;
+        return nullptr;
+#endif
+    }
+
+    /**
+     * @brief Frees a buffer of allocate() or mapFile(). Does nothing for nullptr.
+     */
+    static void release(void *p)
+    {
+        if (p == nullptr)
+            return;
+        Block block;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            auto it = registry().find(p);
+            if (it == registry().end())
+                return;
+            block = it->second;
+            registry().erase(it);
+        }
+#ifdef __linux__
+        munmap(p, block.length);
+#else
+        ::operator delete(p);
+#endif
+    }
+
+    /**
+     * @brief Returns the mode a buffer was finally allocated with, after fallbacks (Off if unknown).
+     */
+    static HugePageMode modeOf(const void *p)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto it = registry().find(const_cast<void *>(p));
+        return it == registry().end() ? HugePageMode::Off : it->second.mode;
+    }
+
+    /**
+     * @brief Returns the huge pages of the whole process.
+     */
+    static HugePageUsage usage()
+    {
+        return scanSmaps(0, UINTPTR_MAX);
+    }
+
+    /**
+     * @brief Returns the huge pages of the mappings overlapping a buffer.
+     *
+     * The kernel counts per mapping, and adjacent anonymous mappings with the same flags are
+     * merged into one, so the result may include neighbors of the buffer; it is capped at the
+     * buffer size.
+     */
+    static HugePageUsage usageOf(const void *p, size_t bytes)
+    {
+        uintptr_t begin = reinterpret_cast<uintptr_t>(p);
+        HugePageUsage result = scanSmaps(begin, begin + bytes);
+        result.anonymousBytes = std::min(result.anonymousBytes, bytes);
+        result.fileBytes = std::min(result.fileBytes, bytes);
+        result.explicitBytes = std::min(result.explicitBytes, bytes);
+        return result;
+    }
+
+    /**
+     * @brief Returns true if transparent huge pages can be used (the policy is not "never").
+     */
+    static bool transparentEnabled()
+    {
+        std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+        std::string policy;
+        return std::getline(file, policy) && policy.find("[never]") == std::string::npos;
+    }
+
+    /**
+     * @brief Returns the number of free reserved pages of a size (size2MB or size1GB).
+     */
+    static size_t freePages(size_t pageBytes)
+    {
+        std::ifstream file("/sys/kernel/mm/hugepages/hugepages-" + std::to_string(pageBytes >> 10) + "kB/free_hugepages");
+        size_t pages = 0;
+        file >> pages;
+        return pages;
+    }
+
+private:
+    struct Block
+    {
+        size_t length = 0;                   ///< Bytes mapped
+        HugePageMode mode = HugePageMode::Off; ///< Mode obtained
+    };
+
+    static std::unordered_map<void *, Block> &registry()
+    {
+        static std::unordered_map<void *, Block> blocks;
+        return blocks;
+    }
+
+    static std::mutex &registryMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static void *remember(void *p, size_t length, HugePageMode mode)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry()[p] = {length, mode};
+        return p;
+    }
+
+    static size_t roundUp(size_t bytes, size_t to)
+    {
+        return (bytes + to - 1) / to * to;
+    }
+
+#ifdef __linux__
+    static size_t pageSize()
+    {
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    /**
+     * @brief Maps reserved pages of 2^log2 bytes, or returns nullptr when the pool is short.
+     */
+    static void *mapExplicit(size_t bytes, size_t pageBytes, int log2)
+    {
+        void *p = mmap(nullptr, roundUp(bytes, pageBytes), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (log2 << MAP_HUGE_SHIFT), -1, 0);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    /**
+     * @brief Maps length bytes at an address multiple of alignment, trimming an oversized mapping.
+     */
+    static void *mapAligned(size_t length, size_t alignment)
+    {
+        size_t oversized = length + alignment;
+        void *p = mmap(nullptr, oversized, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return nullptr;
+        uintptr_t begin = reinterpret_cast<uintptr_t>(p);
+        uintptr_t aligned = (begin + alignment - 1) / alignment * alignment;
+        if (aligned > begin)
+            munmap(p, aligned - begin);
+        size_t tail = begin + oversized - (aligned + length);
+        if (tail > 0)
+            munmap(reinterpret_cast<void *>(aligned + length), tail);
+        return reinterpret_cast<void *>(aligned);
+    }
+#endif
+
+    /**
+     * @brief Sums the huge page counters of the mappings overlapping [begin, end).
+     */
+    static HugePageUsage scanSmaps(uintptr_t begin, uintptr_t end)
+    {
+        HugePageUsage result;
+        std::ifstream file("/proc/self/smaps");
+        std::string line;
+        bool inside = false;
+        while (std::getline(file, line))
+        {
+            std::istringstream stream(line);
+            std::string field;
+            stream >> field;
+            if (field.empty())
+                continue;
+            if (field.back() != ':')
+            {
+                // Mapping header: "start-end perms offset device inode path"
+                size_t dash = field.find('-');
+                if (dash == std::string::npos)
+                    continue;
+                uintptr_t first = static_cast<uintptr_t>(std::stoull(field.substr(0, dash), nullptr, 16));
+                uintptr_t last = static_cast<uintptr_t>(std::stoull(field.substr(dash + 1), nullptr, 16));
+                inside = first < end && last > begin;
+                continue;
+            }
+            if (!inside)
+                continue;
+
+            size_t kb = 0;
+            stream >> kb;
+            if (field == "AnonHugePages:")
+                result.anonymousBytes += kb << 10;
+            else if (field == "FilePmdMapped:")
+                result.fileBytes += kb << 10;
+            else if (field == "Private_Hugetlb:" || field == "Shared_Hugetlb:")
+                result.explicitBytes += kb << 10;
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Standard allocator placing large arrays on huge pages (see HugePages).
+ *
+ * Arrays smaller than a 2 MB page, and all arrays when the mode is Off, come from operator new.
+ * The mode travels with the container on copy, move and swap.
+ *
+ * @tparam T The element type.
+ */
+template <typename T>
+class HugePageAllocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    HugePageAllocator(HugePageMode mode = HugePageMode::Off) noexcept : mode(mode) {}
+
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U> &other) noexcept : mode(other.getMode()) {}
+
+    T *allocate(size_t n)
+    {
+        size_t bytes = n * sizeof(T);
+        if (onHugePages(bytes))
+            return static_cast<T *>(HugePages::allocate(bytes, mode));
+        return static_cast<T *>(::operator new(bytes));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        if (onHugePages(n * sizeof(T)))
+            HugePages::release(p);
+        else
+            ::operator delete(p);
+    }
+
+    HugePageMode getMode() const
+    {
+        return mode;
+    }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U> &other) const
+    {
+        return mode == other.getMode();
+    }
+
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U> &other) const
+    {
+        return mode != other.getMode();
+    }
+
+private:
+    bool onHugePages(size_t bytes) const
+    {
+        return mode != HugePageMode::Off && bytes >= HugePages::size2MB;
+    }
+
+    HugePageMode mode; ///< Preferred page size
+};
+
+/**
+ * @brief Vector whose storage may be placed on huge pages.
+ */
+template <typename T>
+using HugeVector = std::vector<T, HugePageAllocator<T>>;
+
+/**
+ * @brief Returns the huge pages backing the storage of a vector.
+ */
+template <typename T, typename Allocator>
+HugePageUsage hugePageUsageOf(const std::vector<T, Allocator> &v)
+{
+    return HugePages::usageOf(v.data(), v.capacity() * sizeof(T));
+}
+
+#endif // HUGE_PAGES_HPP
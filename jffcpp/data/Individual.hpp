@@ -5,9 +5,18 @@
 #include <cmath>
 #include <string>
 #include <iostream>
-
+#include <atomic>
+#include <memory>
+#include "FeatureStats.hpp"
+
+/**
+ * @brief A person enrolled in the gallery: the IDs of their features and the statistics of their descriptors.
+ *
+ * Individuals are owned through std::shared_ptr (Gallery, loadIndividuals), so long-running readers
+ * such as SequentialSearcher::BatchScan can keep the ones they reference alive (weak_from_this).
+ */
 template <typename F>
-class Individual {
+class Individual : public std::enable_shared_from_this<Individual<F>> {
 public:
     /**
      * @brief Default constructor that initializes an empty Individual.
@@ -22,6 +31,49 @@ public:
         features.push_back(featureId);
     }
 
+    /**
+     * @brief Calculates the mean and standard deviation features in a single pass.
+     * @param features Vector containing all features.
+     */
+    void calculateStatistics(const std::vector<F>& features) {
+        FeatureStats stats;
+        for (const auto& feature : features) {
+            stats.add(feature.values);
+        }
+        setStatistics(stats);
+    }
+
+    /**
+     * @brief Replaces the mean and standard deviation by the given statistics.
+     * @param stats Statistics of all the descriptors of the Individual.
+     */
+    void setStatistics(const FeatureStats& stats) {
+        if (stats.count() == 0) return;
+
+        mean.values = stats.mean();
+        stddev.values = stats.stddev();
+        statisticsCount = stats.count();
+    }
+
+    /**
+     * @brief Updates the mean and standard deviation with descriptors added to the Individual,
+     * without reading the previous ones again.
+     * @param added Statistics of the new descriptors only.
+     */
+    void mergeStatistics(const FeatureStats& added) {
+        FeatureStats stats = statistics();
+        stats.merge(added);
+        setStatistics(stats);
+    }
+
+    /**
+     * @brief Returns the statistics summarized by the mean and standard deviation, mergeable
+     * with those of other descriptors (see FeatureStats::merge).
+     */
+    FeatureStats statistics() const {
+        return FeatureStats::fromMoments(statisticsCount, mean.values, stddev.values);
+    }
+
     /**
      * @brief Calculates the mean feature of the Individual.
      * @param features Vector containing all features.
@@ -42,7 +94,8 @@ public:
             meanValues[i] /= features.size();
         }
 
-        mean = F(0, meanValues);
+        mean.values = std::move(meanValues);
+        statisticsCount = features.size();
     }
 
     /**
@@ -66,7 +119,7 @@ public:
             stdValues[i] = std::sqrt(stdValues[i] / features.size());
         }
 
-        stddev = F(0, stdValues);
+        stddev.values = std::move(stdValues);
     }
 
     void print() const {
@@ -146,18 +199,48 @@ public:
         return id;
     }
 
+    /**
+     * @brief Makes sure automatically assigned IDs start at least at next.
+     *
+     * Used when Individuals are restored with their saved IDs.
+     */
+    static void reserveIds(uint32_t next) {
+        uint32_t current = nextId.load();
+        while (current < next && !nextId.compare_exchange_weak(current, next)) {
+        }
+    }
+
+    /**
+     * @brief Marks the Individual as retired (tombstone).
+     *
+     * Searchers skip features of retired Individuals until they are compacted away.
+     */
+    void retire() {
+        retired.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Returns true if the Individual was retired.
+     */
+    bool isRetired() const {
+        return retired.load(std::memory_order_acquire);
+    }
+
     uint32_t id;                    ///< Unique identifier of the Individual
     std::vector<uint32_t> features; ///< List of feature IDs associated with the Individual
     F mean;    ///< Mean feature
     F stddev;  ///< Standard deviation feature
     std::string name;               ///< Name of the Individual
+    uint32_t partition = 0;         ///< Partition index (e.g. finger position, 0 = none), see Gallery::getPartitionNames
+    uint64_t statisticsCount = 0;   ///< Number of descriptors summarized by mean and stddev
 
 private:
-    static uint32_t nextId;         ///< Next unique identifier
+    std::atomic<bool> retired{false}; ///< Tombstone set by retire()
+    static std::atomic<uint32_t> nextId; ///< Next unique identifier (Individuals are enrolled concurrently)
 };
 
 // Initialize the static member
 template <typename F>
-uint32_t Individual<F>::nextId = 1;
+std::atomic<uint32_t> Individual<F>::nextId{1};
 
 #endif // INDIVIDUAL_HPP
\ No newline at end of file
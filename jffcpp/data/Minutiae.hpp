@@ -0,0 +1,145 @@
+#ifndef MINUTIAE_HPP
+#define MINUTIAE_HPP
+
+#include <vector>
+#include <numeric>   // For std::iota
+#include <algorithm> // For std::stable_sort
+#include <limits>    // For std::numeric_limits
+#include <cmath>     // For std::isnan
+
+/**
+ * @brief Per-minutia metadata of a .tpt file, kept beside the descriptors in a compact
+ * structure-of-arrays (row i describes the i-th feature loaded from the file, or the feature
+ * with ID i for gallery tables filled with set()).
+ */
+struct Minutiae
+{
+    std::vector<float> x;     ///< Column of the minutia
+    std::vector<float> y;     ///< Row of the minutia
+    std::vector<float> theta; ///< Direction of the minutia
+    std::vector<float> score; ///< Quality score of the minutia
+
+    /**
+     * @brief Appends one minutia.
+     */
+    void push_back(float xVal, float yVal, float thetaVal, float scoreVal)
+    {
+        x.push_back(xVal);
+        y.push_back(yVal);
+        theta.push_back(thetaVal);
+        score.push_back(scoreVal);
+    }
+
+    /**
+     * @brief Writes one row, growing the table if needed (rows never written are NaN, see has).
+     */
+    void set(size_t row, float xVal, float yVal, float thetaVal, float scoreVal)
+    {
+        if (row >= size())
+        {
+            const float missing = std::numeric_limits<float>::quiet_NaN();
+            x.resize(row + 1, missing);
+            y.resize(row + 1, missing);
+            theta.resize(row + 1, missing);
+            score.resize(row + 1, missing);
+        }
+        x[row] = xVal;
+        y[row] = yVal;
+        theta[row] = thetaVal;
+        score[row] = scoreVal;
+    }
+
+    /**
+     * @brief Returns true if the row exists and was written (tables filled with set() by feature ID
+     * have gaps, e.g. for features loaded elsewhere or enrolled later).
+     */
+    bool has(size_t row) const
+    {
+        return row < size() && !std::isnan(x[row]);
+    }
+
+    /**
+     * @brief Reserves space for n minutiae.
+     */
+    void reserve(size_t n)
+    {
+        x.reserve(n);
+        y.reserve(n);
+        theta.reserve(n);
+        score.reserve(n);
+    }
+
+    /**
+     * @brief Returns the number of minutiae.
+     */
+    size_t size() const
+    {
+        return score.size();
+    }
+
+    /**
+     * @brief Returns the minutia indices sorted by decreasing quality score (stable).
+     */
+    std::vector<size_t> orderByScore() const
+    {
+        std::vector<size_t> order(size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+                         { return score[a] > score[b]; });
+        return order;
+    }
+
+    /**
+     * @brief Selects the minutiae worth searching: those scoring at least minScore, at most
+     * maxCount of them, best score first.
+     *
+     * Low-quality latent minutiae mostly add noise votes at the cost of a full scan each, so
+     * pruning them trades a little accuracy for throughput.
+     *
+     * @param minScore The minimum quality score.
+     * @param maxCount The maximum number of minutiae kept.
+     * @return std::vector<size_t> Indices of the selected minutiae, in search order.
+     */
+    std::vector<size_t> select(float minScore, size_t maxCount = std::numeric_limits<size_t>::max()) const
+    {
+        std::vector<size_t> order = orderByScore();
+        size_t kept = 0;
+        while (kept < order.size() && kept < maxCount && score[order[kept]] >= minScore)
+        {
+            ++kept;
+        }
+        order.resize(kept);
+        return order;
+    }
+
+    /**
+     * @brief Returns the rows at the given indices, in that order.
+     */
+    Minutiae subset(const std::vector<size_t> &indices) const
+    {
+        Minutiae selected;
+        selected.reserve(indices.size());
+        for (size_t i : indices)
+        {
+            selected.push_back(x[i], y[i], theta[i], score[i]);
+        }
+        return selected;
+    }
+};
+
+/**
+ * @brief Returns the features at the given indices (e.g. from Minutiae::select), in that order.
+ */
+template <typename F>
+std::vector<F> selectFeatures(const std::vector<F> &features, const std::vector<size_t> &indices)
+{
+    std::vector<F> selected;
+    selected.reserve(indices.size());
+    for (size_t i : indices)
+    {
+        selected.push_back(features[i]);
+    }
+    return selected;
+}
+
+#endif // MINUTIAE_HPP
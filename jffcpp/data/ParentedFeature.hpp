@@ -51,4 +51,44 @@ public:
     Individual<ParentedFeature>* representative; ///< Pointer to the representative Individual
 };
 
+/**
+ * @brief A parented feature is retired when its representative Individual is.
+ */
+inline bool isRetired(const ParentedFeature& f) {
+    return f.representative != nullptr && f.representative->isRetired();
+}
+
+/**
+ * @brief Returns the ID of the representative Individual, or 0 if there is none.
+ */
+inline uint32_t representativeId(const ParentedFeature& f) {
+    return f.representative != nullptr ? f.representative->getId() : 0;
+}
+
+/**
+ * @brief Plain features have no representative Individual.
+ */
+inline const Individual<ParentedFeature>* representativeOf(const Feature&) {
+    return nullptr;
+}
+
+/**
+ * @brief Returns the representative Individual of a parented feature (may be nullptr).
+ */
+inline const Individual<ParentedFeature>* representativeOf(const ParentedFeature& f) {
+    return f.representative;
+}
+
+/**
+ * @brief Plain features have no parent to restore.
+ */
+inline void setRepresentative(Feature&, Individual<ParentedFeature>*) {}
+
+/**
+ * @brief Restores the representative Individual of a parented feature.
+ */
+inline void setRepresentative(ParentedFeature& f, Individual<ParentedFeature>* representative) {
+    f.representative = representative;
+}
+
 #endif // PARENTEDFEATURE_HPP
\ No newline at end of file
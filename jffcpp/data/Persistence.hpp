@@ -0,0 +1,169 @@
+#ifndef PERSISTENCE_HPP
+#define PERSISTENCE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional> // For std::function
+#include <cstring>    // For std::memcpy
+#include <algorithm>  // For std::max
+#include <stdexcept>  // For std::runtime_error
+#include "BinaryFile.hpp"
+#include "ParentedFeature.hpp"
+
+/**
+ * @brief Maps a saved Individual ID back to the loaded Individual (nullptr if unknown).
+ */
+using IndividualResolver = std::function<Individual<ParentedFeature> *(uint32_t)>;
+
+/**
+ * @brief Header section describing a persisted searcher or index.
+ */
+struct IndexHeader
+{
+    static constexpr uint32_t currentVersion = 1;
+
+    std::string kind;                          ///< Type of the searcher
+    std::string metric;                        ///< Name of the distance function
+    uint32_t version = currentVersion;         ///< Version of the searcher layout
+    uint32_t dimension = 0;                    ///< Dimension of the descriptors
+    std::map<std::string, std::string> params; ///< Build parameters
+    std::vector<uint64_t> segmentSizes;        ///< Number of objects per segment
+
+    /**
+     * @brief Writes the header as its own section.
+     */
+    void write(BinaryWriter &writer, const std::string &name) const
+    {
+        writer.beginSection(name);
+        writer.writeString(kind);
+        writer.writeString(metric);
+        writer.write(version);
+        writer.write(dimension);
+        writer.write(uint32_t(params.size()));
+        for (const auto &param : params)
+        {
+            writer.writeString(param.first);
+            writer.writeString(param.second);
+        }
+        writer.write(uint64_t(segmentSizes.size()));
+        writer.writeArray(segmentSizes.data(), segmentSizes.size());
+        writer.endSection();
+    }
+
+    /**
+     * @brief Reads the header and checks it matches the expected searcher type and metric.
+     *
+     * @throws std::runtime_error on a kind, metric or version mismatch.
+     */
+    static IndexHeader read(const BinaryReader &reader, const std::string &name, const std::string &expectedKind, const std::string &expectedMetric)
+    {
+        SectionReader section = reader.section(name);
+        IndexHeader header;
+        header.kind = section.readString();
+        header.metric = section.readString();
+        header.version = section.read<uint32_t>();
+        header.dimension = section.read<uint32_t>();
+        uint32_t paramCount = section.read<uint32_t>();
+        for (uint32_t i = 0; i < paramCount; ++i)
+        {
+            std::string key = section.readString();
+            header.params[key] = section.readString();
+        }
+        header.segmentSizes.resize(section.readCount<uint64_t>(sizeof(uint64_t)));
+        section.readArray(header.segmentSizes.data(), header.segmentSizes.size());
+
+        if (header.kind != expectedKind)
+            throw std::runtime_error("Saved index is a " + header.kind + ", expected " + expectedKind);
+        if (header.metric != expectedMetric)
+            throw std::runtime_error("Saved index uses the " + header.metric + " distance, expected " + expectedMetric);
+        if (header.version != currentVersion)
+            throw std::runtime_error("Unsupported " + header.kind + " version " + std::to_string(header.version));
+        return header;
+    }
+};
+
+/**
+ * @brief Writes features as one section: IDs, representative IDs, then a row-major descriptor matrix.
+ *
+ * @param writer The writer.
+ * @param name The name of the section.
+ * @param features The features, all of the same dimension.
+ */
+template <typename T>
+void writeFeatures(BinaryWriter &writer, const std::string &name, const std::vector<const T *> &features)
+{
+    uint32_t dimension = features.empty() ? 0 : static_cast<uint32_t>(features[0]->size());
+
+    writer.beginSection(name);
+    writer.write(uint64_t(features.size()));
+    writer.write(dimension);
+    for (const T *f : features)
+    {
+        writer.write(f->getId());
+    }
+    for (const T *f : features)
+    {
+        writer.write(representativeId(*f));
+    }
+    for (const T *f : features)
+    {
+        if (f->size() != dimension)
+            throw std::runtime_error("Features of section " + name + " have different dimensions");
+        writer.writeArray(f->values.data(), dimension);
+    }
+    writer.endSection();
+}
+
+/**
+ * @brief Reads features written by writeFeatures, restoring their IDs and representatives.
+ *
+ * @param reader The reader.
+ * @param name The name of the section.
+ * @param resolve Maps saved Individual IDs to loaded Individuals.
+ * @return std::vector<T> The features.
+ */
+template <typename T>
+std::vector<T> readFeatures(const BinaryReader &reader, const std::string &name, const IndividualResolver &resolve)
+{
+    SectionReader section = reader.section(name);
+    uint64_t count = section.read<uint64_t>();
+    uint32_t dimension = section.read<uint32_t>();
+
+    // Validate the untrusted header against the payload before allocating anything
+    uint64_t recordBytes = 2 * sizeof(uint32_t) + static_cast<uint64_t>(dimension) * sizeof(float);
+    if (count > section.remaining() / recordBytes)
+        throw std::runtime_error("Section " + name + " is truncated");
+
+    std::vector<uint32_t> ids(count), owners(count);
+    section.readArray(ids.data(), count);
+    section.readArray(owners.data(), count);
+    const char *values = section.view(count * dimension * sizeof(float));
+
+    std::vector<T> features;
+    features.reserve(count);
+    uint32_t maxId = 0;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        // Default constructed, so no new ID is taken: the saved one is restored
+        T f;
+        f.values.resize(dimension);
+        std::memcpy(f.values.data(), values + i * dimension * sizeof(float), dimension * sizeof(float));
+        f.id = ids[i];
+        maxId = std::max(maxId, ids[i]);
+
+        if (owners[i] != 0)
+        {
+            Individual<ParentedFeature> *representative = resolve ? resolve(owners[i]) : nullptr;
+            if (representative == nullptr)
+                throw std::runtime_error("Unknown individual " + std::to_string(owners[i]) + " in section " + name);
+            setRepresentative(f, representative);
+        }
+        features.push_back(std::move(f));
+    }
+    Feature::reserveIds(maxId + 1);
+
+    return features;
+}
+
+#endif // PERSISTENCE_HPP
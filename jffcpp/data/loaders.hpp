@@ -8,8 +8,14 @@
 #include <ostream>
 #include <chrono>
 #include <memory>
+#include <functional> // For std::function
+#include <algorithm>  // For std::sort, std::stable_sort
+#include <numeric>    // For std::iota
+#include <cctype>     // For std::isdigit
 #include "ParentedFeature.hpp"
 #include "Individual.hpp"
+#include "Minutiae.hpp"
+#include "FeatureStats.hpp"
 #include "../dependencies/npy.hpp"
 #include "../math/LinAlg.hpp"
 
@@ -23,11 +29,12 @@ namespace fs = std::filesystem;
  * 
  * @param filename The name of the .npy file to be loaded.
  * @param log_info If true, logs information about the loading process.
+ * @param stats If not null, accumulates the statistics of the returned features.
  * @return A vector of features extracted from the .npy file.
  * @tparam F Type of the features to be loaded.
  */
 template <typename F>
-std::vector<F> loadNpy(std::string filename, bool log_info)
+std::vector<F> loadNpy(std::string filename, bool log_info, FeatureStats *stats = nullptr)
 {
     std::vector<F> dataFeatures;
 
@@ -53,6 +60,8 @@ std::vector<F> loadNpy(std::string filename, bool log_info)
         // Use iterators to avoid copying data to a new vector
         auto startIt = data.begin() + i * shape[1];
         auto endIt = startIt + shape[1];
+        if (stats)
+            stats->add(&*startIt, shape[1]);
 
         dataFeatures.emplace_back(std::vector<float>(startIt, endIt));
     }
@@ -69,44 +78,64 @@ std::vector<F> loadNpy(std::string filename, bool log_info)
 }
 
 /**
- * @brief Loads data from a .tpt file and converts it into a list of feature vectors.
- *
- * This function reads a specified .tpt file, extracts the data, and converts it into a list of feature vectors.
+ * @brief Parses .tpt content from a stream (a file, or a payload received in memory).
  *
- * @param filepath The path to the .tpt file to be loaded.
- * @return A vector of feature vectors extracted from the .tpt file.
+ * @param stream The .tpt content.
+ * @param minutiae If not null, receives x, y, theta and score of each returned feature, in order.
+ * @param stats If not null, accumulates the statistics of the returned (normalized) features while they are parsed.
+ * @return A vector of feature vectors.
  * @tparam F Type of the feature vectors to be loaded.
  */
 template <typename F>
-std::vector<F> loadTpt(std::string filename, bool log_info)
+std::vector<F> parseTpt(std::istream &stream, Minutiae *minutiae = nullptr, FeatureStats *stats = nullptr)
 {
-    auto start = std::chrono::high_resolution_clock::now();
-
-    std::ifstream file(filename);
-    if (!file.is_open())
-    {
-        throw std::runtime_error("Could not open file: " + filename);
-    }
-
     std::string line;
 
     // Skip the first line
-    std::getline(file, line);
+    std::getline(stream, line);
 
     // Read the header line
-    std::getline(file, line);
+    std::getline(stream, line);
     std::istringstream headerStream(line);
-    int featureNum, height, width, dimensions;
+    int featureNum = 0, height = 0, width = 0, dimensions = 0;
     headerStream >> featureNum >> height >> width >> dimensions;
+    if (featureNum < 0 || dimensions <= 0)
+    {
+        throw std::runtime_error("Invalid .tpt header: " + line);
+    }
 
-    // Allocate space for the feature vectors
+    // The header may come from an untrusted payload: a feature line holds 4 + dimensions numbers of
+    // at least two bytes each, so a count the rest of the content cannot hold is rejected
     std::vector<F> dataFeatures;
-    dataFeatures.reserve(featureNum);
-    std::vector<float> zValues(dimensions);
+    std::streamoff here = stream.tellg();
+    if (here >= 0)
+    {
+        stream.seekg(0, std::ios::end);
+        uint64_t remaining = static_cast<uint64_t>(stream.tellg() - here);
+        stream.seekg(here);
+        if (static_cast<uint64_t>(featureNum) > remaining / (2 * (4 + static_cast<uint64_t>(dimensions))))
+        {
+            throw std::runtime_error("Invalid .tpt header, more features than the content holds: " + line);
+        }
+
+        // Allocate space for the feature vectors
+        dataFeatures.reserve(featureNum);
+        if (minutiae)
+            minutiae->reserve(minutiae->size() + featureNum);
+    }
+    std::vector<float> zValues;
 
     // Process each feature line
-    while (std::getline(file, line))
+    while (std::getline(stream, line))
     {
+        // Sized from the first line, which must be long enough to hold the descriptor
+        if (zValues.empty())
+        {
+            if (line.size() < static_cast<size_t>(dimensions))
+                throw std::runtime_error("Invalid .tpt line, shorter than the descriptor dimension: " + line);
+            zValues.resize(dimensions);
+        }
+
         std::istringstream lineStream(line);
         float x, y, theta, score;
         lineStream >> x >> y >> theta >> score;
@@ -123,9 +152,42 @@ std::vector<F> loadTpt(std::string filename, bool log_info)
             val /= norm;
         }
 
+        if (stats)
+            stats->add(zValues);
         dataFeatures.emplace_back(zValues);
+        if (minutiae)
+            minutiae->push_back(x, y, theta, score);
     }
 
+    return dataFeatures;
+}
+
+/**
+ * @brief Loads data from a .tpt file and converts it into a list of feature vectors.
+ *
+ * This function reads a specified .tpt file, extracts the data, and converts it into a list of feature vectors.
+ * The position, direction and quality of each minutia can be kept in a side array.
+ *
+ * @param filepath The path to the .tpt file to be loaded.
+ * @param log_info If true, logs information about the loading process.
+ * @param minutiae If not null, receives x, y, theta and score of each returned feature, in order.
+ * @param stats If not null, accumulates the statistics of the returned (normalized) features while they are parsed.
+ * @return A vector of feature vectors extracted from the .tpt file.
+ * @tparam F Type of the feature vectors to be loaded.
+ */
+template <typename F>
+std::vector<F> loadTpt(std::string filename, bool log_info, Minutiae *minutiae = nullptr, FeatureStats *stats = nullptr)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+
+    std::vector<F> dataFeatures = parseTpt<F>(file, minutiae, stats);
+
     file.close();
 
     if (log_info)
@@ -147,20 +209,22 @@ std::vector<F> loadTpt(std::string filename, bool log_info)
  *
  * @param filename The name of the file to be loaded.
  * @param log_info If true, logs information about the loading process.
+ * @param minutiae If not null, receives the minutia metadata (.tpt files only).
+ * @param stats If not null, accumulates the statistics of the returned features.
  * @return A vector of features extracted from the file.
  * @tparam F Type of the features to be loaded.
  */
 template <typename F>
-std::vector<F> loadFile(const std::string &filename, bool log_info)
+std::vector<F> loadFile(const std::string &filename, bool log_info, Minutiae *minutiae = nullptr, FeatureStats *stats = nullptr)
 {
     std::string extension = fs::path(filename).extension().string();
     if (extension == ".npy")
     {
-        return loadNpy<F>(filename, log_info);
+        return loadNpy<F>(filename, log_info, stats);
     }
     else if (extension == ".tpt")
     {
-        return loadTpt<F>(filename, log_info);
+        return loadTpt<F>(filename, log_info, minutiae, stats);
     }
     else
     {
@@ -169,23 +233,59 @@ std::vector<F> loadFile(const std::string &filename, bool log_info)
 }
 
 
+/**
+ * @brief Extracts a partition key from a file name.
+ */
+using PartitionKey = std::function<std::string(const std::string &filename)>;
+
+/**
+ * @brief Partition key of the finger position, encoded as "_dNN" in gallery file names
+ * (e.g. "11783_90702_d10.tpt" gives "d10"). Files without it give "".
+ */
+inline std::string fingerPosition(const std::string &filename)
+{
+    std::string stem = fs::path(filename).stem().string();
+    size_t pos = stem.rfind("_d");
+    if (pos == std::string::npos || pos + 2 >= stem.size())
+        return "";
+    for (size_t i = pos + 2; i < stem.size(); ++i)
+    {
+        if (!std::isdigit(static_cast<unsigned char>(stem[i])))
+            return "";
+    }
+    return stem.substr(pos + 1);
+}
+
 /**
  * @brief Loads individuals and their features from a specified directory.
  * 
  * This function iterates through all files in the given directory path, 
  * loads individuals from files with a ".npy" or ".tpt" extension, and extracts their features.
  * It also associates each feature with the individual it belongs to and vice versa.
- * Finally, it calculates the mean and standard deviation for each individual.
+ * The mean and standard deviation of each individual are accumulated while its file is parsed.
+ *
+ * With a partition key, Individuals are grouped by the key of their file name: partitions are
+ * numbered from 1 in key order, and the Individuals and features of each partition are stored
+ * contiguously. Only the storage order changes: Individual and feature IDs keep the loading order.
+ * Partition 0 is reserved for files without a key (an empty key), so a mask allowing a real
+ * partition never admits them.
  * 
  * @param directoryPath The path to the directory containing the files.
  * @param log_info If true, logs information about the loading process.
+ * @param progress_bar If true, shows a progress bar.
+ * @param partitionKey If set, extracts the partition of each file (e.g. fingerPosition).
+ * @param partitionNames If not null, receives the key of each partition index ("" at index 0).
+ * @param geometry If not null, receives the minutia metadata of .tpt files, row = feature ID.
  * @return A pair consisting of a vector of individual pointers and a vector of features.
  */
-std::pair<std::vector<std::shared_ptr<Individual<ParentedFeature>>>, std::vector<ParentedFeature>> loadIndividuals(const std::string &directoryPath, bool log_info, bool progress_bar = false)
+std::pair<std::vector<std::shared_ptr<Individual<ParentedFeature>>>, std::vector<ParentedFeature>> loadIndividuals(const std::string &directoryPath, bool log_info, bool progress_bar = false,
+                                                                                                                    const PartitionKey &partitionKey = nullptr, std::vector<std::string> *partitionNames = nullptr,
+                                                                                                                    Minutiae *geometry = nullptr)
 {
     using feature = ParentedFeature;
     std::vector<std::shared_ptr<Individual<ParentedFeature>>> individuals;
-    std::vector<feature> allFeatures;
+    std::vector<std::vector<feature>> individualFeatures;
+    std::vector<std::string> keys;
 
     auto start = std::chrono::high_resolution_clock::now();
 
@@ -203,22 +303,27 @@ std::pair<std::vector<std::shared_ptr<Individual<ParentedFeature>>>, std::vector
             auto individual = std::make_shared<Individual<ParentedFeature>>();
             individual->name = entry.path().filename().string();
 
-            // Load all features from the file
-            std::vector<feature> fileFeatures = loadFile<feature>(entry.path().string(), false);
+            // Load all features from the file, with their statistics in the same pass
+            Minutiae fileMinutiae;
+            FeatureStats stats;
+            std::vector<feature> fileFeatures = loadFile<feature>(entry.path().string(), false, geometry ? &fileMinutiae : nullptr, &stats);
 
-            for (auto &f : fileFeatures)
+            for (size_t i = 0; i < fileFeatures.size(); ++i)
             {
                 // Associate all features with the individual
+                auto &f = fileFeatures[i];
                 f.representative = individual.get();
                 individual->addFeature(f.getId());
-                allFeatures.push_back(f);
+
+                if (i < fileMinutiae.size())
+                    geometry->set(f.getId(), fileMinutiae.x[i], fileMinutiae.y[i], fileMinutiae.theta[i], fileMinutiae.score[i]);
             }
 
-            // Calculate the mean and std for the individual
-            individual->calculateMean(fileFeatures);
-            individual->calculateStd(fileFeatures);
+            individual->setStatistics(stats);
 
             individuals.push_back(individual);
+            individualFeatures.push_back(std::move(fileFeatures));
+            keys.push_back(partitionKey ? partitionKey(individual->name) : "");
         }
 
         processedFiles++;
@@ -233,11 +338,41 @@ std::pair<std::vector<std::shared_ptr<Individual<ParentedFeature>>>, std::vector
 
     std::cout << std::endl;
 
+    // Number the partitions in key order from 1 ("" sorts first and is partition 0) and store each one contiguously
+    std::vector<std::string> names(keys);
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    if (names.empty() || !names[0].empty())
+        names.insert(names.begin(), "");
+
+    std::vector<size_t> order(individuals.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    for (size_t i = 0; i < individuals.size(); ++i)
+    {
+        individuals[i]->partition = static_cast<uint32_t>(std::lower_bound(names.begin(), names.end(), keys[i]) - names.begin());
+    }
+    std::stable_sort(order.begin(), order.end(), [&individuals](size_t a, size_t b)
+                     { return individuals[a]->partition < individuals[b]->partition; });
+
+    std::vector<std::shared_ptr<Individual<ParentedFeature>>> sortedIndividuals;
+    std::vector<feature> allFeatures;
+    for (size_t i : order)
+    {
+        sortedIndividuals.push_back(individuals[i]);
+        allFeatures.insert(allFeatures.end(), individualFeatures[i].begin(), individualFeatures[i].end());
+    }
+    individuals.swap(sortedIndividuals);
+
+    if (partitionNames)
+        *partitionNames = partitionKey ? names : std::vector<std::string>();
+
     if (log_info)
     {
         auto end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> duration = (end - start) * 1000; // milliseconds
         std::cout << "Loaded " << individuals.size() << " individuals\n";
+        if (partitionKey)
+            std::cout << "In " << names.size() - 1 << " partitions\n";
         std::cout << "Added " << allFeatures.size() << " features\n";
         std::cout << "Time: " << duration.count() << " ms\n\n";
     }
@@ -3,14 +3,41 @@
 
 #include "data/Feature.hpp"
 #include "data/Individual.hpp"
+#include "data/FeatureStats.hpp"
+#include "data/Minutiae.hpp"
+#include "data/Bitmap.hpp"
 #include "data/loaders.hpp"
+#include "data/Gallery.hpp"
+#include "data/HugePages.hpp"
 
 #include "indexing/NNList.hpp"
+#include "indexing/VoteAggregator.hpp"
 #include "indexing/NNResults.hpp"
+#include "indexing/SearchBudget.hpp"
+#include "indexing/SearchFilter.hpp"
+#include "indexing/IncrementalIdentifier.hpp"
 #include "indexing/SequentialSearcher.hpp"
 #include "indexing/ShiftSequentialSearcher.hpp"
+#include "indexing/PivotSearcher.hpp"
+#include "indexing/CascadeSearcher.hpp"
+#include "indexing/GeometricVerifier.hpp"
+#include "indexing/TripletIndex.hpp"
+#include "indexing/SelfJoin.hpp"
+#include "indexing/KnnGraph.hpp"
+#include "indexing/StreamingSearcher.hpp"
+#include "indexing/MemoryBudget.hpp"
+#include "indexing/NumaSearcher.hpp"
 
 #include "math/DistanceFunction.hpp"
 #include "math/LinAlg.hpp"
+#include "math/PCA.hpp"
+
+#include "server/Protocol.hpp"
+#include "server/Socket.hpp"
+#include "server/LatencyRecorder.hpp"
+#include "server/SearchServer.hpp"
+#include "server/SearchClient.hpp"
+#include "server/ShardRouter.hpp"
+#include "server/LocalShardCluster.hpp"
 
 #endif // INCLUDES_JFF_HPP
\ No newline at end of file
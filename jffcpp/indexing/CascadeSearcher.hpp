@@ -0,0 +1,226 @@
+#ifndef CASCADE_SEARCHER_HPP
+#define CASCADE_SEARCHER_HPP
+
+#include <vector>
+#include <mutex>         // For std::mutex, std::lock_guard
+#include <unordered_map> // For std::unordered_map
+#include <algorithm>     // For std::remove_if
+#include "SequentialSearcher.hpp"
+#include "VoteAggregator.hpp"
+
+/**
+ * @brief Coarse-to-fine search: a small index over one summary per Individual picks the
+ * candidates, then the minutia-level searcher only scans their objects.
+ *
+ * Stage 1 keeps a copy of every Individual's mean in its own SequentialSearcher; each query
+ * minutia votes (WeightedVote) for the Individuals whose means are among its
+ * summaryNeighbors nearest, and the shortlistSize best become the shortlist. Stage 2 runs
+ * SequentialSearcher::knnAmong on the fine searcher (sequential or shift) over the shortlist.
+ *
+ * Attach it to the same Gallery as the fine searcher to keep the summaries in sync. The summaries
+ * copy the means when an Individual is first seen: call refresh() after changing statistics
+ * (mergeStatistics, setStatistics, PCA::projectAll) so stage 1 ranks against the new means.
+ *
+ * @tparam T A parented feature type (each object must know its Individual).
+ * @tparam DistanceFunc The type of the distance function.
+ */
+template <typename T, typename DistanceFunc>
+class CascadeSearcher : public GalleryIndex<T>
+{
+public:
+    /**
+     * @brief Constructs a CascadeSearcher.
+     *
+     * @param distFunc The distance function used between minutiae and summaries.
+     * @param fine The minutia-level searcher of stage 2.
+     * @param shortlistSize The number M of Individuals passed to stage 2.
+     * @param summaryNeighbors The number of summaries each query minutia votes for.
+     */
+    CascadeSearcher(DistanceFunc &distFunc, const SequentialSearcher<T, DistanceFunc> &fine, size_t shortlistSize = 50, size_t summaryNeighbors = 10)
+        : fine(fine), summaries(distFunc), shortlistSize(shortlistSize), summaryNeighbors(summaryNeighbors) {}
+
+    /**
+     * @brief Adds the summaries of the Individuals owning the given objects.
+     *
+     * @param objs Objects of the fine searcher; Individuals already summarized, or without a
+     * mean yet, are skipped.
+     */
+    void addAll(const std::vector<T> &objs)
+    {
+        std::lock_guard<std::mutex> lock(summaryMutex);
+        std::vector<T> newSummaries;
+        for (const auto &obj : objs)
+        {
+            auto *representative = obj.representative;
+            if (representative == nullptr || representative->mean.size() == 0 || summaryIndex.count(representative->getId()) > 0)
+                continue;
+
+            summaryIndex[representative->getId()] = summaryList.size();
+            summaryList.push_back(makeSummary(*representative));
+            newSummaries.push_back(summaryList.back());
+        }
+        summaries.addAll(newSummaries);
+    }
+
+    /**
+     * @brief Rebuilds the summary of an Individual whose statistics changed (setStatistics,
+     * mergeStatistics), adding it if it has a mean now or dropping it if it has none.
+     *
+     * @param individual The Individual.
+     */
+    void refresh(Individual<ParentedFeature> &individual)
+    {
+        std::lock_guard<std::mutex> lock(summaryMutex);
+        auto it = summaryIndex.find(individual.getId());
+        if (it == summaryIndex.end())
+        {
+            if (individual.mean.size() == 0)
+                return;
+            summaryIndex[individual.getId()] = summaryList.size();
+            summaryList.push_back(makeSummary(individual));
+            summaries.addAll({summaryList.back()});
+            return;
+        }
+
+        if (individual.mean.size() == 0)
+        {
+            summaryList.erase(summaryList.begin() + it->second);
+            reindex();
+        }
+        else
+        {
+            summaryList[it->second].values = individual.mean.values;
+        }
+        summaries.replaceAll(summaryList);
+    }
+
+    /**
+     * @brief Rebuilds every summary from the current means, e.g. after PCA::projectAll changed
+     * the dimension of the gallery.
+     */
+    void refresh()
+    {
+        std::lock_guard<std::mutex> lock(summaryMutex);
+        std::vector<T> refreshed;
+        refreshed.reserve(summaryList.size());
+        for (auto &summary : summaryList)
+        {
+            if (summary.representative->mean.size() == 0)
+                continue;
+            summary.values = summary.representative->mean.values;
+            refreshed.push_back(std::move(summary));
+        }
+        summaryList.swap(refreshed);
+        reindex();
+        summaries.replaceAll(summaryList);
+    }
+
+    /**
+     * @brief Adds the summaries of newly enrolled Individuals.
+     *
+     * @param objs The enrolled objects.
+     */
+    void onEnroll(const std::vector<T> &objs) override
+    {
+        addAll(objs);
+    }
+
+    /**
+     * @brief Removes the summaries of retired Individuals.
+     *
+     * @return size_t The number of summaries removed.
+     */
+    size_t compact() override
+    {
+        std::lock_guard<std::mutex> lock(summaryMutex);
+        summaryList.erase(std::remove_if(summaryList.begin(), summaryList.end(), [](const T &summary)
+                                         { return isRetired(summary); }),
+                          summaryList.end());
+        reindex();
+        return summaries.compact();
+    }
+
+    /**
+     * @brief Stage 1: returns the IDs of the shortlistSize most voted Individuals, best first.
+     *
+     * @param queries The query minutiae.
+     * @param filter Restricts the candidate Individuals.
+     */
+    std::vector<uint32_t> shortlist(std::vector<T> &queries, const SearchFilter &filter = SearchFilter()) const
+    {
+        VoteAggregator<WeightedVote> votes;
+        for (auto &query : queries)
+        {
+            votes.add(summaries.knn(query, summaryNeighbors, filter));
+        }
+
+        std::vector<uint32_t> individualIds;
+        for (const auto &best : votes.top(shortlistSize))
+        {
+            individualIds.push_back(best.first);
+        }
+        return individualIds;
+    }
+
+    /**
+     * @brief Searches the k-nearest neighbors of every query minutia among the shortlisted Individuals.
+     *
+     * @param queries The query minutiae.
+     * @param k The number of nearest neighbors per query.
+     * @param filter Restricts the candidate Individuals.
+     * @return std::vector<NNList<T>> The neighbors of each query.
+     */
+    std::vector<NNList<T>> knn(std::vector<T> &queries, size_t k, const SearchFilter &filter = SearchFilter()) const
+    {
+        return fine.knnAmong(queries, k, shortlist(queries, filter), filter);
+    }
+
+    /**
+     * @brief Sets the number M of Individuals passed to stage 2.
+     */
+    void setShortlistSize(size_t size)
+    {
+        shortlistSize = size;
+    }
+
+    /**
+     * @brief Returns the number of summarized Individuals.
+     */
+    size_t size() const
+    {
+        return summaries.size();
+    }
+
+private:
+    /**
+     * @brief Returns a summary holding the current mean of an Individual.
+     */
+    static T makeSummary(Individual<ParentedFeature> &individual)
+    {
+        T summary(individual.mean.values);
+        setRepresentative(summary, &individual);
+        return summary;
+    }
+
+    /**
+     * @brief Recomputes summaryIndex from summaryList. Requires summaryMutex.
+     */
+    void reindex()
+    {
+        summaryIndex.clear();
+        for (size_t i = 0; i < summaryList.size(); ++i)
+        {
+            summaryIndex[summaryList[i].representative->getId()] = i;
+        }
+    }
+
+    const SequentialSearcher<T, DistanceFunc> &fine;   ///< Minutia-level searcher
+    SequentialSearcher<T, DistanceFunc> summaries;     ///< One mean per Individual
+    std::vector<T> summaryList;                        ///< Summaries held by summaries, in insertion order
+    std::unordered_map<uint32_t, size_t> summaryIndex; ///< Position of each Individual's summary in summaryList
+    std::mutex summaryMutex;                           ///< Serializes addAll, refresh and compact
+    size_t shortlistSize;                            ///< Individuals passed to stage 2
+    size_t summaryNeighbors;                         ///< Summaries voted per query minutia
+};
+
+#endif // CASCADE_SEARCHER_HPP
@@ -0,0 +1,36 @@
+#ifndef GALLERY_INDEX_HPP
+#define GALLERY_INDEX_HPP
+
+#include <vector>
+#include <cstddef> // For std::size_t
+
+/**
+ * @brief Interface of a search structure that follows the enrollments of a Gallery.
+ *
+ * Retirement needs no notification: features of retired Individuals are skipped while
+ * searching (see isRetired) and physically removed on compact().
+ *
+ * @tparam T The type of the objects stored in the index.
+ */
+template <typename T>
+class GalleryIndex
+{
+public:
+    virtual ~GalleryIndex() = default;
+
+    /**
+     * @brief Called after new objects were enrolled in the gallery.
+     *
+     * @param objs The new objects.
+     */
+    virtual void onEnroll(const std::vector<T> &objs) = 0;
+
+    /**
+     * @brief Removes the objects of retired Individuals.
+     *
+     * @return size_t The number of objects removed.
+     */
+    virtual size_t compact() = 0;
+};
+
+#endif // GALLERY_INDEX_HPP
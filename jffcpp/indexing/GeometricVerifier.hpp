@@ -0,0 +1,292 @@
+#ifndef GEOMETRIC_VERIFIER_HPP
+#define GEOMETRIC_VERIFIER_HPP
+
+#include <vector>
+#include <cmath>         // For std::cos, std::sin, std::round, std::atan2
+#include <algorithm>     // For std::sort, std::stable_sort, std::max
+#include <unordered_map> // For std::unordered_map
+#include <unordered_set> // For std::unordered_set
+#include <tuple>         // For std::tie
+#include "NNList.hpp"
+#include "../data/Minutiae.hpp"
+#include "../data/ParentedFeature.hpp" // For representativeId
+#include "../data/Individual.hpp"
+
+/**
+ * @brief Re-ranks candidate Individuals by how many of their descriptor matches agree on one
+ * rigid transform (rotation + translation) between the latent and the gallery print.
+ *
+ * The matches are the neighbor lists already computed by the search: neighbor j of query
+ * minutia i is a match (i, j). For each candidate, every match proposes a transform; proposals
+ * are Hough-voted in bins of angleTolerance x translationTolerance, the transform is re-estimated
+ * from the fullest bin, and the candidate's score becomes the number of one-to-one matches
+ * that fit it. Each candidate costs O(m log m) for its m matches (two sorts, then one pass with
+ * O(1) used-minutia checks), so 100 candidates take well under a millisecond.
+ *
+ * Gallery geometry is looked up by feature ID in a map, as IDs are sparse once Individuals are
+ * retired and compacted or several galleries are loaded. A match whose gallery minutia has no
+ * geometry cannot be verified: it counts as inconsistent and is reported by rerank.
+ */
+class GeometricVerifier
+{
+public:
+    /**
+     * @brief Constructs a verifier.
+     *
+     * @param galleryGeometry Gallery minutiae, row = feature ID (see loadIndividuals). Only the rows
+     * written are used (see Minutiae::has); the table is copied.
+     * @param translationTolerance Largest position error of a consistent match, in pixels.
+     * @param angleTolerance Largest direction error of a consistent match, in theta units.
+     * @param fullTurn Value of a full turn in theta units (2 pi for radians, 360 for degrees).
+     */
+    GeometricVerifier(const Minutiae &galleryGeometry, float translationTolerance = 20.0f, float angleTolerance = 0.26f, float fullTurn = 6.2831853f)
+        : translationTolerance(translationTolerance), angleTolerance(angleTolerance), fullTurn(fullTurn)
+    {
+        for (size_t row = 0; row < galleryGeometry.size(); ++row)
+        {
+            if (galleryGeometry.has(row))
+                add(static_cast<uint32_t>(row), galleryGeometry.x[row], galleryGeometry.y[row], galleryGeometry.theta[row]);
+        }
+    }
+
+    /**
+     * @brief Adds or replaces the geometry of one gallery feature.
+     */
+    void add(uint32_t featureId, float x, float y, float theta)
+    {
+        auto inserted = rowOf.emplace(featureId, static_cast<uint32_t>(gallery.size()));
+        if (inserted.second)
+            gallery.push_back(x, y, theta, 0.0f);
+        else
+            gallery.set(inserted.first->second, x, y, theta, 0.0f);
+    }
+
+    /**
+     * @brief Adds the geometry of an Individual, row i of the table describing its i-th feature
+     * (e.g. the Minutiae of the file it was enrolled from).
+     */
+    void add(const Individual<ParentedFeature> &individual, const Minutiae &rows)
+    {
+        for (size_t i = 0; i < individual.features.size() && i < rows.size(); ++i)
+        {
+            add(individual.features[i], rows.x[i], rows.y[i], rows.theta[i]);
+        }
+    }
+
+    /**
+     * @brief Rescores candidates by their number of geometrically consistent matches.
+     *
+     * @param lists Neighbor lists, list i being the neighbors of query minutia i.
+     * @param queryGeometry Metadata of the query minutiae, aligned with lists.
+     * @param candidates Candidates (ID, score) to verify, e.g. NNResult::pickBest(100).
+     * @param unverified If not null, receives the number of matches of the candidates whose gallery
+     * minutia has no geometry (counted as failed verifications).
+     * @return std::vector<std::pair<uint32_t, double>> The candidates with their consistent
+     * match counts, best first (ties keep the input order).
+     */
+    template <typename T>
+    std::vector<std::pair<uint32_t, double>> rerank(const std::vector<NNList<T>> &lists, const Minutiae &queryGeometry, const std::vector<std::pair<uint32_t, double>> &candidates, size_t *unverified = nullptr) const
+    {
+        std::unordered_map<uint32_t, size_t> slot;
+        for (size_t c = 0; c < candidates.size(); ++c)
+        {
+            slot[candidates[c].first] = c;
+        }
+
+        // Group the matches by candidate in one pass over the lists
+        std::vector<std::vector<Match>> matches(candidates.size());
+        size_t missing = 0;
+        for (size_t q = 0; q < lists.size() && q < queryGeometry.size(); ++q)
+        {
+            for (const auto &entry : lists[q])
+            {
+                auto it = slot.find(representativeId(entry.element));
+                if (it == slot.end())
+                    continue;
+                auto row = rowOf.find(entry.element.getId());
+                if (row == rowOf.end())
+                {
+                    ++missing; // Cannot be consistent with any transform
+                    continue;
+                }
+                matches[it->second].push_back({static_cast<uint32_t>(q), row->second, entry.distance});
+            }
+        }
+        if (unverified != nullptr)
+            *unverified = missing;
+
+        std::vector<std::pair<uint32_t, double>> rescored;
+        rescored.reserve(candidates.size());
+        for (size_t c = 0; c < candidates.size(); ++c)
+        {
+            rescored.emplace_back(candidates[c].first, static_cast<double>(consistentMatches(matches[c], queryGeometry)));
+        }
+        std::stable_sort(rescored.begin(), rescored.end(), [](const auto &a, const auto &b)
+                         { return a.second > b.second; });
+        return rescored;
+    }
+
+    /**
+     * @brief Descriptor match between query minutia `query` and gallery feature `feature`.
+     */
+    struct Match
+    {
+        uint32_t query;   ///< Row of the query minutia
+        uint32_t feature; ///< Row of the gallery minutia
+        double distance;  ///< Descriptor distance
+    };
+
+    /**
+     * @brief Returns the size of the largest one-to-one match set agreeing on one rigid transform.
+     *
+     * @param matches Matches between the query and one candidate.
+     * @param queryGeometry Metadata of the query minutiae.
+     */
+    size_t consistentMatches(std::vector<Match> matches, const Minutiae &queryGeometry) const
+    {
+        if (matches.empty())
+            return 0;
+
+        // 1. Each match proposes a transform; vote for its bin
+        struct Vote
+        {
+            long long rotation, tx, ty;
+            size_t match;
+            bool operator<(const Vote &other) const
+            {
+                return std::tie(rotation, tx, ty) < std::tie(other.rotation, other.tx, other.ty);
+            }
+        };
+        std::vector<Vote> votes;
+        votes.reserve(matches.size());
+        for (size_t m = 0; m < matches.size(); ++m)
+        {
+            Transform t = propose(matches[m], queryGeometry);
+            votes.push_back({static_cast<long long>(std::round(t.rotation / angleTolerance)),
+                             static_cast<long long>(std::round(t.tx / translationTolerance)),
+                             static_cast<long long>(std::round(t.ty / translationTolerance)), m});
+        }
+        std::sort(votes.begin(), votes.end());
+
+        size_t bestBegin = 0, bestCount = 0;
+        for (size_t begin = 0, end; begin < votes.size(); begin = end)
+        {
+            for (end = begin + 1; end < votes.size() && !(votes[begin] < votes[end]); ++end)
+                ;
+            if (end - begin > bestCount)
+            {
+                bestBegin = begin;
+                bestCount = end - begin;
+            }
+        }
+
+        // 2. Re-estimate the transform from the fullest bin
+        double sinSum = 0, cosSum = 0, txSum = 0, tySum = 0;
+        for (size_t v = bestBegin; v < bestBegin + bestCount; ++v)
+        {
+            Transform t = propose(matches[votes[v].match], queryGeometry);
+            double radians = t.rotation / fullTurn * 6.283185307179586;
+            sinSum += std::sin(radians);
+            cosSum += std::cos(radians);
+            txSum += t.tx;
+            tySum += t.ty;
+        }
+        Transform best;
+        best.rotation = static_cast<float>(std::atan2(sinSum, cosSum) / 6.283185307179586 * fullTurn);
+        best.tx = static_cast<float>(txSum / bestCount);
+        best.ty = static_cast<float>(tySum / bestCount);
+
+        // 3. Count the matches fitting it, each minutia used once, closest descriptors first
+        std::sort(matches.begin(), matches.end(), [](const Match &a, const Match &b)
+                  { return a.distance < b.distance; });
+        // Query rows are few and dense: flags; gallery rows span the whole table: a hash set
+        uint32_t queryRows = 0;
+        for (const Match &match : matches)
+        {
+            queryRows = std::max(queryRows, match.query + 1);
+        }
+        std::vector<char> usedQueries(queryRows, 0);
+        std::unordered_set<uint32_t> usedFeatures;
+        usedFeatures.reserve(matches.size());
+        size_t consistent = 0;
+        for (const Match &match : matches)
+        {
+            if (usedQueries[match.query] || usedFeatures.count(match.feature) > 0)
+                continue;
+            if (!fits(match, best, queryGeometry))
+                continue;
+
+            usedQueries[match.query] = 1;
+            usedFeatures.insert(match.feature);
+            ++consistent;
+        }
+        return consistent;
+    }
+
+private:
+    /**
+     * @brief Rigid transform mapping query coordinates to gallery coordinates.
+     */
+    struct Transform
+    {
+        float rotation = 0.0f; ///< In theta units
+        float tx = 0.0f, ty = 0.0f;
+    };
+
+    /**
+     * @brief Wraps an angle difference to [-fullTurn / 2, fullTurn / 2).
+     */
+    float wrap(float angle) const
+    {
+        angle = std::fmod(angle + fullTurn / 2, fullTurn);
+        if (angle < 0)
+            angle += fullTurn;
+        return angle - fullTurn / 2;
+    }
+
+    /**
+     * @brief Rotates a query point into gallery orientation.
+     */
+    void rotate(float rotation, float x, float y, float &rx, float &ry) const
+    {
+        float radians = rotation / fullTurn * 6.2831853f;
+        float c = std::cos(radians), s = std::sin(radians);
+        rx = c * x - s * y;
+        ry = s * x + c * y;
+    }
+
+    /**
+     * @brief Transform aligning the two minutiae of a match.
+     */
+    Transform propose(const Match &match, const Minutiae &query) const
+    {
+        Transform t;
+        t.rotation = wrap(gallery.theta[match.feature] - query.theta[match.query]);
+        float rx, ry;
+        rotate(t.rotation, query.x[match.query], query.y[match.query], rx, ry);
+        t.tx = gallery.x[match.feature] - rx;
+        t.ty = gallery.y[match.feature] - ry;
+        return t;
+    }
+
+    /**
+     * @brief Returns true if the match agrees with the transform within the tolerances.
+     */
+    bool fits(const Match &match, const Transform &t, const Minutiae &query) const
+    {
+        float rx, ry;
+        rotate(t.rotation, query.x[match.query], query.y[match.query], rx, ry);
+        float dx = rx + t.tx - gallery.x[match.feature];
+        float dy = ry + t.ty - gallery.y[match.feature];
+        float dTheta = wrap(query.theta[match.query] + t.rotation - gallery.theta[match.feature]);
+        return dx * dx + dy * dy <= translationTolerance * translationTolerance && std::abs(dTheta) <= angleTolerance;
+    }
+
+    Minutiae gallery;                             ///< Gallery minutiae, one row per feature with geometry
+    std::unordered_map<uint32_t, uint32_t> rowOf; ///< Row of each feature ID in gallery
+    float translationTolerance;                   ///< Position tolerance, in pixels
+    float angleTolerance;                         ///< Direction tolerance, in theta units
+    float fullTurn;                               ///< A full turn in theta units
+};
+
+#endif // GEOMETRIC_VERIFIER_HPP
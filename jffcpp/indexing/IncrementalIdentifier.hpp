@@ -0,0 +1,133 @@
+#ifndef INCREMENTAL_IDENTIFIER_HPP
+#define INCREMENTAL_IDENTIFIER_HPP
+
+#include <vector>
+#include <numeric>   // For std::iota
+#include <stdexcept> // For std::invalid_argument
+#include "VoteAggregator.hpp"
+#include "SearchFilter.hpp"
+
+/**
+ * @brief Result of an incremental identification.
+ */
+struct IdentificationResult
+{
+    std::vector<std::pair<uint32_t, double>> best; ///< Best Individuals (ID, score), best first
+    size_t processed = 0;                          ///< Number of query minutiae searched
+    size_t total = 0;                              ///< Number of query minutiae available
+    bool stoppedEarly = false;                     ///< True if the ranking was decided before the last minutia
+};
+
+/**
+ * @brief Identifies a latent by searching its minutiae one at a time, best quality first, and
+ * stops as soon as the leading Individuals can no longer be overtaken.
+ *
+ * After each minutia the votes are updated and the gap between consecutive Individuals of the
+ * ranking is compared with the largest score the remaining minutiae could still add to a single
+ * Individual. In guaranteed mode that bound is Policy::maxGain(k) per minutia (one Individual
+ * filling the whole neighbor list), so the returned IDs and their order are exactly those of a
+ * search over every minutia; only the scores are partial. Otherwise each remaining minutia is
+ * assumed to add at most Policy::maxGain(1) (one neighbor per Individual), which stops much
+ * earlier but may, rarely, change the answer.
+ *
+ * @tparam Policy An accumulating policy with maxGain (FrequencyVote or WeightedVote).
+ */
+template <typename Policy = FrequencyVote>
+class IncrementalIdentifier
+{
+    static_assert(Policy::higherIsBetter, "Early termination needs a policy whose scores only grow");
+
+public:
+    /**
+     * @brief Constructs an identifier.
+     *
+     * @param k The number of nearest neighbors searched per minutia.
+     * @param nBest The number of Individuals whose ranking must be decided.
+     * @param guaranteed If true, stop only when the answer equals the one of a full search.
+     */
+    IncrementalIdentifier(size_t k, size_t nBest = 1, bool guaranteed = true) : k(k), nBest(nBest), guaranteed(guaranteed)
+    {
+        if (k == 0 || nBest == 0)
+            throw std::invalid_argument("k and nBest must be positive");
+    }
+
+    /**
+     * @brief Identifies the owner of the query minutiae.
+     *
+     * @param searcher Any searcher with knn(T &, size_t, const SearchFilter &) const.
+     * @param queries The query minutiae.
+     * @param order Processing order of the queries, usually Minutiae::orderByScore(); empty keeps the given order.
+     * @param filter Restricts the candidate Individuals.
+     * @return IdentificationResult The nBest Individuals and how many minutiae were needed.
+     */
+    template <typename Searcher, typename T>
+    IdentificationResult identify(const Searcher &searcher, std::vector<T> &queries, const std::vector<size_t> &order = {}, const SearchFilter &filter = SearchFilter())
+    {
+        std::vector<size_t> sequence(order);
+        if (sequence.empty())
+        {
+            sequence.resize(queries.size());
+            std::iota(sequence.begin(), sequence.end(), size_t(0));
+        }
+
+        IdentificationResult result;
+        result.total = sequence.size();
+        const double gainPerMinutia = Policy::maxGain(guaranteed ? k : 1);
+
+        votes.reset();
+        for (size_t i = 0; i < sequence.size(); ++i)
+        {
+            votes.add(searcher.knn(queries.at(sequence[i]), k, filter));
+            result.processed = i + 1;
+
+            size_t remaining = sequence.size() - result.processed;
+            if (remaining > 0 && isDecided(gainPerMinutia * static_cast<double>(remaining)))
+            {
+                result.stoppedEarly = true;
+                break;
+            }
+        }
+
+        result.best = votes.top(nBest);
+        return result;
+    }
+
+    /**
+     * @brief Returns the votes of the last identification.
+     */
+    const VoteAggregator<Policy> &getVotes() const
+    {
+        return votes;
+    }
+
+private:
+    /**
+     * @brief Checks that no Individual can still overtake its predecessor among the first nBest + 1.
+     *
+     * @param maxGain Largest score the remaining minutiae can add to one Individual.
+     */
+    bool isDecided(double maxGain) const
+    {
+        std::vector<std::pair<uint32_t, double>> ranking = votes.top(nBest + 1);
+        // An Individual without votes has score Policy::initial and can still climb the ranking
+        while (ranking.size() < nBest + 1)
+        {
+            ranking.emplace_back(0, Policy::initial);
+        }
+
+        for (size_t i = 0; i < nBest; ++i)
+        {
+            // Strict: a tie could be resolved by ID in favor of the follower
+            if (ranking[i].second - ranking[i + 1].second <= maxGain)
+                return false;
+        }
+        return true;
+    }
+
+    size_t k;                     ///< Neighbors per minutia
+    size_t nBest;                 ///< Individuals whose ranking must be decided
+    bool guaranteed;              ///< Use the exact bound
+    VoteAggregator<Policy> votes; ///< Votes of the current identification
+};
+
+#endif // INCREMENTAL_IDENTIFIER_HPP
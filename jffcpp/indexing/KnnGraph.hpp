@@ -0,0 +1,501 @@
+#ifndef KNN_GRAPH_HPP
+#define KNN_GRAPH_HPP
+
+#include <vector>
+#include <string>
+#include <mutex>     // For std::mutex, std::lock_guard
+#include <atomic>    // For std::atomic
+#include <random>    // For std::mt19937_64
+#include <cmath>     // For std::sqrt
+#include <algorithm> // For std::sort, std::unique, std::partial_sort
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+#include "../data/BinaryFile.hpp"
+#include "../math/LinAlg.hpp"
+#include "../concurrency/Parallel.hpp"
+
+/**
+ * @brief Gallery-wide k-nearest-neighbor graph in compressed sparse row form.
+ *
+ * Node i is the i-th feature given to the builder; the edges of node i are
+ * neighbors[offsets[i]] .. neighbors[offsets[i + 1] - 1], closest first.
+ */
+struct KnnGraph
+{
+    std::vector<uint32_t> nodeIds;   ///< Feature ID of each node
+    std::vector<uint64_t> offsets;   ///< First edge of each node, plus the number of edges
+    std::vector<uint32_t> neighbors; ///< Node index of each edge
+    std::vector<float> distances;    ///< Euclidean distance of each edge
+
+    /**
+     * @brief Returns the number of nodes.
+     */
+    size_t size() const
+    {
+        return nodeIds.size();
+    }
+
+    /**
+     * @brief Returns the number of neighbors of a node.
+     */
+    size_t degree(size_t node) const
+    {
+        return offsets[node + 1] - offsets[node];
+    }
+
+    /**
+     * @brief Returns the neighbors of a node (degree(node) entries, closest first).
+     */
+    const uint32_t *neighborsOf(size_t node) const
+    {
+        return neighbors.data() + offsets[node];
+    }
+
+    /**
+     * @brief Saves the graph as one section.
+     *
+     * @param writer The writer.
+     * @param prefix Name of the section.
+     */
+    void save(BinaryWriter &writer, const std::string &prefix = "knngraph") const
+    {
+        writer.beginSection(prefix);
+        writer.write(uint64_t(nodeIds.size()));
+        writer.write(uint64_t(neighbors.size()));
+        writer.writeArray(nodeIds.data(), nodeIds.size());
+        writer.writeArray(offsets.data(), offsets.size());
+        writer.writeArray(neighbors.data(), neighbors.size());
+        writer.writeArray(distances.data(), distances.size());
+        writer.endSection();
+    }
+
+    /**
+     * @brief Saves the graph to its own file.
+     */
+    void save(const std::string &filename) const
+    {
+        BinaryWriter writer(filename);
+        save(writer);
+        writer.close();
+    }
+
+    /**
+     * @brief Loads a graph saved by save().
+     *
+     * @param reader The reader.
+     * @param prefix Name of the section.
+     * @throws std::runtime_error if the counts, offsets or neighbor indices are invalid.
+     */
+    void load(const BinaryReader &reader, const std::string &prefix = "knngraph")
+    {
+        SectionReader section = reader.section(prefix);
+        KnnGraph graph;
+        graph.nodeIds.resize(section.readCount<uint64_t>(sizeof(uint32_t) + sizeof(uint64_t)));
+        graph.neighbors.resize(section.readCount<uint64_t>(sizeof(uint32_t) + sizeof(float)));
+        graph.offsets.resize(graph.nodeIds.size() + 1);
+        graph.distances.resize(graph.neighbors.size());
+        section.readArray(graph.nodeIds.data(), graph.nodeIds.size());
+        section.readArray(graph.offsets.data(), graph.offsets.size());
+        section.readArray(graph.neighbors.data(), graph.neighbors.size());
+        section.readArray(graph.distances.data(), graph.distances.size());
+
+        // degree() and neighborsOf() trust the offsets, and callers index nodes by neighbor
+        if (graph.offsets.front() != 0 || graph.offsets.back() != graph.neighbors.size())
+            throw std::runtime_error("Inconsistent edge offsets in section " + prefix);
+        for (size_t i = 1; i < graph.offsets.size(); ++i)
+        {
+            if (graph.offsets[i] < graph.offsets[i - 1])
+                throw std::runtime_error("Decreasing edge offsets in section " + prefix);
+        }
+        for (uint32_t neighbor : graph.neighbors)
+        {
+            if (neighbor >= graph.nodeIds.size())
+                throw std::runtime_error("Invalid neighbor index in section " + prefix);
+        }
+        *this = std::move(graph);
+    }
+
+    /**
+     * @brief Loads a graph from its own file.
+     */
+    void load(const std::string &filename)
+    {
+        BinaryReader reader(filename);
+        load(reader);
+    }
+};
+
+/**
+ * @brief Builds an approximate kNN graph of descriptors with NN-descent (Dong et al., 2011).
+ *
+ * The descriptors are copied into one contiguous matrix. Every node starts with k random
+ * neighbors; each iteration then compares, for every node, pairs of its sampled new neighbors
+ * and new-old pairs, in both directions of the graph ("local join"), and keeps the closer
+ * candidates. Work is split over threads by node; the neighbor lists are guarded by a fixed
+ * array of striped locks. It stops when fewer than delta * n * k lists changed in an iteration.
+ *
+ * Distances are Euclidean (LinAlg::squaredDistance on the packed rows).
+ */
+class NNDescent
+{
+public:
+    /**
+     * @brief Constructs a builder.
+     *
+     * @param k Number of neighbors per node.
+     * @param maxIterations Largest number of iterations.
+     * @param sampleRate Fraction of the new neighbors joined per node and iteration (rho).
+     * @param delta Convergence threshold on the fraction of updated neighbors.
+     * @param seed Seed of the random initialization and sampling.
+     */
+    NNDescent(size_t k = 20, size_t maxIterations = 12, double sampleRate = 0.5, double delta = 0.001, uint64_t seed = 42)
+        : k(k), maxIterations(maxIterations), sampleRate(sampleRate), delta(delta), seed(seed), locks(lockStripes)
+    {
+        if (k == 0)
+            throw std::invalid_argument("k must be positive");
+    }
+
+    /**
+     * @brief Places the packed descriptors and the neighbor lists of the next build() on huge
+     * pages. The join reads rows of random nodes, so large galleries spend less on TLB misses.
+     *
+     * @param mode The preferred page size; falls back to smaller pages when unavailable.
+     */
+    void setHugePages(HugePageMode mode)
+    {
+        data = HugeVector<float>(HugePageAllocator<float>(mode));
+        ids = HugeVector<uint32_t>(HugePageAllocator<uint32_t>(mode));
+        dists = HugeVector<float>(HugePageAllocator<float>(mode));
+    }
+
+    /**
+     * @brief Returns how much of the packed descriptors and neighbor lists is held in huge pages.
+     */
+    HugePageUsage hugePageUsage() const
+    {
+        HugePageUsage usage;
+        for (HugePageUsage part : {hugePageUsageOf(data), hugePageUsageOf(ids), hugePageUsageOf(dists)})
+        {
+            usage.anonymousBytes += part.anonymousBytes;
+            usage.explicitBytes += part.explicitBytes;
+        }
+        return usage;
+    }
+
+    /**
+     * @brief Builds the graph of the given descriptors.
+     *
+     * @param features The descriptors, all of the same dimension.
+     * @param nThreads The number of threads (0 means hardware concurrency).
+     * @return KnnGraph The graph, node i being features[i].
+     */
+    template <typename T>
+    KnnGraph build(const std::vector<T> &features, unsigned nThreads = 0)
+    {
+        n = features.size();
+        dimension = features.empty() ? 0 : features[0].size();
+        data.resize(n * dimension);
+        KnnGraph graph;
+        graph.nodeIds.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (features[i].size() != dimension)
+                throw std::invalid_argument("Features have different dimensions");
+            std::copy(features[i].values.begin(), features[i].values.end(), data.begin() + i * dimension);
+            graph.nodeIds[i] = features[i].getId();
+        }
+
+        kk = n > 1 ? std::min(k, n - 1) : 0;
+        ids.assign(n * kk, 0);
+        dists.assign(n * kk, 0.0f);
+        isNew.assign(n * kk, 1);
+        counts.assign(n, 0);
+        iterationsRun = 0;
+
+        if (kk > 0)
+        {
+            initialize(nThreads);
+            for (size_t iteration = 0; iteration < maxIterations; ++iteration)
+            {
+                ++iterationsRun;
+                if (static_cast<double>(iterate(nThreads)) < delta * static_cast<double>(n * kk))
+                    break;
+            }
+        }
+
+        graph.offsets.resize(n + 1);
+        graph.neighbors.resize(n * kk);
+        graph.distances.resize(n * kk);
+        for (size_t v = 0; v < n; ++v)
+        {
+            graph.offsets[v] = v * kk;
+            for (size_t e = 0; e < kk; ++e)
+            {
+                graph.neighbors[v * kk + e] = ids[v * kk + e];
+                graph.distances[v * kk + e] = std::sqrt(dists[v * kk + e]);
+            }
+        }
+        graph.offsets[n] = n * kk;
+        return graph;
+    }
+
+    /**
+     * @brief Measures the recall of a graph built by the last build() against exact neighbors of
+     * randomly sampled nodes.
+     *
+     * @param graph The graph.
+     * @param samples Number of nodes checked exhaustively.
+     * @param nThreads The number of threads (0 means hardware concurrency).
+     * @return double Fraction of the exact neighbors of the sampled nodes present in the graph.
+     */
+    double recall(const KnnGraph &graph, size_t samples = 1000, unsigned nThreads = 0) const
+    {
+        if (graph.size() != n || n < 2)
+            return 1.0;
+
+        std::mt19937_64 rng(seed + 1);
+        std::vector<size_t> sampled(std::min(samples, n));
+        for (auto &node : sampled)
+        {
+            node = rng() % n;
+        }
+
+        std::atomic<size_t> found(0), expected(0);
+        parallelFor(sampled.size(), nThreads, [&](size_t begin, size_t end)
+                    {
+            std::vector<std::pair<float, uint32_t>> exact(n - 1);
+            size_t localFound = 0, localExpected = 0;
+            for (size_t s = begin; s < end; ++s)
+            {
+                size_t v = sampled[s];
+                exact.clear();
+                for (size_t u = 0; u < n; ++u)
+                {
+                    if (u != v)
+                        exact.emplace_back(distance(v, u), static_cast<uint32_t>(u));
+                }
+                size_t depth = std::min(graph.degree(v), exact.size());
+                std::partial_sort(exact.begin(), exact.begin() + depth, exact.end());
+
+                const uint32_t *approx = graph.neighborsOf(v);
+                for (size_t e = 0; e < depth; ++e)
+                {
+                    if (std::find(approx, approx + graph.degree(v), exact[e].second) != approx + graph.degree(v))
+                        ++localFound;
+                }
+                localExpected += depth;
+            }
+            found += localFound;
+            expected += localExpected; });
+
+        return expected == 0 ? 1.0 : static_cast<double>(found) / static_cast<double>(expected);
+    }
+
+    /**
+     * @brief Returns the number of iterations of the last build().
+     */
+    size_t iterations() const
+    {
+        return iterationsRun;
+    }
+
+private:
+    static constexpr size_t lockStripes = 4096; ///< Number of striped locks
+
+    /**
+     * @brief Squared distance between two nodes.
+     */
+    float distance(size_t a, size_t b) const
+    {
+        return LinAlg::squaredDistance(&data[a * dimension], &data[b * dimension], dimension);
+    }
+
+    /**
+     * @brief Returns the lock guarding the lists of a node.
+     */
+    std::mutex &lockOf(size_t node)
+    {
+        return locks[node % lockStripes];
+    }
+
+    /**
+     * @brief Offers x as a neighbor of v; returns true if v's list changed.
+     */
+    bool update(size_t v, uint32_t x, float d)
+    {
+        std::lock_guard<std::mutex> lock(lockOf(v));
+        uint32_t *id = &ids[v * kk];
+        float *dist = &dists[v * kk];
+        uint8_t *fresh = &isNew[v * kk];
+        size_t count = counts[v];
+
+        if (count == kk && d >= dist[kk - 1])
+            return false;
+        if (std::find(id, id + count, x) != id + count)
+            return false;
+
+        size_t pos = std::min(count, kk - 1);
+        while (pos > 0 && dist[pos - 1] > d)
+        {
+            id[pos] = id[pos - 1];
+            dist[pos] = dist[pos - 1];
+            fresh[pos] = fresh[pos - 1];
+            --pos;
+        }
+        id[pos] = x;
+        dist[pos] = d;
+        fresh[pos] = 1;
+        if (count < kk)
+            counts[v] = static_cast<uint32_t>(count + 1);
+        return true;
+    }
+
+    /**
+     * @brief Fills every list with kk distinct random neighbors.
+     */
+    void initialize(unsigned nThreads)
+    {
+        parallelFor(n, nThreads, [&](size_t begin, size_t end)
+                    {
+            std::mt19937_64 rng(seed ^ (begin * 0x9e3779b97f4a7c15ULL));
+            for (size_t v = begin; v < end; ++v)
+            {
+                while (counts[v] < kk)
+                {
+                    uint32_t u = static_cast<uint32_t>(rng() % n);
+                    if (u != v)
+                        update(v, u, distance(v, u));
+                }
+            } });
+    }
+
+    /**
+     * @brief Runs one iteration; returns the number of list updates.
+     */
+    size_t iterate(unsigned nThreads)
+    {
+        const size_t sampleSize = std::max<size_t>(1, static_cast<size_t>(sampleRate * static_cast<double>(kk)));
+        newLists.resize(n);
+        oldLists.resize(n);
+        reverseNew.resize(n);
+        reverseOld.resize(n);
+        reverseNewSeen.assign(n, 0);
+        reverseOldSeen.assign(n, 0);
+
+        // 1. Forward candidates: all old neighbors, the sampleSize closest new ones (now old)
+        parallelFor(n, nThreads, [&](size_t begin, size_t end)
+                    {
+            for (size_t v = begin; v < end; ++v)
+            {
+                std::lock_guard<std::mutex> lock(lockOf(v));
+                newLists[v].clear();
+                oldLists[v].clear();
+                reverseNew[v].clear();
+                reverseOld[v].clear();
+                for (size_t e = 0; e < counts[v]; ++e)
+                {
+                    if (!isNew[v * kk + e])
+                    {
+                        oldLists[v].push_back(ids[v * kk + e]);
+                    }
+                    else if (newLists[v].size() < sampleSize)
+                    {
+                        newLists[v].push_back(ids[v * kk + e]);
+                        isNew[v * kk + e] = 0;
+                    }
+                }
+            } });
+
+        // 2. Reverse candidates, reservoir-sampled to sampleSize per node
+        parallelFor(n, nThreads, [&](size_t begin, size_t end)
+                    {
+            std::mt19937_64 rng(seed ^ (iterationsRun << 32) ^ begin);
+            auto offer = [&](std::vector<uint32_t> &reservoir, uint32_t &seen, uint32_t v)
+            {
+                ++seen;
+                if (reservoir.size() < sampleSize)
+                {
+                    reservoir.push_back(v);
+                    return;
+                }
+                size_t slot = rng() % seen;
+                if (slot < sampleSize)
+                    reservoir[slot] = v;
+            };
+            for (size_t v = begin; v < end; ++v)
+            {
+                for (uint32_t u : newLists[v])
+                {
+                    std::lock_guard<std::mutex> lock(lockOf(u));
+                    offer(reverseNew[u], reverseNewSeen[u], static_cast<uint32_t>(v));
+                }
+                for (uint32_t u : oldLists[v])
+                {
+                    std::lock_guard<std::mutex> lock(lockOf(u));
+                    offer(reverseOld[u], reverseOldSeen[u], static_cast<uint32_t>(v));
+                }
+            } });
+
+        // 3. Local join
+        std::atomic<size_t> updates(0);
+        parallelFor(n, nThreads, [&](size_t begin, size_t end)
+                    {
+            size_t local = 0;
+            std::vector<uint32_t> fresh, old;
+            for (size_t v = begin; v < end; ++v)
+            {
+                fresh = newLists[v];
+                fresh.insert(fresh.end(), reverseNew[v].begin(), reverseNew[v].end());
+                std::sort(fresh.begin(), fresh.end());
+                fresh.erase(std::unique(fresh.begin(), fresh.end()), fresh.end());
+                old = oldLists[v];
+                old.insert(old.end(), reverseOld[v].begin(), reverseOld[v].end());
+                std::sort(old.begin(), old.end());
+                old.erase(std::unique(old.begin(), old.end()), old.end());
+
+                for (size_t i = 0; i < fresh.size(); ++i)
+                {
+                    for (size_t j = i + 1; j < fresh.size(); ++j)
+                    {
+                        float d = distance(fresh[i], fresh[j]);
+                        local += update(fresh[i], fresh[j], d);
+                        local += update(fresh[j], fresh[i], d);
+                    }
+                    for (uint32_t u : old)
+                    {
+                        if (u == fresh[i])
+                            continue;
+                        float d = distance(fresh[i], u);
+                        local += update(fresh[i], u, d);
+                        local += update(u, fresh[i], d);
+                    }
+                }
+            }
+            updates += local; });
+
+        return updates;
+    }
+
+    size_t k;             ///< Requested neighbors per node
+    size_t maxIterations; ///< Iteration limit
+    double sampleRate;    ///< Sampling rate rho
+    double delta;         ///< Convergence threshold
+    uint64_t seed;        ///< Random seed
+
+    size_t n = 0;             ///< Number of nodes
+    size_t kk = 0;            ///< Neighbors per node (k, or n - 1 for tiny inputs)
+    size_t dimension = 0;     ///< Descriptor dimension
+    size_t iterationsRun = 0; ///< Iterations of the last build
+    HugeVector<float> data;   ///< Packed descriptors, row-major
+
+    HugeVector<uint32_t> ids;      ///< Neighbor lists, kk per node, closest first
+    HugeVector<float> dists;       ///< Squared distances of the lists
+    std::vector<uint8_t> isNew;    ///< 1 if the neighbor was not joined yet
+    std::vector<uint32_t> counts;  ///< Filled entries per list
+    std::vector<std::mutex> locks; ///< Striped locks over the lists
+
+    std::vector<std::vector<uint32_t>> newLists, oldLists;     ///< Forward candidates per node
+    std::vector<std::vector<uint32_t>> reverseNew, reverseOld; ///< Reverse candidates per node
+    std::vector<uint32_t> reverseNewSeen, reverseOldSeen;      ///< Reverse candidates offered per node
+};
+
+#endif // KNN_GRAPH_HPP
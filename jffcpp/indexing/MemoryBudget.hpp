@@ -0,0 +1,401 @@
+#ifndef MEMORY_BUDGET_HPP
+#define MEMORY_BUDGET_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>   // For std::ifstream, std::ofstream
+#include <sstream>   // For std::ostringstream
+#include <ostream>   // For std::ostream
+#include <chrono>    // For std::chrono::steady_clock
+#include <algorithm> // For std::min, std::max
+#include <stdexcept> // For std::runtime_error
+#include "NNList.hpp"
+#include "StreamingSearcher.hpp"
+#include "../data/BinaryFile.hpp"
+#include "../data/Gallery.hpp"
+
+/**
+ * @brief Size of a gallery, as needed to plan its memory.
+ */
+struct GalleryShape
+{
+    size_t individuals = 0; ///< Number of Individuals (their IDs are assumed dense, as enrollment assigns them)
+    size_t features = 0;    ///< Number of features
+    uint32_t dimension = 0; ///< Descriptor dimension
+
+    /**
+     * @brief Returns the shape of a loaded gallery.
+     */
+    template <typename F>
+    static GalleryShape of(const Gallery<F> &gallery)
+    {
+        GalleryShape shape;
+        shape.individuals = gallery.size();
+        shape.features = gallery.numFeatures();
+        for (const auto &individual : gallery.getIndividuals())
+        {
+            shape.dimension = std::max(shape.dimension, static_cast<uint32_t>(individual->mean.size()));
+        }
+        return shape;
+    }
+
+    /**
+     * @brief Returns the shape of a gallery saved by Gallery::save, reading only a few bytes.
+     */
+    static GalleryShape ofFile(const std::string &filename, const std::string &prefix = "gallery")
+    {
+        auto sections = BinaryFile::locateSections(filename);
+        auto individuals = sections.find(prefix + ".individuals");
+        auto features = sections.find(prefix + ".features");
+        if (individuals == sections.end() || features == sections.end())
+            throw std::runtime_error("No gallery " + prefix + " in " + filename);
+
+        std::ifstream file(filename, std::ios::binary);
+        uint64_t nIndividuals = 0, nFeatures = 0;
+        GalleryShape shape;
+        file.seekg(static_cast<std::streamoff>(individuals->second.offset));
+        file.read(reinterpret_cast<char *>(&nIndividuals), sizeof(nIndividuals));
+        file.seekg(static_cast<std::streamoff>(features->second.offset));
+        file.read(reinterpret_cast<char *>(&nFeatures), sizeof(nFeatures));
+        file.read(reinterpret_cast<char *>(&shape.dimension), sizeof(shape.dimension));
+        if (!file)
+            throw std::runtime_error("Could not read the gallery header of " + filename);
+        shape.individuals = static_cast<size_t>(nIndividuals);
+        shape.features = static_cast<size_t>(nFeatures);
+        return shape;
+    }
+};
+
+/**
+ * @brief How the gallery is held during searches.
+ */
+enum class StorageMode
+{
+    Resident, ///< Full descriptors in memory (Gallery and searcher)
+    Reduced,  ///< Descriptors in memory after a PCA projection to MemoryPlan::dimension (approximate)
+    Streamed  ///< The Individuals and a prefix of the features in memory, the rest read by a StreamingSearcher (exact)
+};
+
+/**
+ * @brief Storage and batching chosen by MemoryBudget::plan, with the estimated usage of each part.
+ */
+struct MemoryPlan
+{
+    StorageMode storage = StorageMode::Resident; ///< How the gallery is held
+    uint32_t dimension = 0;                      ///< Descriptor dimension to store (the PCA output dimension when Reduced)
+    size_t batchRows = 1;                        ///< Query minutiae per knnBatch (e.g. ServerOptions::maxBatchRows)
+    StreamingOptions streaming;                  ///< Buffers and resident prefix of the StreamingSearcher when Streamed
+
+    size_t galleryBytes = 0;   ///< Individuals and the resident descriptors
+    size_t bufferBytes = 0;    ///< Chunk buffers when Streamed
+    size_t batchBytes = 0;     ///< Queries and neighbor lists of one batch
+    size_t voteBytes = 0;      ///< Dense vote arrays of NNResult
+    size_t estimatedBytes = 0; ///< Sum of the above
+    bool fits = false;         ///< estimatedBytes is within the budget
+
+    /**
+     * @brief Returns a one-line description of the plan.
+     */
+    std::string describe() const
+    {
+        static const char *modes[] = {"resident", "reduced", "streamed"};
+        std::ostringstream out;
+        out << modes[static_cast<int>(storage)] << " d=" << dimension << ", batch " << batchRows << " rows";
+        if (storage == StorageMode::Streamed)
+            out << ", " << streaming.residentFeatures << " features resident";
+        if (bufferBytes > 0)
+            out << ", " << streaming.buffers << " x " << (streaming.chunkBytes >> 10) << " KiB chunks";
+        out << ", ~" << (estimatedBytes >> 20) << " MiB" << (fits ? "" : " (over budget)");
+        return out.str();
+    }
+};
+
+/**
+ * @brief Chooses how to run searches within a fixed amount of RAM.
+ *
+ * Memory is estimated from the layout of the library: every feature is a ParentedFeature with
+ * its own descriptor array, held once by the Gallery and once by the searcher; every neighbor
+ * list entry copies a full feature; NNResult keeps dense arrays indexed by Individual ID. plan()
+ * then picks, in order of preference:
+ *   1. Resident storage, if the gallery fits with a batch of minBatchRows;
+ *   2. Reduced storage, the largest PCA dimension that fits (only if minReducedDimension > 0,
+ *      since it changes the results);
+ *   3. Streamed storage: the Individuals stay resident, the chunk buffers get half of what is
+ *      left, and the leading features that fit beside them and a batch of minBatchRows are held
+ *      once by the StreamingSearcher (StreamingOptions::residentFeatures). Only the rest is read
+ *      from disk by every batch; when every feature fits once, nothing is.
+ * Spare memory goes to larger batches, up to maxBatchRows, since each batch is one pass over the
+ * gallery; when streamed, the resident prefix comes first, since it saves reading on every batch.
+ * Estimates include allocator overhead but not the rest of the process, hence reserve, nor the
+ * file mapped by a BinaryReader while a resident gallery loads (release the reader once loaded).
+ * MemoryReport measures what is actually used.
+ */
+struct MemoryBudget
+{
+    size_t bytes = 0;                 ///< RAM allotted to the matcher
+    double reserve = 0.1;             ///< Share of bytes left out of the plan for the rest of the process
+    size_t k = 5;                     ///< Neighbors per query minutia
+    size_t minBatchRows = 64;         ///< Smallest useful batch
+    size_t maxBatchRows = 4096;       ///< Largest batch worth planning
+    unsigned residentCopies = 2;      ///< Copies of every feature when resident (Gallery and searcher)
+    uint32_t minReducedDimension = 0; ///< Smallest PCA dimension accepted (0 never reduces)
+    unsigned streamBuffers = 3;       ///< Chunk buffers when streamed
+    size_t maxChunkBytes = 64 << 20;  ///< Largest chunk read when streamed
+
+    explicit MemoryBudget(size_t bytes = 0) : bytes(bytes) {}
+
+    /**
+     * @brief Returns the estimated size of one feature of the given dimension.
+     */
+    static size_t featureBytes(uint32_t dimension)
+    {
+        return sizeof(ParentedFeature) + dimension * sizeof(float) + allocatorOverhead;
+    }
+
+    /**
+     * @brief Returns the estimated size of the Individuals, without their features.
+     */
+    static size_t individualBytes(const GalleryShape &shape, uint32_t dimension)
+    {
+        // Mean, standard deviation, name and the list of feature IDs
+        return shape.individuals * (sizeof(Individual<ParentedFeature>) + 2 * featureBytes(dimension) + 2 * allocatorOverhead) +
+               shape.features * sizeof(uint32_t);
+    }
+
+    /**
+     * @brief Returns the estimated size of a batch: the queries and their neighbor lists.
+     */
+    size_t batchBytes(size_t rows, uint32_t dimension) const
+    {
+        size_t listBytes = sizeof(NNList<ParentedFeature>) + allocatorOverhead + k * (sizeof(NNEntry<ParentedFeature>) + dimension * sizeof(float) + allocatorOverhead);
+        return rows * (featureBytes(dimension) + listBytes);
+    }
+
+    /**
+     * @brief Returns the estimated size of the vote arrays of NNResult (scores, voted and
+     * touched of its VoteAggregator, each indexed by Individual ID).
+     */
+    static size_t voteBytes(const GalleryShape &shape)
+    {
+        return (shape.individuals + 1) * (sizeof(double) + sizeof(uint8_t) + sizeof(uint32_t));
+    }
+
+    /**
+     * @brief Plans storage and batching for a gallery.
+     */
+    MemoryPlan plan(const GalleryShape &shape) const
+    {
+        size_t usable = static_cast<size_t>(static_cast<double>(bytes) * (1.0 - reserve));
+
+        MemoryPlan result;
+        result.voteBytes = voteBytes(shape);
+
+        // 1. Resident, then 2. reduced, largest dimension first
+        uint32_t lowest = minReducedDimension > 0 ? std::min(minReducedDimension, shape.dimension) : shape.dimension;
+        for (uint32_t d = shape.dimension; d >= std::max(lowest, 1u); --d)
+        {
+            size_t gallery = individualBytes(shape, d) + residentCopies * shape.features * featureBytes(d);
+            if (gallery + result.voteBytes + batchBytes(minBatchRows, d) <= usable)
+            {
+                result.storage = d == shape.dimension ? StorageMode::Resident : StorageMode::Reduced;
+                result.dimension = d;
+                result.galleryBytes = gallery;
+                return finish(result, usable, shape.features);
+            }
+        }
+
+        // 3. Streamed, with a single resident copy of as many leading features as fit
+        result.storage = StorageMode::Streamed;
+        result.dimension = shape.dimension;
+        result.galleryBytes = individualBytes(shape, shape.dimension);
+        size_t left = usable > result.galleryBytes + result.voteBytes ? usable - result.galleryBytes - result.voteBytes : 0;
+        size_t minBatch = batchBytes(minBatchRows, shape.dimension);
+        size_t residentRow = featureBytes(shape.dimension) + sizeof(char); // The feature and its live flag
+        if (shape.features * residentRow + minBatch <= left)
+        {
+            result.streaming.residentFeatures = shape.features;
+            result.galleryBytes += shape.features * residentRow;
+            return finish(result, usable, shape.features);
+        }
+
+        // The buffers get half of what is left, up to streamBuffers x maxChunkBytes; a chunk of
+        // R rows holds the raw rows and the features decoded from them
+        size_t rawRow = 2 * sizeof(uint32_t) + shape.dimension * sizeof(float);
+        size_t bufferRow = rawRow + featureBytes(shape.dimension);
+        unsigned buffers = std::max(1u, streamBuffers);
+        size_t chunkRows = std::min(left / 2 / buffers / bufferRow, maxChunkBytes / rawRow);
+        chunkRows = std::max<size_t>(chunkRows, 1);
+
+        result.streaming.buffers = buffers;
+        result.streaming.chunkBytes = chunkRows * rawRow;
+        result.bufferBytes = buffers * chunkRows * bufferRow;
+
+        size_t spare = left > result.bufferBytes + minBatch ? left - result.bufferBytes - minBatch : 0;
+        result.streaming.residentFeatures = std::min(shape.features, spare / residentRow);
+        result.galleryBytes += result.streaming.residentFeatures * residentRow;
+        return finish(result, usable, shape.features);
+    }
+
+private:
+    static constexpr size_t allocatorOverhead = 16; ///< Bookkeeping of a heap block
+
+    /**
+     * @brief Gives the memory left to the batch and totals the plan.
+     */
+    MemoryPlan finish(MemoryPlan result, size_t usable, size_t features) const
+    {
+        size_t used = result.galleryBytes + result.bufferBytes + result.voteBytes;
+        size_t perRow = batchBytes(1, result.dimension);
+        size_t rows = usable > used ? (usable - used) / perRow : 0;
+        result.batchRows = std::max<size_t>(1, std::min({rows, maxBatchRows, std::max<size_t>(features, 1)}));
+        result.batchBytes = batchBytes(result.batchRows, result.dimension);
+        result.estimatedBytes = used + result.batchBytes;
+        result.fits = result.estimatedBytes <= bytes;
+        return result;
+    }
+};
+
+/**
+ * @brief Memory actually used by each stage of a run (load, build, search...).
+ *
+ * Stages are measured on the resident set of the process. On Linux the peak of each stage is
+ * exact: the high-water mark is reset when the stage begins (/proc/self/clear_refs). Where it
+ * cannot be reset, the peak is the process high-water mark so far and is flagged as such; on
+ * systems without /proc every figure is 0.
+ */
+class MemoryReport
+{
+public:
+    /**
+     * @brief Usage of one stage, in bytes.
+     */
+    struct Stage
+    {
+        std::string name;      ///< Name given to begin()
+        size_t startBytes = 0; ///< Resident set when the stage began
+        size_t peakBytes = 0;  ///< Largest resident set during the stage
+        size_t endBytes = 0;   ///< Resident set when the stage ended
+        bool exactPeak = true; ///< False if peakBytes may include earlier stages
+        double ms = 0;         ///< Duration of the stage
+    };
+
+    /**
+     * @brief Starts a stage, ending the current one.
+     */
+    void begin(const std::string &name)
+    {
+        if (open)
+            end();
+        Stage stage;
+        stage.name = name;
+        stage.exactPeak = resetPeak();
+        stage.startBytes = residentBytes();
+        stages.push_back(stage);
+        start = std::chrono::steady_clock::now();
+        open = true;
+    }
+
+    /**
+     * @brief Ends the current stage.
+     */
+    void end()
+    {
+        if (!open)
+            return;
+        Stage &stage = stages.back();
+        stage.endBytes = residentBytes();
+        stage.peakBytes = std::max({peakResidentBytes(), stage.startBytes, stage.endBytes});
+        stage.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        open = false;
+    }
+
+    /**
+     * @brief Returns the measured stages, in order.
+     */
+    const std::vector<Stage> &getStages() const
+    {
+        return stages;
+    }
+
+    /**
+     * @brief Returns the largest peak over all stages.
+     */
+    size_t peakBytes() const
+    {
+        size_t peak = 0;
+        for (const auto &stage : stages)
+        {
+            peak = std::max(peak, stage.peakBytes);
+        }
+        return peak;
+    }
+
+    /**
+     * @brief Prints one line per stage, in MiB, flagging peaks over the budget (0 disables the check).
+     */
+    void print(std::ostream &os, size_t budgetBytes = 0) const
+    {
+        for (const auto &stage : stages)
+        {
+            os << stage.name << ": peak " << mib(stage.peakBytes) << (stage.exactPeak ? "" : " (process)") << " MiB, "
+               << mib(stage.startBytes) << " -> " << mib(stage.endBytes) << " MiB, " << stage.ms << " ms"
+               << (budgetBytes != 0 && stage.peakBytes > budgetBytes ? "  OVER BUDGET" : "") << "\n";
+        }
+    }
+
+    /**
+     * @brief Returns the current resident set of the process (0 if unknown).
+     */
+    static size_t residentBytes()
+    {
+        return statusField("VmRSS:");
+    }
+
+    /**
+     * @brief Returns the high-water mark of the resident set (0 if unknown).
+     */
+    static size_t peakResidentBytes()
+    {
+        return statusField("VmHWM:");
+    }
+
+    /**
+     * @brief Resets the high-water mark to the current resident set; returns false if unsupported.
+     */
+    static bool resetPeak()
+    {
+        std::ofstream clear("/proc/self/clear_refs");
+        if (!clear.is_open())
+            return false;
+        clear << "5";
+        clear.close();
+        return !clear.fail();
+    }
+
+private:
+    static double mib(size_t bytes)
+    {
+        return static_cast<double>(bytes) / (1 << 20);
+    }
+
+    /**
+     * @brief Reads a "Name: value kB" line of /proc/self/status.
+     */
+    static size_t statusField(const std::string &field)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, field.size(), field) == 0)
+                return static_cast<size_t>(std::stoull(line.substr(field.size()))) * 1024;
+        }
+        return 0;
+    }
+
+    std::vector<Stage> stages;                   ///< Measured stages
+    std::chrono::steady_clock::time_point start; ///< When the current stage began
+    bool open = false;                           ///< A stage is being measured
+};
+
+#endif // MEMORY_BUDGET_HPP
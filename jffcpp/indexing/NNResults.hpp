@@ -2,84 +2,108 @@
 #define NNRESULT_HPP
 
 #include <vector>
-#include <unordered_map>
-#include <unordered_set>
-#include <algorithm>
+#include <string>
+#include <stdexcept>
+#include <variant>   // For std::variant, std::visit
 #include "NNList.hpp"
+#include "VoteAggregator.hpp"
 
-template <typename T>
+/**
+ * @brief Ranks Individuals from the k-nearest neighbors of every query minutia.
+ *
+ * Neighbor lists are consumed as they are added into one dense score per Individual under the
+ * voting policy chosen at compile time, so no neighbor is copied, no other policy is paid for and
+ * nothing is sorted beyond the requested top-k. See DynamicNNResult to pick the policy by name.
+ *
+ * @tparam T The type of the neighbors.
+ * @tparam Policy FrequencyVote, DistanceVote or WeightedVote.
+ */
+template <typename T, typename Policy = FrequencyVote>
 class NNResult {
 public:
+    NNResult() = default;
+
     NNResult(const std::vector<NNList<T>>& knn_lists) {
-        // Flatten the list
         for (const auto& knn_list : knn_lists) {
-            for (const auto& entry : knn_list) {
-                knn_list_.emplace_back(entry);
-            }
+            add(knn_list);
         }
     }
 
-    std::vector<std::pair<uint32_t, double>> pickBest(size_t k, const std::string& method) {
-        if (method == "frequency") {
-            return pickBestFrequency(k);
-        } else if (method == "distance") {
-            return pickBestDistance(k);
-        } else {
-            throw std::invalid_argument("Unknown method: " + method);
-        }
+    /**
+     * @brief Adds the neighbors of one more query minutia.
+     */
+    void add(const NNList<T>& knn_list) {
+        votes_.add(knn_list);
     }
 
-private:
-    std::vector<std::pair<uint32_t, double>> pickBestFrequency(size_t k) {
-        std::unordered_map<uint32_t, size_t> freq;
-        for (const auto& entry : knn_list_) {
-            freq[entry.element.representative->getId()]++;
-        }
+    /**
+     * @brief Adds one neighbor given by its Individual, e.g. from lists merged across shards.
+     *
+     * @param individualId ID of the Individual owning the neighbor.
+     * @param distance Distance of the neighbor.
+     * @param rank Rank of the neighbor in its list (0 = nearest).
+     */
+    void add(uint32_t individualId, double distance, size_t rank) {
+        votes_.add(individualId, distance, rank);
+    }
 
-        // Convert to vector of pairs and sort by frequency
-        std::vector<std::pair<uint32_t, size_t>> freq_vec(freq.begin(), freq.end());
-        std::sort(freq_vec.begin(), freq_vec.end(), [](const auto& a, const auto& b) {
-            return a.second > b.second;
-        });
+    /**
+     * @brief Returns the k best Individuals (ID, score).
+     */
+    std::vector<std::pair<uint32_t, double>> pickBest(size_t k) const {
+        return votes_.top(k);
+    }
 
-        // Return the k most frequent elements
-        std::vector<std::pair<uint32_t, double>> best;
-        for (size_t i = 0; i < k && i < freq_vec.size(); ++i) {
-            best.emplace_back(freq_vec[i].first, static_cast<double>(freq_vec[i].second));
+    // Cout
+    friend std::ostream& operator<<(std::ostream& os, const NNResult& knn_result) {
+        for (const auto& best : knn_result.votes_.top(knn_result.votes_.numVoted())) {
+            os << best.first << " " << best.second << "; ";
         }
-        return best;
+        return os;
     }
 
-    std::vector<std::pair<uint32_t, double>> pickBestDistance(size_t k) {
-        // Sort by distance
-        std::sort(knn_list_.begin(), knn_list_.end(), [](const auto& a, const auto& b) {
-            return a.distance < b.distance;
-        });
+private:
+    VoteAggregator<Policy> votes_; ///< Score per Individual
+};
 
-        // Return the k closest different elements
-        std::vector<std::pair<uint32_t, double>> best;
-        std::unordered_set<uint32_t> seen;
-        for (const auto& entry : knn_list_) {
-            if (seen.find(entry.element.representative->getId()) == seen.end()) {
-                best.emplace_back(entry.element.representative->getId(), entry.distance);
-                seen.insert(entry.element.representative->getId());
-            }
-            if (best.size() == k) {
-                break;
-            }
+/**
+ * @brief NNResult whose policy is selected at run time by name ("frequency", "distance" or
+ * "weighted"), e.g. from a network request. Holds a single NNResult of that policy.
+ *
+ * @tparam T The type of the neighbors.
+ */
+template <typename T>
+class DynamicNNResult {
+public:
+    /**
+     * @throws std::invalid_argument if the method is unknown.
+     */
+    explicit DynamicNNResult(const std::string& method) {
+        if (method == "frequency") {
+            result_ = NNResult<T, FrequencyVote>();
+        } else if (method == "distance") {
+            result_ = NNResult<T, DistanceVote>();
+        } else if (method == "weighted") {
+            result_ = NNResult<T, WeightedVote>();
+        } else {
+            throw std::invalid_argument("Unknown method: " + method);
         }
-        return best;
     }
 
-    // Cout
-    friend std::ostream& operator<<(std::ostream& os, const NNResult<T>& knn_result) {
-        for (const auto& entry : knn_result.knn_list_) {
-            os << entry.element << " " << entry.distance << "; ";
-        }
-        return os;
+    void add(const NNList<T>& knn_list) {
+        std::visit([&](auto& result) { result.add(knn_list); }, result_);
+    }
+
+    void add(uint32_t individualId, double distance, size_t rank) {
+        std::visit([&](auto& result) { result.add(individualId, distance, rank); }, result_);
     }
 
-    std::vector<NNEntry<T>> knn_list_;
+    std::vector<std::pair<uint32_t, double>> pickBest(size_t k) const {
+        return std::visit([&](const auto& result) { return result.pickBest(k); }, result_);
+    }
+
+private:
+    std::variant<NNResult<T, FrequencyVote>, NNResult<T, DistanceVote>, NNResult<T, WeightedVote>> result_; ///< Result of the selected policy
 };
 
-#endif // NNRESULT_HPP
\ No newline at end of file
+#endif // NNRESULT_HPP
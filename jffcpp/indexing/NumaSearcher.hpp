@@ -0,0 +1,384 @@
+#ifndef NUMA_SEARCHER_HPP
+#define NUMA_SEARCHER_HPP
+
+#include <vector>
+#include <chrono>      // For std::chrono::steady_clock
+#include <algorithm>   // For std::min, std::max
+#include <stdexcept>   // For std::invalid_argument
+#include <mutex>       // For std::mutex, std::lock_guard
+#include <functional>  // For std::function
+#include "NNList.hpp"
+#include "SearchFilter.hpp"
+#include "../math/DistanceFunction.hpp"
+#include "../concurrency/Numa.hpp"
+
+/**
+ * @brief Where a NumaSearcher keeps the objects.
+ */
+enum class NumaPlacement
+{
+    Unplaced,    ///< One copy wherever the caller's thread allocates it (the baseline)
+    Partitioned, ///< Each node holds a contiguous part, scanned only by its own threads
+    Replicated   ///< Each node holds a full copy and searches its share of the queries
+};
+
+/**
+ * @brief Settings of a NumaSearcher.
+ */
+struct NumaOptions
+{
+    NumaPlacement placement = NumaPlacement::Partitioned; ///< Where the objects live
+    unsigned threadsPerNode = 0;                          ///< Search threads per node (0 means one per CPU of the node)
+    bool pin = true;                                      ///< Pin every search thread to the CPUs of its node
+};
+
+/**
+ * @brief Work done by the threads of one node during the last search.
+ */
+struct NumaNodeStats
+{
+    unsigned node = 0;      ///< Node number
+    size_t objects = 0;     ///< Objects scanned by the node
+    uint64_t bytes = 0;     ///< Descriptor bytes streamed by the node
+    double ms = 0;          ///< Time of the slowest thread of the node
+    double gbPerSecond = 0; ///< Scan bandwidth of the node
+};
+
+/**
+ * @brief Parallel sequential search laid out for NUMA machines.
+ *
+ * A gallery loaded by one thread lives on one node, so threads on the other sockets read it
+ * across the interconnect. With Partitioned placement the objects are split into one contiguous
+ * part per node, at Individual boundaries and in proportion to the CPUs of each node, and every
+ * part is copied by a thread pinned to its node so that the kernel places it there (first touch).
+ * The threads of a node only scan their local part; the queries, which every thread reads for
+ * each object, are copied per thread as well. Replicated placement keeps a full local copy per
+ * node instead and splits the queries between nodes: no remote reads at all, at the price of one
+ * gallery per node, for small hot galleries. Unplaced keeps a single copy, as
+ * SequentialSearcher does, and is the baseline of the benchmark (see lastStats()).
+ *
+ * The search threads are started and pinned once, at construction (NumaThreadPool), and serve
+ * every search; concurrent searches run one after the other. Every thread scans its range with
+ * the block loop of SequentialSearcher::knnBatch and the partial lists are merged in object order,
+ * so each list holds the same neighbors as SequentialSearcher::knnBatch over the same objects (up
+ * to exact distance ties). Distances go through the DistanceFunc, whose per-thread call counter
+ * keeps the threads of different nodes off a shared cache line. The objects are a copy taken at
+ * construction: build a new searcher after enrolling. Retired Individuals are skipped.
+ *
+ * @tparam T The type of the objects (ParentedFeature).
+ * @tparam DistanceFunc The distance function.
+ */
+template <typename T, typename DistanceFunc>
+class NumaSearcher
+{
+public:
+    /**
+     * @brief Places the objects on the nodes.
+     *
+     * @param objects The objects, e.g. Gallery::getFeatures().
+     * @param distanceFunc The distance function.
+     * @param topology The nodes to use (see NumaTopology::detect).
+     * @param options Placement and threads.
+     */
+    NumaSearcher(const std::vector<T> &objects, DistanceFunc &distanceFunc, NumaTopology topology = NumaTopology::detect(), NumaOptions options = NumaOptions())
+        : distanceFunc(distanceFunc), topology(std::move(topology)), options(options), count(objects.size()),
+          pool(this->topology, threadCounts(this->topology, options), options.pin)
+    {
+        const auto &nodes = this->topology.getNodes();
+        if (options.placement == NumaPlacement::Unplaced)
+        {
+            parts.push_back({objects, 0, objects.size()});
+            return;
+        }
+
+        std::vector<size_t> bounds(nodes.size() + 1, objects.size());
+        bounds[0] = 0;
+        if (options.placement == NumaPlacement::Partitioned)
+        {
+            size_t totalCpus = 0;
+            for (const auto &node : nodes)
+            {
+                totalCpus += node.cpus.size();
+            }
+            size_t cpus = 0;
+            for (size_t n = 1; n < nodes.size(); ++n)
+            {
+                cpus += nodes[n - 1].cpus.size();
+                bounds[n] = individualBoundary(objects, std::max(bounds[n - 1], objects.size() * cpus / totalCpus));
+            }
+        }
+
+        parts.resize(nodes.size());
+        for (size_t n = 0; n < nodes.size(); ++n)
+        {
+            size_t begin = options.placement == NumaPlacement::Partitioned ? bounds[n] : 0;
+            size_t end = options.placement == NumaPlacement::Partitioned ? bounds[n + 1] : objects.size();
+            runOnNode(nodes[n], [&]
+                      { parts[n].objects.assign(objects.begin() + begin, objects.begin() + end); });
+            parts[n].begin = begin;
+            parts[n].end = end;
+        }
+    }
+
+    /**
+     * @brief Returns the number of objects searched (each counted once when replicated).
+     */
+    size_t size() const
+    {
+        return count;
+    }
+
+    const NumaTopology &getTopology() const
+    {
+        return topology;
+    }
+
+    /**
+     * @brief Searches the k-nearest neighbors of one query.
+     */
+    NNList<T> knn(T &query, size_t k, const SearchFilter &filter = SearchFilter())
+    {
+        std::vector<T> queries{query};
+        return std::move(knnBatch(queries, k, filter)[0]);
+    }
+
+    /**
+     * @brief Searches the k-nearest neighbors of several queries on every node at once.
+     *
+     * @param queries The query objects.
+     * @param ks The number of nearest neighbors of each query.
+     * @param filter Restricts the searched Individuals.
+     * @return std::vector<NNList<T>> The neighbors of each query.
+     */
+    std::vector<NNList<T>> knnBatch(std::vector<T> &queries, const std::vector<size_t> &ks, const SearchFilter &filter = SearchFilter())
+    {
+        if (ks.size() != queries.size())
+            throw std::invalid_argument("knnBatch needs one k per query");
+        size_t dimension = dimensionOf();
+        for (const auto &query : queries)
+        {
+            if (count > 0 && query.size() != dimension)
+                throw std::invalid_argument("Vectors must be of the same size");
+        }
+
+        std::vector<Task> tasks = planTasks(queries.size());
+        std::vector<std::vector<NNList<T>>> partial(tasks.size());
+        std::vector<double> taskMs(tasks.size(), 0.0);
+
+        std::vector<std::function<void()>> jobs(pool.size());
+        for (size_t t = 0; t < tasks.size(); ++t)
+        {
+            jobs[tasks[t].worker] = [&, t]
+            {
+                const Task &task = tasks[t];
+                auto start = std::chrono::steady_clock::now();
+
+                // Local copy of the hot queries, written by this thread
+                std::vector<T> local(queries.begin() + task.queryBegin, queries.begin() + task.queryEnd);
+                auto &lists = partial[t];
+                lists.reserve(local.size());
+                for (size_t q = task.queryBegin; q < task.queryEnd; ++q)
+                {
+                    lists.emplace_back(ks[q]);
+                }
+                scan(local, lists, parts[task.part].objects, task.begin, task.end, filter);
+                taskMs[t] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            };
+        }
+        pool.run(jobs);
+
+        // Merge the partial lists of each query in object order
+        std::vector<NNList<T>> lists;
+        lists.reserve(queries.size());
+        for (size_t k : ks)
+        {
+            lists.emplace_back(k);
+        }
+        for (size_t t = 0; t < tasks.size(); ++t)
+        {
+            for (size_t q = tasks[t].queryBegin; q < tasks[t].queryEnd; ++q)
+            {
+                for (const auto &entry : partial[t][q - tasks[t].queryBegin])
+                {
+                    lists[q].insert(entry.element, entry.distance);
+                }
+            }
+        }
+
+        std::vector<NumaNodeStats> nodeStats(topology.size());
+        for (size_t t = 0; t < tasks.size(); ++t)
+        {
+            NumaNodeStats &node = nodeStats[tasks[t].node];
+            node.node = topology.getNodes()[tasks[t].node].id;
+            size_t scanned = tasks[t].end - tasks[t].begin;
+            node.objects += scanned;
+            node.bytes += scanned * dimension * sizeof(float);
+            node.ms = std::max(node.ms, taskMs[t]);
+        }
+        for (auto &node : nodeStats)
+        {
+            node.gbPerSecond = node.ms > 0 ? static_cast<double>(node.bytes) / node.ms / 1e6 : 0.0;
+        }
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            stats = std::move(nodeStats);
+        }
+        return lists;
+    }
+
+    /**
+     * @brief Searches the k-nearest neighbors of several queries with the same k.
+     */
+    std::vector<NNList<T>> knnBatch(std::vector<T> &queries, size_t k, const SearchFilter &filter = SearchFilter())
+    {
+        return knnBatch(queries, std::vector<size_t>(queries.size(), k), filter);
+    }
+
+    /**
+     * @brief Returns what each node did during the last search.
+     */
+    std::vector<NumaNodeStats> lastStats() const
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        return stats;
+    }
+
+private:
+    static constexpr size_t blockSize = 256; ///< Objects compared with every query while in cache
+
+    /**
+     * @brief Objects of one node, with their position in the original order.
+     */
+    struct Part
+    {
+        std::vector<T> objects; ///< Objects placed on the node
+        size_t begin = 0;       ///< Index of the first one in the original order
+        size_t end = 0;         ///< Index past the last one
+    };
+
+    /**
+     * @brief Range of objects and queries searched by one thread.
+     */
+    struct Task
+    {
+        size_t worker;               ///< Pool worker running it
+        size_t node;                 ///< Node the thread runs on
+        size_t part;                 ///< Part it scans
+        size_t begin, end;           ///< Objects of the part
+        size_t queryBegin, queryEnd; ///< Queries searched
+    };
+
+    /**
+     * @brief Splits the search into one task per thread, ordered by object position for the merge.
+     */
+    std::vector<Task> planTasks(size_t nQueries) const
+    {
+        const auto &nodes = topology.getNodes();
+        std::vector<size_t> threadsPerNode = threadCounts(topology, options);
+        std::vector<Task> tasks;
+        size_t firstWorker = 0;
+        for (size_t n = 0; n < nodes.size(); firstWorker += threadsPerNode[n++])
+        {
+            size_t threads = threadsPerNode[n];
+
+            size_t part = 0, begin = 0, end = count, queryBegin = 0, queryEnd = nQueries;
+            if (options.placement == NumaPlacement::Unplaced)
+            {
+                // Every node scans a share of the single copy, wherever it lives
+                begin = count * n / nodes.size();
+                end = count * (n + 1) / nodes.size();
+            }
+            else if (options.placement == NumaPlacement::Partitioned)
+            {
+                part = n;
+                end = parts[n].objects.size();
+            }
+            else
+            {
+                part = n;
+                queryBegin = nQueries * n / nodes.size();
+                queryEnd = nQueries * (n + 1) / nodes.size();
+                if (queryBegin == queryEnd)
+                    continue;
+            }
+
+            for (size_t t = 0; t < threads; ++t)
+            {
+                size_t from = begin + (end - begin) * t / threads;
+                size_t to = begin + (end - begin) * (t + 1) / threads;
+                if (from < to || (t == 0 && begin == end))
+                    tasks.push_back({firstWorker + t, n, part, from, to, queryBegin, queryEnd});
+            }
+        }
+        return tasks;
+    }
+
+    /**
+     * @brief Returns the number of search threads of each node.
+     */
+    static std::vector<size_t> threadCounts(const NumaTopology &topology, const NumaOptions &options)
+    {
+        std::vector<size_t> threads;
+        for (const auto &node : topology.getNodes())
+        {
+            threads.push_back(std::max<size_t>(options.threadsPerNode != 0 ? options.threadsPerNode : node.cpus.size(), 1));
+        }
+        return threads;
+    }
+
+    /**
+     * @brief Returns the dimension of the objects (0 if there are none).
+     */
+    size_t dimensionOf() const
+    {
+        for (const auto &part : parts)
+        {
+            if (!part.objects.empty())
+                return part.objects[0].size();
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Adds objects [begin, end) to the lists, block by block.
+     */
+    void scan(std::vector<T> &queries, std::vector<NNList<T>> &lists, const std::vector<T> &objects, size_t begin, size_t end, const SearchFilter &filter) const
+    {
+        for (size_t blockBegin = begin; blockBegin < end; blockBegin += blockSize)
+        {
+            size_t blockEnd = std::min(blockBegin + blockSize, end);
+            for (size_t q = 0; q < queries.size(); ++q)
+            {
+                for (size_t i = blockBegin; i < blockEnd; ++i)
+                {
+                    if (isRetired(objects[i]) || (filter.active() && !filter.allows(representativeOf(objects[i]))))
+                        continue;
+                    lists[q].insert(objects[i], distanceFunc(queries[q], objects[i]));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Moves a split point forward to the start of the next Individual.
+     */
+    static size_t individualBoundary(const std::vector<T> &objects, size_t i)
+    {
+        while (i > 0 && i < objects.size() && representativeOf(objects[i]) != nullptr && representativeOf(objects[i]) == representativeOf(objects[i - 1]))
+        {
+            ++i;
+        }
+        return i;
+    }
+
+    DistanceFunc &distanceFunc;       ///< Distance function
+    NumaTopology topology;            ///< Nodes used
+    NumaOptions options;              ///< Placement and threads
+    size_t count;                     ///< Number of objects
+    NumaThreadPool pool;              ///< Search threads, pinned to their nodes
+    std::vector<Part> parts;          ///< One per node (a single one when Unplaced)
+    mutable std::mutex statsMutex;    ///< Guards stats
+    std::vector<NumaNodeStats> stats; ///< Work of each node during the last search
+};
+
+#endif // NUMA_SEARCHER_HPP
@@ -0,0 +1,543 @@
+#ifndef PIVOT_SEARCHER_HPP
+#define PIVOT_SEARCHER_HPP
+
+#include <vector>
+#include <algorithm>   // For std::max, std::min
+#include <limits>      // For std::numeric_limits
+#include <cstdint>     // For uint16_t
+#include <cmath>       // For std::floor, std::abs
+#include <type_traits> // For std::is_same_v
+#include "SequentialSearcher.hpp"
+#include "../concurrency/Parallel.hpp"
+
+/**
+ * @brief Column-major table of distances from every data object to a set of pivots (LAESA).
+ *
+ * Each pivot owns a contiguous column, so lower bounds for a block of rows are computed with
+ * one tight loop per pivot that the compiler can vectorize.
+ *
+ * @tparam V Storage type of the distances: float (exact) or uint16_t (quantized, 2 bytes per cell).
+ */
+template <typename V = float>
+class PivotTable
+{
+    static_assert(std::is_same_v<V, float> || std::is_same_v<V, uint16_t>, "PivotTable stores float or uint16_t");
+
+public:
+    PivotTable() : rows(0), cols(0), step(1.0f) {}
+
+    /**
+     * @brief Allocates the table.
+     *
+     * @param nRows The number of data objects.
+     * @param nPivots The number of pivots.
+     * @param maxDistance Largest distance to be stored, used to pick the quantization step.
+     */
+    void resize(size_t nRows, size_t nPivots, float maxDistance)
+    {
+        rows = nRows;
+        cols = nPivots;
+        cells.assign(rows * cols, V(0));
+        if constexpr (std::is_same_v<V, uint16_t>)
+        {
+            // Keep the top code free so floor(d / step) never overflows
+            step = maxDistance > 0 ? maxDistance / 65534.0f : 1.0f;
+        }
+    }
+
+    /**
+     * @brief Stores the distance between a data object and a pivot.
+     */
+    void set(size_t row, size_t pivot, float distance)
+    {
+        if constexpr (std::is_same_v<V, uint16_t>)
+        {
+            float code = std::floor(distance / step);
+            cells[pivot * rows + row] = static_cast<uint16_t>(std::min(code, 65535.0f));
+        }
+        else
+        {
+            cells[pivot * rows + row] = distance;
+        }
+    }
+
+    /**
+     * @brief Computes max_p |d(q, p) - d(x, p)| for the rows in [begin, end).
+     *
+     * By the triangle inequality the result is a lower bound of d(q, x). For quantized storage
+     * the stored value is an interval [code * step, (code + 1) * step] and the bound is taken
+     * against the nearest end of it, so it stays a valid lower bound.
+     *
+     * @param queryToPivot Distances from the query to each pivot.
+     * @param begin First row of the block.
+     * @param end One past the last row of the block.
+     * @param out Output buffer with at least end - begin elements.
+     */
+    void lowerBounds(const std::vector<float> &queryToPivot, size_t begin, size_t end, float *out) const
+    {
+        size_t n = end - begin;
+        std::fill(out, out + n, 0.0f);
+
+        for (size_t p = 0; p < cols; ++p)
+        {
+            const V *column = cells.data() + p * rows + begin;
+            const float dq = queryToPivot[p];
+            if constexpr (std::is_same_v<V, uint16_t>)
+            {
+                const float s = step;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    float low = column[i] * s;
+                    float bound = std::max(dq - (low + s), low - dq);
+                    out[i] = std::max(out[i], bound);
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out[i] = std::max(out[i], std::abs(dq - column[i]));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Drops the rows whose keep flag is false, preserving the order of the others.
+     *
+     * @param keep keep[i] tells whether row i is kept (rows beyond keep.size() are dropped).
+     */
+    void compact(const std::vector<bool> &keep)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < rows && i < keep.size(); ++i)
+        {
+            kept += keep[i];
+        }
+
+        std::vector<V> compacted(kept * cols);
+        for (size_t p = 0; p < cols; ++p)
+        {
+            size_t out = p * kept;
+            for (size_t i = 0; i < rows && i < keep.size(); ++i)
+            {
+                if (keep[i])
+                    compacted[out++] = cells[p * rows + i];
+            }
+        }
+        cells.swap(compacted);
+        rows = kept;
+    }
+
+    /**
+     * @brief Writes the raw table to the current section.
+     */
+    void write(BinaryWriter &writer) const
+    {
+        writer.write(uint64_t(rows));
+        writer.write(uint64_t(cols));
+        writer.write(step);
+        writer.writeArray(cells.data(), cells.size());
+    }
+
+    /**
+     * @brief Reads a table written by write().
+     *
+     * @throws std::runtime_error if the payload cannot hold rows x cols cells.
+     */
+    void read(SectionReader &section)
+    {
+        uint64_t savedRows = section.read<uint64_t>();
+        uint64_t savedCols = section.read<uint64_t>();
+        step = section.read<float>();
+        // Checked by division, so rows * cols cannot wrap
+        if (savedCols != 0 && savedRows > section.remaining() / sizeof(V) / savedCols)
+            throw std::runtime_error("Pivot table larger than its section");
+        rows = savedRows;
+        cols = savedCols;
+        cells.resize(rows * cols);
+        section.readArray(cells.data(), cells.size());
+    }
+
+    size_t numRows() const { return rows; }
+    size_t numPivots() const { return cols; }
+
+    /**
+     * @brief Returns the memory used by the table, in bytes.
+     */
+    size_t memoryUsage() const { return cells.size() * sizeof(V); }
+
+private:
+    std::vector<V> cells; ///< Column-major distances, cells[pivot * rows + row]
+    size_t rows;          ///< Number of data objects
+    size_t cols;          ///< Number of pivots
+    float step;           ///< Quantization step (only used for uint16_t)
+};
+
+/**
+ * @brief Selects pivots by incremental max-spread (farthest-first traversal).
+ *
+ * Starting from the first object, each new pivot is the object farthest from all the pivots
+ * chosen so far. Distances to the newest pivot are computed in parallel.
+ *
+ * @param objects The data objects.
+ * @param nPivots The number of pivots to select.
+ * @param distanceFunc The distance function.
+ * @param nThreads The number of threads (0 means hardware concurrency).
+ * @return The indices of the selected pivots in objects.
+ */
+template <typename T, typename DistanceFunc>
+std::vector<size_t> selectPivots(const std::vector<T> &objects, size_t nPivots, const DistanceFunc &distanceFunc, unsigned nThreads = 0)
+{
+    std::vector<size_t> pivots;
+    if (objects.empty() || nPivots == 0)
+        return pivots;
+
+    std::vector<float> minDist(objects.size(), std::numeric_limits<float>::infinity());
+    size_t next = 0;
+
+    while (pivots.size() < std::min(nPivots, objects.size()))
+    {
+        pivots.push_back(next);
+        const T &pivot = objects[next];
+
+        parallelFor(objects.size(), nThreads, [&](size_t begin, size_t end)
+                    {
+            for (size_t i = begin; i < end; ++i)
+            {
+                minDist[i] = std::min(minDist[i], static_cast<float>(distanceFunc(pivot, objects[i])));
+            } });
+
+        next = static_cast<size_t>(std::max_element(minDist.begin(), minDist.end()) - minDist.begin());
+        if (minDist[next] == 0.0f)
+            break; // Every remaining object coincides with a pivot
+    }
+
+    return pivots;
+}
+
+/**
+ * @brief Sequential searcher that skips objects using a pivot table (LAESA-style filtering).
+ *
+ * After build(), knn() computes the query-to-pivot distances once and, block by block, only
+ * evaluates the full distance for rows whose pivot lower bound can still enter the result.
+ * The answer is exact for any metric distance (Euclidean, Manhattan, Chebyshev); distances
+ * that violate the triangle inequality (cosine) must not be used.
+ *
+ * Objects added after build() are searched without filtering until build() is called again.
+ * Pivots are detached copies, so retiring the Individual of a pivot does not invalidate the table.
+ *
+ * @tparam T The type of the objects stored in dataObjects.
+ * @tparam DistanceFunc The type of the distance function.
+ * @tparam V Storage type of the pivot table (float or uint16_t).
+ */
+template <typename T, typename DistanceFunc, typename V = float>
+class PivotSearcher : public SequentialSearcher<T, DistanceFunc>
+{
+    using Base = SequentialSearcher<T, DistanceFunc>;
+    using Segment = typename Base::Segment;
+    using Snapshot = typename Base::Snapshot;
+
+public:
+    /**
+     * @brief Constructs a PivotSearcher with the given distance function.
+     *
+     * @param distFunc The distance function to evaluate distance between objects.
+     */
+    PivotSearcher(DistanceFunc &distFunc) : SequentialSearcher<T, DistanceFunc>(distFunc) {}
+
+    /**
+     * @brief Selects the pivots and fills the pivot table over the current data objects.
+     *
+     * All segments are merged into a single indexed segment. Searches keep running on the
+     * previous snapshot while the table is built.
+     *
+     * @param nPivots The number of pivots.
+     * @param nThreads The number of threads (0 means hardware concurrency).
+     */
+    void build(size_t nPivots, unsigned nThreads = 0)
+    {
+        std::lock_guard<std::mutex> writeLock(this->updateMutex);
+
+        // Only writers retire snapshots, so the current one stays valid while updateMutex is held
+        const Snapshot *old = this->snapshot();
+        auto segment = std::make_shared<PivotSegment>();
+        auto &objects = segment->objects;
+        objects.reserve(old->size);
+        for (const auto &oldSegment : old->segments)
+        {
+            objects.insert(objects.end(), oldSegment->objects.begin(), oldSegment->objects.end());
+        }
+
+        auto newPivots = std::make_shared<std::vector<T>>();
+        for (size_t index : selectPivots(objects, nPivots, this->distanceFunc, nThreads))
+        {
+            newPivots->push_back(objects[index]);
+            setRepresentative(newPivots->back(), nullptr);
+        }
+        const auto &pivots = *newPivots;
+
+        std::vector<float> distances(objects.size() * pivots.size());
+        parallelFor(objects.size(), nThreads, [&](size_t begin, size_t end)
+                    {
+            for (size_t i = begin; i < end; ++i)
+            {
+                for (size_t p = 0; p < pivots.size(); ++p)
+                {
+                    distances[i * pivots.size() + p] = this->distanceFunc(pivots[p], objects[i]);
+                }
+            } });
+
+        float maxDistance = distances.empty() ? 0.0f : *std::max_element(distances.begin(), distances.end());
+        segment->table.resize(objects.size(), pivots.size(), maxDistance);
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            for (size_t p = 0; p < pivots.size(); ++p)
+            {
+                segment->table.set(i, p, distances[i * pivots.size() + p]);
+            }
+        }
+        segment->pivots = std::move(newPivots);
+        segment->seal();
+
+        auto next = std::make_unique<Snapshot>();
+        next->size = objects.size();
+        next->segments.push_back(std::move(segment));
+        this->publish(std::move(next));
+    }
+
+    using Base::knn;
+    using Base::knnBatch;
+
+    /**
+     * @brief Performs k-nearest neighbors search, filtering with the pivot table.
+     *
+     * @param query The query object.
+     * @param k The number of nearest neighbors to find.
+     * @param filter Restricts the searched Individuals.
+     * @return NNList<T> The list of k-nearest neighbors.
+     */
+    NNList<T> knn(T &query, size_t k, const SearchFilter &filter) const override
+    {
+        EpochGuard guard(EpochManager::global());
+        NNList<T> nnList(k);
+
+        const std::vector<T> *queryPivots = nullptr;
+        std::vector<float> queryToPivot;
+        float bounds[blockSize];
+
+        for (const auto &baseSegment : this->snapshot()->segments)
+        {
+            // Every segment of this searcher is created by newSegment()
+            const auto &segment = static_cast<const PivotSegment &>(*baseSegment);
+            const auto &objects = segment.objects;
+            const auto &table = segment.table;
+            size_t indexed = std::min(table.numRows(), objects.size());
+
+            if (indexed > 0 && segment.pivots.get() != queryPivots)
+            {
+                queryPivots = segment.pivots.get();
+                queryToPivot.resize(queryPivots->size());
+                for (size_t p = 0; p < queryPivots->size(); ++p)
+                {
+                    queryToPivot[p] = this->distanceFunc(query, (*queryPivots)[p]);
+                }
+            }
+
+            Base::forEachRun(segment, filter, [&](size_t runBegin, size_t runEnd, const Individual<ParentedFeature> *)
+                             {
+                size_t indexedEnd = std::min(runEnd, std::max(runBegin, indexed));
+                for (size_t begin = runBegin; begin < indexedEnd; begin += blockSize)
+                {
+                    size_t end = std::min(indexedEnd, begin + blockSize);
+                    table.lowerBounds(queryToPivot, begin, end, bounds);
+
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        // Only compare against the k-th distance once the list is full
+                        if (nnList.size() >= k && bounds[i - begin] >= nnList.getMaxDistance())
+                            continue;
+
+                        nnList.insert(objects[i], this->distanceFunc(query, objects[i]));
+                    }
+                }
+
+                // Objects added after build() have no pivot distances
+                for (size_t i = indexedEnd; i < runEnd; ++i)
+                {
+                    nnList.insert(objects[i], this->distanceFunc(query, objects[i]));
+                } });
+        }
+
+        return nnList;
+    }
+
+    /**
+     * @brief Searches several queries, one knn() each: the pivot bounds prune per query, which
+     * pays off more than sharing one unpruned pass.
+     */
+    std::vector<NNList<T>> knnBatch(std::vector<T> &queries, const std::vector<size_t> &ks, const SearchFilter &filter = SearchFilter()) const override
+    {
+        if (ks.size() != queries.size())
+            throw std::invalid_argument("knnBatch needs one k per query");
+
+        std::vector<NNList<T>> lists;
+        lists.reserve(queries.size());
+        for (size_t q = 0; q < queries.size(); ++q)
+        {
+            lists.push_back(knn(queries[q], ks[q], filter));
+        }
+        return lists;
+    }
+
+    /**
+     * @brief Returns the name of the searcher type, including the table storage.
+     */
+    std::string kind() const override
+    {
+        return std::is_same_v<V, float> ? "PivotSearcher<float>" : "PivotSearcher<uint16>";
+    }
+
+    /**
+     * @brief Returns the number of objects covered by a pivot table.
+     */
+    size_t indexedSize() const
+    {
+        EpochGuard guard(EpochManager::global());
+        size_t indexed = 0;
+        for (const auto &segment : this->snapshot()->segments)
+        {
+            indexed += static_cast<const PivotSegment &>(*segment).table.numRows();
+        }
+        return indexed;
+    }
+
+protected:
+    /**
+     * @brief Segment with the pivot distances of its first table.numRows() objects.
+     */
+    struct PivotSegment : Segment
+    {
+        std::shared_ptr<const std::vector<T>> pivots; ///< Pivots the table was built with
+        PivotTable<V> table;                          ///< Distances from the objects to the pivots
+    };
+
+    std::map<std::string, std::string> buildParams(const Snapshot &snap) const override
+    {
+        size_t nPivots = 0;
+        for (const auto &segment : snap.segments)
+        {
+            nPivots = std::max(nPivots, static_cast<const PivotSegment &>(*segment).table.numPivots());
+        }
+        return {{"pivots", std::to_string(nPivots)}};
+    }
+
+    /**
+     * @brief Saves each distinct pivot set once, then every segment's table.
+     */
+    void saveSegments(BinaryWriter &writer, const std::string &prefix, const Snapshot &snap) const override
+    {
+        std::vector<const std::vector<T> *> pivotSets;
+        std::vector<int32_t> setOfSegment;
+        for (const auto &baseSegment : snap.segments)
+        {
+            const auto &segment = static_cast<const PivotSegment &>(*baseSegment);
+            int32_t set = -1;
+            if (segment.pivots)
+            {
+                auto it = std::find(pivotSets.begin(), pivotSets.end(), segment.pivots.get());
+                set = static_cast<int32_t>(it - pivotSets.begin());
+                if (it == pivotSets.end())
+                    pivotSets.push_back(segment.pivots.get());
+            }
+            setOfSegment.push_back(set);
+        }
+
+        for (size_t i = 0; i < pivotSets.size(); ++i)
+        {
+            std::vector<const T *> pivots;
+            for (const auto &pivot : *pivotSets[i])
+            {
+                pivots.push_back(&pivot);
+            }
+            writeFeatures(writer, prefix + ".pivots." + std::to_string(i), pivots);
+        }
+
+        writer.beginSection(prefix + ".tables");
+        writer.write(uint64_t(pivotSets.size()));
+        for (size_t i = 0; i < snap.segments.size(); ++i)
+        {
+            writer.write(setOfSegment[i]);
+            static_cast<const PivotSegment &>(*snap.segments[i]).table.write(writer);
+        }
+        writer.endSection();
+    }
+
+    void loadSegments(const BinaryReader &reader, const std::string &prefix, std::vector<std::shared_ptr<Segment>> &segments) override
+    {
+        SectionReader section = reader.section(prefix + ".tables");
+        // Each pivot set is a section of its own: bound the count by the directory, not this payload
+        uint64_t setCount = section.read<uint64_t>();
+        if (setCount > segments.size())
+            throw std::runtime_error("More pivot sets than segments in " + prefix + ".tables");
+        std::vector<std::shared_ptr<const std::vector<T>>> pivotSets(setCount);
+        for (size_t i = 0; i < pivotSets.size(); ++i)
+        {
+            // Pivots are detached copies: they never resolve to an Individual
+            pivotSets[i] = std::make_shared<std::vector<T>>(readFeatures<T>(reader, prefix + ".pivots." + std::to_string(i), nullptr));
+        }
+
+        for (auto &baseSegment : segments)
+        {
+            auto &segment = static_cast<PivotSegment &>(*baseSegment);
+            int32_t set = section.read<int32_t>();
+            segment.table.read(section);
+            if (set >= 0)
+            {
+                if (static_cast<size_t>(set) >= pivotSets.size())
+                    throw std::runtime_error("Invalid pivot set in " + prefix + ".tables");
+                segment.pivots = pivotSets[set];
+            }
+
+            // knn() indexes queryToPivot and the cells by these sizes. A table may cover only the
+            // leading objects of its segment: those appended to it after build() have no row
+            size_t rows = segment.table.numRows();
+            if (rows == 0)
+                continue;
+            if (rows > segment.objects.size())
+                throw std::runtime_error("Pivot table larger than its segment in " + prefix + ".tables");
+            if (!segment.pivots)
+                throw std::runtime_error("Pivot table without pivots in " + prefix + ".tables");
+            if (segment.table.numPivots() != segment.pivots->size())
+                throw std::runtime_error("Pivot table does not match its pivot set in " + prefix + ".tables");
+        }
+    }
+
+    std::shared_ptr<Segment> newSegment() const override
+    {
+        return std::make_shared<PivotSegment>();
+    }
+
+    std::shared_ptr<Segment> cloneSegment(const Segment &segment) const override
+    {
+        return std::make_shared<PivotSegment>(static_cast<const PivotSegment &>(segment));
+    }
+
+    /**
+     * @brief Drops the objects and pivot table rows removed by compact().
+     */
+    std::shared_ptr<Segment> filterSegment(const Segment &segment, const std::vector<bool> &keep) const override
+    {
+        auto filtered = std::static_pointer_cast<PivotSegment>(Base::filterSegment(segment, keep));
+        const auto &pivotSegment = static_cast<const PivotSegment &>(segment);
+        filtered->pivots = pivotSegment.pivots;
+        filtered->table = pivotSegment.table;
+        filtered->table.compact(keep);
+        return filtered;
+    }
+
+private:
+    static constexpr size_t blockSize = 256; ///< Rows bounded per lowerBounds() call
+};
+
+#endif // PIVOT_SEARCHER_HPP
@@ -0,0 +1,56 @@
+#ifndef SEARCH_BUDGET_HPP
+#define SEARCH_BUDGET_HPP
+
+#include <vector>
+#include <chrono>
+#include <limits>
+#include "NNList.hpp"
+#include "NNResults.hpp"
+
+/**
+ * @brief Limits of an anytime search: a wall-clock time, a number of distance computations, or both.
+ *
+ * The budget is checked once per block of objects, so a search can overrun it by one block.
+ */
+struct SearchBudget
+{
+    std::chrono::nanoseconds maxTime = std::chrono::nanoseconds::max();          ///< Time limit
+    unsigned long maxDistances = std::numeric_limits<unsigned long>::max(); ///< Distance computation limit
+
+    /**
+     * @brief Returns a budget limited by time only.
+     */
+    static SearchBudget time(std::chrono::nanoseconds limit)
+    {
+        SearchBudget budget;
+        budget.maxTime = limit;
+        return budget;
+    }
+
+    /**
+     * @brief Returns a budget limited by distance computations only.
+     */
+    static SearchBudget distances(unsigned long limit)
+    {
+        SearchBudget budget;
+        budget.maxDistances = limit;
+        return budget;
+    }
+};
+
+/**
+ * @brief Best-so-far result of an anytime search.
+ *
+ * @tparam T The type of the data objects.
+ */
+template <typename T>
+struct AnytimeResult
+{
+    std::vector<NNList<T>> lists; ///< Neighbors of each query among the scanned objects
+    NNResult<T> votes;            ///< Votes aggregated over lists
+    bool exact = false;           ///< True if every object was scanned before the budget expired
+    size_t scanned = 0;           ///< Number of objects scanned
+    unsigned long distances = 0;  ///< Number of distance computations
+};
+
+#endif // SEARCH_BUDGET_HPP
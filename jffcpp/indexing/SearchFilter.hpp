@@ -0,0 +1,63 @@
+#ifndef SEARCH_FILTER_HPP
+#define SEARCH_FILTER_HPP
+
+#include "../data/Bitmap.hpp"
+#include "../data/ParentedFeature.hpp"
+
+/**
+ * @brief Restricts a search to some of the Individuals of the gallery.
+ *
+ * Searchers test the filter once per run of consecutive objects of the same Individual, so
+ * disallowed Individuals are skipped without scanning their objects. Index structures apply it
+ * while they are traversed, never as a post-filter on the results. An empty filter allows
+ * everything; when both sets are given, an Individual must be in both. Plain features, without
+ * an Individual, have ID 0 and belong to partition 0, which is reserved for "no partition" (real
+ * partitions are numbered from 1, see loadIndividuals).
+ *
+ * The bitmaps are not copied and must outlive the searches using the filter.
+ */
+struct SearchFilter
+{
+    const Bitmap *partitions = nullptr;  ///< Allowed partition indices (nullptr allows all)
+    const Bitmap *individuals = nullptr; ///< Allowed Individual IDs (nullptr allows all)
+
+    /**
+     * @brief Returns a filter allowing only the given partitions (see Gallery::partitionMask).
+     */
+    static SearchFilter inPartitions(const Bitmap &mask)
+    {
+        SearchFilter filter;
+        filter.partitions = &mask;
+        return filter;
+    }
+
+    /**
+     * @brief Returns a filter allowing only the given Individual IDs (e.g. a candidate list).
+     */
+    static SearchFilter amongIndividuals(const Bitmap &individualIds)
+    {
+        SearchFilter filter;
+        filter.individuals = &individualIds;
+        return filter;
+    }
+
+    /**
+     * @brief Returns true if the filter restricts anything.
+     */
+    bool active() const
+    {
+        return partitions != nullptr || individuals != nullptr;
+    }
+
+    /**
+     * @brief Returns true if the objects of the Individual may be returned.
+     */
+    bool allows(const Individual<ParentedFeature> *individual) const
+    {
+        if (partitions != nullptr && !partitions->test(individual != nullptr ? individual->partition : 0))
+            return false;
+        return individuals == nullptr || individuals->test(individual != nullptr ? individual->getId() : 0);
+    }
+};
+
+#endif // SEARCH_FILTER_HPP
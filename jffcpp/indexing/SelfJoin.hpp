@@ -0,0 +1,477 @@
+#ifndef SELF_JOIN_HPP
+#define SELF_JOIN_HPP
+
+#include <vector>
+#include <string>
+#include <thread>     // For std::thread
+#include <mutex>      // For std::mutex, std::lock_guard
+#include <atomic>     // For std::atomic
+#include <exception>  // For std::exception_ptr, std::rethrow_exception
+#include <chrono>     // For std::chrono::steady_clock
+#include <limits>     // For std::numeric_limits
+#include <algorithm>  // For std::sort, std::min
+#include <numeric>    // For std::inner_product
+#include <filesystem> // For std::filesystem::rename, std::filesystem::exists
+#include <stdexcept>  // For std::invalid_argument, std::runtime_error
+#include "../data/ParentedFeature.hpp"
+#include "../data/BinaryFile.hpp"
+#include "../math/LinAlg.hpp"
+
+/**
+ * @brief Pair of Individuals that may be the same person enrolled twice.
+ */
+struct DuplicateCandidate
+{
+    uint32_t first;  ///< Smaller Individual ID
+    uint32_t second; ///< Larger Individual ID
+    double score;    ///< Number of mutual nearest-neighbor minutiae within maxDistance
+};
+
+/**
+ * @brief Compares every Individual of a gallery with every other to find duplicate enrollments.
+ *
+ * The descriptors are packed Individual by Individual into one matrix, and the Individuals are
+ * grouped in tiles of tileSize. Only the tile pairs (I, J) with I <= J are computed, each pair of
+ * Individuals once: the squared Euclidean distances between two tiles come from one blocked
+ * product |a|^2 + |b|^2 - 2 a.b (LinAlg::matMulPreTransposed, the rows of tile J transposed
+ * once per tile pair into a per-thread buffer), with no allocation per distance.
+ * Two Individuals score the number of minutia pairs that are each other's nearest neighbor in
+ * the other print and closer than maxDistance, and each Individual keeps its k best partners.
+ *
+ * Tile pairs are handed to the threads dynamically. With a checkpoint path, the finished tiles
+ * and the partial top-k lists are saved every checkpointInterval seconds (written to a temporary
+ * file, then renamed), and run() resumes from the file when it matches the same gallery.
+ *
+ * @tparam T A parented feature type (each object must know its Individual).
+ */
+template <typename T>
+class SelfJoin
+{
+public:
+    /**
+     * @brief Constructs a self-join.
+     *
+     * @param k Number of best partners kept per Individual.
+     * @param maxDistance Largest descriptor distance of a counted minutia pair.
+     * @param tileSize Number of Individuals per tile.
+     */
+    SelfJoin(size_t k = 10, float maxDistance = std::numeric_limits<float>::infinity(), size_t tileSize = 32)
+        : k(k), maxDistance(maxDistance), tileSize(tileSize), stopRequested(false)
+    {
+        if (k == 0 || tileSize == 0)
+            throw std::invalid_argument("k and tileSize must be positive");
+    }
+
+    /**
+     * @brief Enables checkpoints.
+     *
+     * @param path File holding the progress.
+     * @param interval Seconds between checkpoints.
+     */
+    void setCheckpoint(const std::string &path, double interval = 60.0)
+    {
+        checkpointPath = path;
+        checkpointInterval = interval;
+    }
+
+    /**
+     * @brief Compares all Individuals owning the given features.
+     *
+     * Retired Individuals and features without an Individual are ignored. If a checkpoint of the
+     * same gallery and parameters exists, only the missing tiles are computed.
+     *
+     * @param features The gallery features.
+     * @param nThreads The number of threads (0 means hardware concurrency).
+     * @return std::vector<DuplicateCandidate> The pairs in any top-k list, best first. Empty if
+     * stopped by requestStop() before the end.
+     * @throws The first error of any thread (e.g. a failed checkpoint), once all threads have stopped.
+     */
+    std::vector<DuplicateCandidate> run(const std::vector<T> &features, unsigned nThreads = 0)
+    {
+        pack(features);
+        size_t nTiles = (individualIds.size() + tileSize - 1) / tileSize;
+        tilePairs.clear();
+        for (size_t i = 0; i < nTiles; ++i)
+        {
+            for (size_t j = i; j < nTiles; ++j)
+            {
+                tilePairs.emplace_back(static_cast<uint32_t>(i), static_cast<uint32_t>(j));
+            }
+        }
+        done.assign(tilePairs.size(), 0);
+        best.assign(individualIds.size(), {});
+        if (!checkpointPath.empty() && std::filesystem::exists(checkpointPath))
+            resume();
+
+        size_t alreadyDone = 0;
+        for (uint8_t flag : done)
+        {
+            alreadyDone += flag;
+        }
+        doneCount = alreadyDone;
+
+        stopRequested = false;
+        std::atomic<size_t> next(0);
+        lastCheckpoint = std::chrono::steady_clock::now();
+        std::exception_ptr failure;
+        auto worker = [&]()
+        {
+            // An exception leaving a std::thread would terminate the process: keep the first one
+            // for run() to rethrow, and stop the other threads
+            try
+            {
+                std::vector<float> gram, transposed;
+                std::vector<Partner> found;
+                for (size_t t = next++; t < tilePairs.size() && !stopRequested; t = next++)
+                {
+                    if (done[t])
+                        continue;
+                    found.clear();
+                    joinTiles(tilePairs[t].first, tilePairs[t].second, gram, transposed, found);
+                    finishTile(t, found);
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mergeMutex);
+                if (!failure)
+                    failure = std::current_exception();
+                stopRequested = true;
+            }
+        };
+
+        if (nThreads == 0)
+            nThreads = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < nThreads; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        if (failure)
+            std::rethrow_exception(failure);
+
+        if (!checkpointPath.empty())
+            saveCheckpoint();
+        if (doneCount < tilePairs.size())
+            return {};
+        return ranking();
+    }
+
+    /**
+     * @brief Asks a running run() to stop after its current tiles and save a checkpoint.
+     */
+    void requestStop()
+    {
+        stopRequested = true;
+    }
+
+    /**
+     * @brief Returns the best partners (ID, score) of an Individual after run(), best first.
+     */
+    std::vector<std::pair<uint32_t, double>> partners(uint32_t individualId) const
+    {
+        std::vector<std::pair<uint32_t, double>> result;
+        auto it = std::lower_bound(individualIds.begin(), individualIds.end(), individualId);
+        if (it == individualIds.end() || *it != individualId)
+            return result;
+        for (const Partner &partner : best[it - individualIds.begin()])
+        {
+            result.emplace_back(individualIds[partner.other], partner.score);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns the fraction of tile pairs computed.
+     */
+    double progress() const
+    {
+        return tilePairs.empty() ? 1.0 : static_cast<double>(doneCount) / static_cast<double>(tilePairs.size());
+    }
+
+private:
+    /**
+     * @brief One entry of a top-k list: the other Individual's index and the pair score.
+     */
+    struct Partner
+    {
+        uint32_t self;  ///< Index of the Individual owning the list
+        uint32_t other; ///< Index of the partner
+        double score;   ///< Pair score
+    };
+
+    /**
+     * @brief Packs the live descriptors Individual by Individual, in increasing ID order.
+     */
+    void pack(const std::vector<T> &features)
+    {
+        std::vector<std::pair<uint32_t, size_t>> order;
+        for (size_t i = 0; i < features.size(); ++i)
+        {
+            if (representativeOf(features[i]) != nullptr && !isRetired(features[i]))
+                order.emplace_back(representativeId(features[i]), i);
+        }
+        std::sort(order.begin(), order.end());
+
+        dimension = order.empty() ? 0 : features[order[0].second].size();
+        individualIds.clear();
+        rowStart.assign(1, 0);
+        values.resize(order.size() * dimension);
+        norms.resize(order.size());
+        for (size_t r = 0; r < order.size(); ++r)
+        {
+            const T &f = features[order[r].second];
+            if (f.size() != dimension)
+                throw std::invalid_argument("Features of the gallery have different dimensions");
+            if (individualIds.empty() || individualIds.back() != order[r].first)
+            {
+                if (!individualIds.empty())
+                    rowStart.push_back(r);
+                individualIds.push_back(order[r].first);
+            }
+            std::copy(f.values.begin(), f.values.end(), values.begin() + r * dimension);
+            norms[r] = std::inner_product(f.values.begin(), f.values.end(), f.values.begin(), 0.0f);
+        }
+        if (!individualIds.empty())
+            rowStart.push_back(order.size());
+    }
+
+    /**
+     * @brief Scores every pair of Individuals between two tiles (each pair once).
+     */
+    void joinTiles(size_t tileA, size_t tileB, std::vector<float> &gram, std::vector<float> &transposed, std::vector<Partner> &found) const
+    {
+        size_t a0 = tileA * tileSize, a1 = std::min(individualIds.size(), a0 + tileSize);
+        size_t b0 = tileB * tileSize, b1 = std::min(individualIds.size(), b0 + tileSize);
+        size_t rowA = rowStart[a0], rowsA = rowStart[a1] - rowA;
+        size_t rowB = rowStart[b0], rowsB = rowStart[b1] - rowB;
+
+        gram.resize(rowsA * rowsB);
+        transposed.resize(rowsB * dimension);
+        LinAlg::transpose(&values[rowB * dimension], rowsB, dimension, transposed.data());
+        LinAlg::matMulPreTransposed(&values[rowA * dimension], rowsA, transposed.data(), rowsB, dimension, gram.data());
+
+        const float limit = maxDistance * maxDistance;
+        std::vector<float> rowMin, colMin;
+        std::vector<uint32_t> rowArg, colArg;
+        for (size_t a = a0; a < a1; ++a)
+        {
+            for (size_t b = (tileA == tileB ? a + 1 : b0); b < b1; ++b)
+            {
+                size_t ra = rowStart[a], na = rowStart[a + 1] - ra;
+                size_t rb = rowStart[b], nb = rowStart[b + 1] - rb;
+                rowMin.assign(na, std::numeric_limits<float>::infinity());
+                colMin.assign(nb, std::numeric_limits<float>::infinity());
+                rowArg.assign(na, 0);
+                colArg.assign(nb, 0);
+
+                // Nearest neighbor of every minutia in the other print, both directions in one pass
+                for (size_t i = 0; i < na; ++i)
+                {
+                    const float *g = &gram[(ra - rowA + i) * rowsB + (rb - rowB)];
+                    float normA = norms[ra + i];
+                    for (size_t j = 0; j < nb; ++j)
+                    {
+                        float d = normA + norms[rb + j] - 2.0f * g[j];
+                        if (d < rowMin[i])
+                        {
+                            rowMin[i] = d;
+                            rowArg[i] = static_cast<uint32_t>(j);
+                        }
+                        if (d < colMin[j])
+                        {
+                            colMin[j] = d;
+                            colArg[j] = static_cast<uint32_t>(i);
+                        }
+                    }
+                }
+
+                size_t mutual = 0;
+                for (size_t i = 0; i < na; ++i)
+                {
+                    if (colArg[rowArg[i]] == i && rowMin[i] <= limit)
+                        ++mutual;
+                }
+                if (mutual > 0)
+                    found.push_back({static_cast<uint32_t>(a), static_cast<uint32_t>(b), static_cast<double>(mutual)});
+            }
+        }
+    }
+
+    /**
+     * @brief Merges the scores of a finished tile into the top-k lists and checkpoints if due.
+     */
+    void finishTile(size_t t, const std::vector<Partner> &found)
+    {
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        for (const Partner &pair : found)
+        {
+            offer(pair.self, pair.other, pair.score);
+            offer(pair.other, pair.self, pair.score);
+        }
+        done[t] = 1;
+        ++doneCount;
+
+        auto now = std::chrono::steady_clock::now();
+        if (!checkpointPath.empty() && std::chrono::duration<double>(now - lastCheckpoint).count() >= checkpointInterval)
+        {
+            saveCheckpoint();
+            lastCheckpoint = now;
+        }
+    }
+
+    /**
+     * @brief Inserts a partner into a top-k list (higher score first, then smaller index).
+     */
+    void offer(uint32_t self, uint32_t other, double score)
+    {
+        auto &list = best[self];
+        auto better = [](const Partner &x, const Partner &y)
+        {
+            return x.score != y.score ? x.score > y.score : x.other < y.other;
+        };
+        Partner partner{self, other, score};
+        if (list.size() == k && !better(partner, list.back()))
+            return;
+        list.insert(std::upper_bound(list.begin(), list.end(), partner, better), partner);
+        if (list.size() > k)
+            list.pop_back();
+    }
+
+    /**
+     * @brief Ranks the distinct pairs found in the top-k lists.
+     */
+    std::vector<DuplicateCandidate> ranking() const
+    {
+        std::vector<DuplicateCandidate> pairs;
+        for (const auto &list : best)
+        {
+            for (const Partner &partner : list)
+            {
+                uint32_t first = individualIds[std::min(partner.self, partner.other)];
+                uint32_t second = individualIds[std::max(partner.self, partner.other)];
+                pairs.push_back({first, second, partner.score});
+            }
+        }
+        std::sort(pairs.begin(), pairs.end(), [](const DuplicateCandidate &x, const DuplicateCandidate &y)
+                  { return x.first != y.first ? x.first < y.first : x.second < y.second; });
+        pairs.erase(std::unique(pairs.begin(), pairs.end(), [](const DuplicateCandidate &x, const DuplicateCandidate &y)
+                                { return x.first == y.first && x.second == y.second; }),
+                    pairs.end());
+        std::stable_sort(pairs.begin(), pairs.end(), [](const DuplicateCandidate &x, const DuplicateCandidate &y)
+                         { return x.score > y.score; });
+        return pairs;
+    }
+
+    /**
+     * @brief Saves the finished tiles and the top-k lists (caller holds mergeMutex or is alone).
+     */
+    void saveCheckpoint() const
+    {
+        std::string temporary = checkpointPath + ".tmp";
+        {
+            BinaryWriter writer(temporary);
+            writer.beginSection("selfjoin");
+            writer.write(uint64_t(k));
+            writer.write(uint64_t(tileSize));
+            writer.write(maxDistance);
+            writer.write(uint64_t(rowStart.empty() ? 0 : rowStart.back()));
+            writer.write(uint64_t(individualIds.size()));
+            writer.writeArray(individualIds.data(), individualIds.size());
+            writer.writeArray(done.data(), done.size());
+            for (const auto &list : best)
+            {
+                writer.write(uint32_t(list.size()));
+                for (const Partner &partner : list)
+                {
+                    writer.write(partner.other);
+                    writer.write(partner.score);
+                }
+            }
+            writer.endSection();
+            writer.close();
+        }
+        std::filesystem::rename(temporary, checkpointPath);
+    }
+
+    /**
+     * @brief Restores the progress of a checkpoint of the same gallery and parameters; other
+     * checkpoints, and damaged ones, are ignored and overwritten.
+     */
+    void resume()
+    {
+        std::vector<uint8_t> savedDone(done.size());
+        std::vector<std::vector<Partner>> savedBest(best.size());
+        try
+        {
+            BinaryReader reader(checkpointPath);
+            SectionReader section = reader.section("selfjoin");
+            if (section.read<uint64_t>() != k || section.read<uint64_t>() != tileSize || section.read<float>() != maxDistance)
+                return;
+            if (section.read<uint64_t>() != (rowStart.empty() ? 0 : rowStart.back()))
+                return;
+            std::vector<uint32_t> savedIds(section.readCount<uint64_t>(sizeof(uint32_t)));
+            section.readArray(savedIds.data(), savedIds.size());
+            if (savedIds != individualIds)
+                return;
+
+            section.readArray(savedDone.data(), savedDone.size());
+            for (uint8_t flag : savedDone)
+            {
+                if (flag > 1)
+                    return;
+            }
+            for (size_t self = 0; self < savedBest.size(); ++self)
+            {
+                size_t size = section.readCount<uint32_t>(sizeof(uint32_t) + sizeof(double));
+                if (size > k)
+                    return;
+                savedBest[self].resize(size);
+                for (Partner &partner : savedBest[self])
+                {
+                    partner.self = static_cast<uint32_t>(self);
+                    partner.other = section.read<uint32_t>();
+                    partner.score = section.read<double>();
+                    if (partner.other >= individualIds.size() || partner.other == self)
+                        return;
+                }
+            }
+        }
+        catch (const std::runtime_error &)
+        {
+            return; // Truncated or corrupt: start over
+        }
+
+        done.swap(savedDone);
+        best.swap(savedBest);
+    }
+
+    size_t k;          ///< Partners kept per Individual
+    float maxDistance; ///< Largest distance of a counted minutia pair
+    size_t tileSize;   ///< Individuals per tile
+
+    std::string checkpointPath;       ///< Progress file (empty = no checkpoints)
+    double checkpointInterval = 60.0; ///< Seconds between checkpoints
+
+    size_t dimension = 0;                ///< Descriptor dimension
+    std::vector<uint32_t> individualIds; ///< Individual ID per index, increasing
+    std::vector<size_t> rowStart;        ///< First row of each Individual, plus the total
+    std::vector<float> values;           ///< Packed descriptors, row-major
+    std::vector<float> norms;            ///< Squared norm of each row
+
+    std::vector<std::pair<uint32_t, uint32_t>> tilePairs; ///< Tile pairs (I <= J)
+    std::vector<uint8_t> done;                            ///< 1 if the tile pair is computed
+    std::vector<std::vector<Partner>> best;               ///< Top-k partners per Individual
+    std::atomic<size_t> doneCount{0};                     ///< Number of computed tile pairs
+
+    std::mutex mergeMutex;                                ///< Guards best, done and checkpoints
+    std::atomic<bool> stopRequested;                      ///< Set by requestStop()
+    std::chrono::steady_clock::time_point lastCheckpoint; ///< Time of the last checkpoint
+};
+
+#endif // SELF_JOIN_HPP
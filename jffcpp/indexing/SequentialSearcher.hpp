@@ -2,18 +2,40 @@
 #define SEQUENTIAL_SEARCHER_HPP
 
 #include <vector>
-#include <functional> // For std::function
-#include <typeinfo>   // For typeid
+#include <functional>    // For std::function
+#include <typeinfo>      // For typeid
+#include <memory>        // For std::shared_ptr, std::unique_ptr
+#include <atomic>        // For std::atomic
+#include <mutex>         // For std::mutex, std::lock_guard, std::call_once
+#include <unordered_map> // For std::unordered_map
+#include <chrono>        // For std::chrono::steady_clock
+#include <algorithm>     // For std::stable_sort, std::sort, std::unique
+#include <stdexcept>     // For std::invalid_argument
 #include "NNList.hpp"
+#include "SearchBudget.hpp"
+#include "SearchFilter.hpp"
+#include "GalleryIndex.hpp"
+#include "../data/ParentedFeature.hpp" // For isRetired
+#include "../concurrency/EpochManager.hpp"
+#include "../data/Persistence.hpp"
 
 /**
  * @brief A class for performing sequential k-nearest neighbors search.
  *
+ * The data objects live in immutable segments. Every update builds a new Snapshot (the list of
+ * segments) and publishes it with an atomic pointer swap, so a running knn() always sees one
+ * consistent version and never takes a lock. Replaced snapshots are reclaimed through the global
+ * EpochManager once every search that could still read them has finished.
+ *
+ * Objects of retired Individuals are skipped until compact() removes them. Each segment records its
+ * runs of consecutive objects of the same Individual, so retired Individuals and those excluded
+ * by a SearchFilter are skipped a whole run at a time.
+ *
  * @tparam T The type of the objects stored in dataObjects.
  * @tparam DistanceFunc The type of the distance function.
  */
 template <typename T, typename DistanceFunc>
-class SequentialSearcher
+class SequentialSearcher : public GalleryIndex<T>
 {
 public:
     /**
@@ -21,7 +43,18 @@ public:
      *
      * @param distFunc The distance function to evaluate distance between objects.
      */
-    SequentialSearcher(DistanceFunc &distFunc) : distanceFunc(distFunc) {}
+    SequentialSearcher(DistanceFunc &distFunc) : distanceFunc(distFunc), current(new Snapshot()) {}
+
+    /**
+     * @brief Destructor. No search may be running.
+     */
+    virtual ~SequentialSearcher()
+    {
+        delete current.load();
+    }
+
+    SequentialSearcher(const SequentialSearcher &) = delete;
+    SequentialSearcher &operator=(const SequentialSearcher &) = delete;
 
     /**
      * @brief Performs k-nearest neighbors search.
@@ -30,22 +63,219 @@ public:
      * @param k The number of nearest neighbors to find.
      * @return NNList<T> The list of k-nearest neighbors.
      */
-    virtual NNList<T> knn(T &query, size_t k) const
+    NNList<T> knn(T &query, size_t k) const
+    {
+        return knn(query, k, SearchFilter());
+    }
+
+    /**
+     * @brief Performs k-nearest neighbors search among the Individuals allowed by a filter.
+     *
+     * @param query The query object.
+     * @param k The number of nearest neighbors to find.
+     * @param filter Restricts the searched Individuals (e.g. to some partitions).
+     * @return NNList<T> The list of k-nearest neighbors.
+     */
+    virtual NNList<T> knn(T &query, size_t k, const SearchFilter &filter) const
     {
+        EpochGuard guard(EpochManager::global());
         NNList<T> nnList(k);
 
         // Sequentially calculate the distance between the query object and all objects in dataObjects
         // Takes O(n) distance calculations
-        for (const auto &obj : dataObjects)
+        for (const auto &segment : snapshot()->segments)
         {
-            double dist = distanceFunc(query, obj);
+            const auto &objects = segment->objects;
+            forEachRun(*segment, filter, [&](size_t begin, size_t end, const Individual<ParentedFeature> *)
+                       {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    double dist = objectDistance(query, objects[i]);
 
-            nnList.insert(obj, dist);
+                    nnList.insert(objects[i], dist);
+                } });
         }
 
         return nnList;
     }
 
+    /**
+     * @brief Searches the k-nearest neighbors of several queries in a single pass over the objects.
+     *
+     * Objects are scanned in blocks of batchBlockSize and every query is compared with a block
+     * while it is in cache, so the gallery is streamed once per batch instead of once per query.
+     * Each list is the same as knn() would return.
+     *
+     * @param queries The query objects (e.g. the minutiae of several latents).
+     * @param ks The number of nearest neighbors of each query.
+     * @param filter Restricts the searched Individuals.
+     * @return std::vector<NNList<T>> The neighbors of each query.
+     */
+    virtual std::vector<NNList<T>> knnBatch(std::vector<T> &queries, const std::vector<size_t> &ks, const SearchFilter &filter = SearchFilter()) const
+    {
+        if (ks.size() != queries.size())
+            throw std::invalid_argument("knnBatch needs one k per query");
+
+        EpochGuard guard(EpochManager::global());
+        std::vector<NNList<T>> lists;
+        lists.reserve(queries.size());
+        for (size_t k : ks)
+        {
+            lists.emplace_back(k);
+        }
+
+        for (const auto &segment : snapshot()->segments)
+        {
+            const auto &objects = segment->objects;
+            forEachRun(*segment, filter, [&](size_t begin, size_t end, const Individual<ParentedFeature> *)
+                       { scanBatch(queries, lists, objects, begin, end); });
+        }
+
+        return lists;
+    }
+
+    /**
+     * @brief Searches the k-nearest neighbors of several queries with the same k in a single pass.
+     */
+    std::vector<NNList<T>> knnBatch(std::vector<T> &queries, size_t k, const SearchFilter &filter = SearchFilter()) const
+    {
+        return knnBatch(queries, std::vector<size_t>(queries.size(), k), filter);
+    }
+
+    class BatchScan;
+
+    /**
+     * @brief Searches the k-nearest neighbors of several queries (e.g. the minutiae of a latent)
+     * within a budget, and returns the best result found so far when it expires.
+     *
+     * Objects are scanned Individual by Individual (consecutive objects with the same
+     * representative), starting with the Individuals whose mean is closest to the mean of the
+     * queries, so the likely mates are seen first. Ordering costs one distance per Individual,
+     * not charged to the budget. The budget is checked after every block of anytimeBlockSize
+     * objects.
+     *
+     * @param queries The query objects.
+     * @param k The number of nearest neighbors per query.
+     * @param budget The time and distance computation limits.
+     * @param filter Restricts the searched Individuals.
+     * @return AnytimeResult<T> The neighbor lists, their votes and whether they are exact.
+     */
+    AnytimeResult<T> anytimeKnn(std::vector<T> &queries, size_t k, const SearchBudget &budget, const SearchFilter &filter = SearchFilter()) const
+    {
+        auto start = std::chrono::steady_clock::now();
+        EpochGuard guard(EpochManager::global());
+        const Snapshot *snap = snapshot();
+
+        AnytimeResult<T> result;
+        result.lists.assign(queries.size(), NNList<T>(k));
+
+        std::vector<Run> runs = individualRuns(*snap, filter);
+
+        if (!queries.empty() && runs.size() > 1)
+        {
+            std::vector<float> sums(queries[0].size(), 0.0f);
+            for (const auto &query : queries)
+            {
+                for (size_t i = 0; i < sums.size(); ++i)
+                {
+                    sums[i] += query[i] / static_cast<float>(queries.size());
+                }
+            }
+            // Default constructed, so this temporary takes no feature ID
+            T centroid;
+            centroid.values = std::move(sums);
+            for (auto &run : runs)
+            {
+                if (run.representative != nullptr && run.representative->mean.size() == centroid.size())
+                    run.priority = distanceFunc(centroid, run.representative->mean);
+            }
+            std::stable_sort(runs.begin(), runs.end(), [](const Run &a, const Run &b)
+                             { return a.priority < b.priority; });
+        }
+
+        auto deadline = budget.maxTime == std::chrono::nanoseconds::max() ? std::chrono::steady_clock::time_point::max() : start + budget.maxTime;
+        result.exact = true;
+        for (size_t r = 0; r < runs.size() && result.exact; ++r)
+        {
+            const Run &run = runs[r];
+            for (size_t begin = run.begin; begin < run.end; begin += anytimeBlockSize)
+            {
+                if (result.distances >= budget.maxDistances || std::chrono::steady_clock::now() >= deadline)
+                {
+                    result.exact = false;
+                    break;
+                }
+
+                size_t end = std::min(begin + anytimeBlockSize, run.end);
+                for (size_t q = 0; q < queries.size(); ++q)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        const T &obj = (*run.objects)[i];
+                        result.lists[q].insert(obj, objectDistance(queries[q], obj));
+                    }
+                }
+                result.scanned += end - begin;
+                result.distances += (end - begin) * queries.size();
+            }
+        }
+
+        for (const auto &list : result.lists)
+        {
+            result.votes.add(list);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Searches the k-nearest neighbors of several queries among the objects of some
+     * Individuals only, scanning just their runs of consecutive objects.
+     *
+     * The runs are found through the run index of the snapshot (built on its first use), so the
+     * cost grows with the objects of the given Individuals, not with the gallery. The lists are
+     * the same as knn() with the equivalent filter would return.
+     *
+     * @param queries The query objects.
+     * @param k The number of nearest neighbors per query.
+     * @param individualIds IDs of the Individuals to search.
+     * @param filter Further restricts the searched Individuals (its Individual set is intersected with individualIds).
+     * @return std::vector<NNList<T>> The neighbors of each query.
+     */
+    std::vector<NNList<T>> knnAmong(std::vector<T> &queries, size_t k, const std::vector<uint32_t> &individualIds, const SearchFilter &filter = SearchFilter()) const
+    {
+        EpochGuard guard(EpochManager::global());
+        const Snapshot *snap = snapshot();
+        const auto &runsById = snap->runsById();
+
+        std::vector<uint32_t> ids(individualIds);
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+        std::vector<IndexedRun> runs;
+        for (uint32_t id : ids)
+        {
+            auto it = runsById.find(id);
+            if (it == runsById.end())
+                continue;
+            for (const IndexedRun &run : it->second)
+            {
+                const T &first = snap->segments[run.segment]->objects[run.begin];
+                if (!isRetired(first) && filter.allows(representativeOf(first)))
+                    runs.push_back(run);
+            }
+        }
+        // Storage order, so that ties are broken as in knn()
+        std::sort(runs.begin(), runs.end(), [](const IndexedRun &x, const IndexedRun &y)
+                  { return x.segment != y.segment ? x.segment < y.segment : x.begin < y.begin; });
+
+        std::vector<NNList<T>> lists(queries.size(), NNList<T>(k));
+        for (const IndexedRun &run : runs)
+        {
+            scanBatch(queries, lists, snap->segments[run.segment]->objects, run.begin, run.end);
+        }
+        return lists;
+    }
+
     /**
      * @brief Adds a single object to the dataObjects.
      *
@@ -53,17 +283,115 @@ public:
      */
     void add(const T &obj)
     {
-        dataObjects.push_back(obj);
+        addAll(std::vector<T>{obj});
     }
 
     /**
      * @brief Adds all objects from a vector to the dataObjects.
      *
+     * Small trailing segments are copied and extended, larger ones are left untouched and the
+     * objects go to a new segment.
+     *
      * @param objs The vector of objects to add.
      */
     void addAll(const std::vector<T> &objs)
     {
-        dataObjects.insert(dataObjects.end(), objs.begin(), objs.end());
+        if (objs.empty())
+            return;
+
+        std::lock_guard<std::mutex> writeLock(updateMutex);
+        const Snapshot *old = current.load();
+        auto next = std::make_unique<Snapshot>(*old);
+
+        std::shared_ptr<Segment> segment;
+        if (!next->segments.empty() && next->segments.back()->objects.size() < smallSegmentSize)
+        {
+            segment = cloneSegment(*next->segments.back());
+            next->segments.pop_back();
+        }
+        else
+        {
+            segment = newSegment();
+        }
+        segment->objects.insert(segment->objects.end(), objs.begin(), objs.end());
+        segment->seal();
+        next->segments.push_back(std::move(segment));
+        next->size += objs.size();
+
+        publish(std::move(next));
+    }
+
+    /**
+     * @brief Replaces all data objects in one update. Searches keep running on the previous
+     * snapshot meanwhile.
+     *
+     * @param objs The new objects.
+     */
+    void replaceAll(const std::vector<T> &objs)
+    {
+        auto next = std::make_unique<Snapshot>();
+        if (!objs.empty())
+        {
+            auto segment = newSegment();
+            segment->objects = objs;
+            segment->seal();
+            next->segments.push_back(std::move(segment));
+        }
+        next->size = objs.size();
+
+        std::lock_guard<std::mutex> writeLock(updateMutex);
+        publish(std::move(next));
+    }
+
+    /**
+     * @brief Adds the objects enrolled in an attached Gallery.
+     *
+     * @param objs The enrolled objects.
+     */
+    void onEnroll(const std::vector<T> &objs) override
+    {
+        addAll(objs);
+    }
+
+    /**
+     * @brief Removes the objects of retired Individuals.
+     *
+     * Only the segments holding retired objects are rewritten; searches keep running on the
+     * previous snapshot meanwhile.
+     *
+     * @return size_t The number of objects removed.
+     */
+    size_t compact() override
+    {
+        std::lock_guard<std::mutex> writeLock(updateMutex);
+        const Snapshot *old = current.load();
+        auto next = std::make_unique<Snapshot>(*old);
+
+        size_t removed = 0;
+        for (auto &segment : next->segments)
+        {
+            std::vector<bool> keep(segment->objects.size());
+            size_t kept = 0;
+            for (size_t i = 0; i < keep.size(); ++i)
+            {
+                keep[i] = !isRetired(segment->objects[i]);
+                kept += keep[i];
+            }
+            if (kept == keep.size())
+                continue;
+
+            removed += keep.size() - kept;
+            auto filtered = filterSegment(*segment, keep);
+            filtered->seal();
+            segment = std::move(filtered);
+        }
+
+        if (removed == 0)
+            return 0;
+
+        next->size -= removed;
+        publish(std::move(next));
+        return removed;
     }
 
     /**
@@ -73,7 +401,120 @@ public:
      */
     size_t size() const
     {
-        return dataObjects.size();
+        EpochGuard guard(EpochManager::global());
+        return snapshot()->size;
+    }
+
+    /**
+     * @brief Returns the version of the published snapshot, incremented on every update.
+     */
+    uint64_t getVersion() const
+    {
+        EpochGuard guard(EpochManager::global());
+        return snapshot()->version;
+    }
+
+    /**
+     * @brief Returns the name of the searcher type, stored in persisted files.
+     */
+    virtual std::string kind() const
+    {
+        return "SequentialSearcher";
+    }
+
+    /**
+     * @brief Saves the published snapshot: header, objects and any per-segment data.
+     *
+     * Objects of retired Individuals are saved too; compact() first to leave them out.
+     *
+     * @param writer The writer.
+     * @param prefix Prefix of the section names.
+     */
+    void save(BinaryWriter &writer, const std::string &prefix = "searcher") const
+    {
+        EpochGuard guard(EpochManager::global());
+        const Snapshot *snap = snapshot();
+
+        IndexHeader header;
+        header.kind = kind();
+        header.metric = DistanceFunc::name;
+        header.params = buildParams(*snap);
+
+        std::vector<const T *> objects;
+        objects.reserve(snap->size);
+        for (const auto &segment : snap->segments)
+        {
+            header.segmentSizes.push_back(segment->objects.size());
+            for (const auto &obj : segment->objects)
+            {
+                objects.push_back(&obj);
+            }
+        }
+        header.dimension = objects.empty() ? 0 : static_cast<uint32_t>(objects[0]->size());
+
+        header.write(writer, prefix + ".header");
+        writeFeatures(writer, prefix + ".objects", objects);
+        saveSegments(writer, prefix, *snap);
+    }
+
+    /**
+     * @brief Saves the searcher to its own file.
+     */
+    void save(const std::string &filename) const
+    {
+        BinaryWriter writer(filename);
+        save(writer);
+        writer.close();
+    }
+
+    /**
+     * @brief Replaces the data objects with the ones saved by save(), without rebuilding anything.
+     *
+     * @param reader The reader.
+     * @param resolve Maps saved Individual IDs to loaded Individuals (see Gallery::resolver).
+     * @param prefix Prefix of the section names.
+     * @throws std::runtime_error if the file holds another searcher type or distance, or its
+     * segments do not cover exactly the saved objects.
+     */
+    void load(const BinaryReader &reader, const IndividualResolver &resolve, const std::string &prefix = "searcher")
+    {
+        IndexHeader header = IndexHeader::read(reader, prefix + ".header", kind(), DistanceFunc::name);
+        std::vector<T> objects = readFeatures<T>(reader, prefix + ".objects", resolve);
+
+        auto next = std::make_unique<Snapshot>();
+        std::vector<std::shared_ptr<Segment>> segments;
+        size_t offset = 0;
+        for (uint64_t segmentSize : header.segmentSizes)
+        {
+            if (segmentSize > objects.size() - offset)
+                throw std::runtime_error("Segment sizes do not match the saved objects");
+            auto segment = newSegment();
+            segment->objects.assign(std::make_move_iterator(objects.begin() + offset), std::make_move_iterator(objects.begin() + offset + segmentSize));
+            offset += segmentSize;
+            segment->seal();
+            segments.push_back(segment);
+        }
+        if (offset != objects.size())
+            throw std::runtime_error("Segment sizes do not match the saved objects");
+        loadSegments(reader, prefix, segments);
+
+        for (auto &segment : segments)
+        {
+            next->segments.push_back(std::move(segment));
+        }
+        next->size = offset;
+
+        std::lock_guard<std::mutex> writeLock(updateMutex);
+        publish(std::move(next));
+    }
+
+    /**
+     * @brief Loads the searcher from its own file.
+     */
+    void load(const std::string &filename, const IndividualResolver &resolve)
+    {
+        BinaryReader reader(filename);
+        load(reader, resolve);
     }
 
     /**
@@ -83,22 +524,414 @@ public:
      * @param searcher The SequentialSearcher to print.
      * @return The output stream.
      */
-    template <typename U, typename V>
-    friend std::ostream &operator<<(std::ostream &os, const SequentialSearcher<U, V> &searcher)
+    friend std::ostream &operator<<(std::ostream &os, const SequentialSearcher &searcher)
     {
         // os << "SequentialSearcher with objects of type: " << typeid(T).name() << "\n";
         // os << "Using distance function: " << typeid(DistanceFunc).name() << "\n";
         // os << "Data objects:\n";
-        for (const auto &obj : searcher.dataObjects)
+        EpochGuard guard(EpochManager::global());
+        for (const auto &segment : searcher.snapshot()->segments)
         {
-            os << obj << "\n";
+            for (const auto &obj : segment->objects)
+            {
+                os << obj << "\n";
+            }
         }
         return os;
     }
 
 protected:
-    std::vector<T> dataObjects; ///< The data objects to be searched.
+    /**
+     * @brief Immutable block of data objects. Derived searchers extend it with per-object data.
+     */
+    struct Segment
+    {
+        virtual ~Segment() = default;
+        std::vector<T> objects;      ///< Data objects of the segment
+        std::vector<size_t> runEnds; ///< End of each run of consecutive objects of one Individual
+
+        /**
+         * @brief Records the runs of the objects. Called once the objects are final, before publishing.
+         */
+        void seal()
+        {
+            runEnds = findRunEnds(objects);
+        }
+    };
+
+    /**
+     * @brief Returns the end of each run of consecutive objects with the same representative.
+     */
+    static std::vector<size_t> findRunEnds(const std::vector<T> &objects)
+    {
+        std::vector<size_t> ends;
+        for (size_t end = 1; end <= objects.size(); ++end)
+        {
+            if (end == objects.size() || representativeOf(objects[end]) != representativeOf(objects[end - 1]))
+                ends.push_back(end);
+        }
+        return ends;
+    }
+
+    /**
+     * @brief Returns the run ends of a segment, computed into unsealed if it was not sealed.
+     */
+    static const std::vector<size_t> &runEndsOf(const Segment &segment, std::vector<size_t> &unsealed)
+    {
+        const auto &ends = segment.runEnds;
+        if (ends.empty() ? segment.objects.empty() : ends.back() == segment.objects.size())
+            return ends;
+        unsealed = findRunEnds(segment.objects);
+        return unsealed;
+    }
+
+    /**
+     * @brief Calls fn(begin, end, representative) for every run of a segment whose Individual is
+     * live and allowed by the filter.
+     */
+    template <typename Fn>
+    static void forEachRun(const Segment &segment, const SearchFilter &filter, Fn &&fn)
+    {
+        const auto &objects = segment.objects;
+        std::vector<size_t> unsealed;
+        size_t begin = 0;
+        for (size_t end : runEndsOf(segment, unsealed))
+        {
+            const auto *representative = representativeOf(objects[begin]);
+            if (!isRetired(objects[begin]) && filter.allows(representative))
+                fn(begin, end, representative);
+            begin = end;
+        }
+    }
+
+    /**
+     * @brief Run of one Individual, located by the index of its segment in a snapshot.
+     */
+    struct IndexedRun
+    {
+        size_t segment;    ///< Index of the segment in Snapshot::segments
+        size_t begin, end; ///< Range of the run
+    };
+
+    /**
+     * @brief One published version of the data objects.
+     */
+    struct Snapshot
+    {
+        std::vector<std::shared_ptr<const Segment>> segments; ///< Segments in insertion order
+        size_t size = 0;                                      ///< Total number of objects
+        uint64_t version = 0;                                 ///< Incremented on every publish
+
+        Snapshot() = default;
+
+        /**
+         * @brief Copies the segments of another snapshot. The copy builds its own run index.
+         */
+        Snapshot(const Snapshot &other) : segments(other.segments), size(other.size), version(other.version) {}
+
+        /**
+         * @brief Returns the runs of each Individual ID (0 for objects without one), retired
+         * Individuals included. Built once, by the first caller; the snapshot is immutable after.
+         */
+        const std::unordered_map<uint32_t, std::vector<IndexedRun>> &runsById() const
+        {
+            std::call_once(runsByIdBuilt, [this]()
+                           {
+                for (size_t s = 0; s < segments.size(); ++s)
+                {
+                    const auto &objects = segments[s]->objects;
+                    std::vector<size_t> unsealed;
+                    size_t begin = 0;
+                    for (size_t end : runEndsOf(*segments[s], unsealed))
+                    {
+                        const auto *representative = representativeOf(objects[begin]);
+                        runIndex[representative != nullptr ? representative->getId() : 0].push_back({s, begin, end});
+                        begin = end;
+                    }
+                } });
+            return runIndex;
+        }
+
+    private:
+        mutable std::once_flag runsByIdBuilt;                                      ///< Guards the lazy build
+        mutable std::unordered_map<uint32_t, std::vector<IndexedRun>> runIndex; ///< Runs by Individual ID
+    };
+
+    /**
+     * @brief Consecutive objects of one segment sharing the same representative Individual.
+     */
+    struct Run
+    {
+        const std::vector<T> *objects;                     ///< Objects of the segment
+        size_t begin, end;                                 ///< Range of the run
+        const Individual<ParentedFeature> *representative; ///< Owner of the run (nullptr for plain features)
+        double priority;                                   ///< Scan priority (lower first)
+    };
+
+    /**
+     * @brief Lists the runs of a snapshot, skipping retired Individuals and those the filter excludes.
+     *
+     * Enrollment adds all objects of an Individual at once, so each Individual is usually a single run.
+     */
+    static std::vector<Run> individualRuns(const Snapshot &snap, const SearchFilter &filter = SearchFilter())
+    {
+        std::vector<Run> runs;
+        for (const auto &segment : snap.segments)
+        {
+            const std::vector<T> *objects = &segment->objects;
+            forEachRun(*segment, filter, [&](size_t begin, size_t end, const Individual<ParentedFeature> *representative)
+                       { runs.push_back({objects, begin, end, representative, 0.0}); });
+        }
+        return runs;
+    }
+
+    /**
+     * @brief Returns the published snapshot. Must be called while an EpochGuard is alive.
+     */
+    const Snapshot *snapshot() const
+    {
+        return current.load();
+    }
+
+    /**
+     * @brief Publishes a new snapshot and retires the previous one. Requires updateMutex.
+     *
+     * @param next The new snapshot.
+     */
+    void publish(std::unique_ptr<Snapshot> next)
+    {
+        next->version = current.load()->version + 1;
+        const Snapshot *old = current.exchange(next.release());
+        EpochManager::global().retire([old]()
+                                      { delete old; });
+    }
+
+    /**
+     * @brief Creates an empty segment of the type used by this searcher.
+     */
+    virtual std::shared_ptr<Segment> newSegment() const
+    {
+        return std::make_shared<Segment>();
+    }
+
+    /**
+     * @brief Copies a segment so that objects can be appended to the copy.
+     */
+    virtual std::shared_ptr<Segment> cloneSegment(const Segment &segment) const
+    {
+        auto copy = newSegment();
+        copy->objects = segment.objects;
+        return copy;
+    }
+
+    /**
+     * @brief Copies a segment keeping only the objects whose keep flag is true.
+     */
+    virtual std::shared_ptr<Segment> filterSegment(const Segment &segment, const std::vector<bool> &keep) const
+    {
+        auto filtered = newSegment();
+        for (size_t i = 0; i < segment.objects.size(); ++i)
+        {
+            if (keep[i])
+                filtered->objects.push_back(segment.objects[i]);
+        }
+        return filtered;
+    }
+
+    /**
+     * @brief Adds the objects [begin, end) to the lists of a batch, one block of objects at a time.
+     */
+    void scanBatch(std::vector<T> &queries, std::vector<NNList<T>> &lists, const std::vector<T> &objects, size_t begin, size_t end) const
+    {
+        for (size_t blockBegin = begin; blockBegin < end; blockBegin += batchBlockSize)
+        {
+            size_t blockEnd = std::min(blockBegin + batchBlockSize, end);
+            for (size_t q = 0; q < queries.size(); ++q)
+            {
+                for (size_t i = blockBegin; i < blockEnd; ++i)
+                {
+                    lists[q].insert(objects[i], objectDistance(queries[q], objects[i]));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Distance between a query and a stored object, as computed by knn().
+     */
+    virtual double objectDistance(T &query, const T &obj) const
+    {
+        return distanceFunc(query, obj);
+    }
+
+    /**
+     * @brief Returns the build parameters stored in the header of persisted files.
+     */
+    virtual std::map<std::string, std::string> buildParams(const Snapshot &snap) const
+    {
+        (void)snap;
+        return {};
+    }
+
+    /**
+     * @brief Saves per-segment data of derived searchers.
+     */
+    virtual void saveSegments(BinaryWriter &writer, const std::string &prefix, const Snapshot &snap) const
+    {
+        (void)writer;
+        (void)prefix;
+        (void)snap;
+    }
+
+    /**
+     * @brief Restores per-segment data of derived searchers into freshly loaded segments.
+     */
+    virtual void loadSegments(const BinaryReader &reader, const std::string &prefix, std::vector<std::shared_ptr<Segment>> &segments)
+    {
+        (void)reader;
+        (void)prefix;
+        (void)segments;
+    }
+
+    static constexpr size_t smallSegmentSize = 4096; ///< Segments below this size are extended by copy
+    static constexpr size_t anytimeBlockSize = 256;  ///< Objects scanned between two budget checks
+    static constexpr size_t batchBlockSize = 256;    ///< Objects compared with every query of a batch at a time
+
     DistanceFunc &distanceFunc; ///< The distance function to evaluate distance between objects.
+    std::mutex updateMutex;     ///< Serializes writers.
+
+private:
+    std::atomic<const Snapshot *> current; ///< Published snapshot, read without locks
+};
+
+/**
+ * @brief A knnBatch() split into chunks that may run at different times and on different threads,
+ * so that urgent searches can run between the chunks of a long one.
+ *
+ * The scan covers the snapshot published when it is constructed: every chunk sees the same objects
+ * and the final lists equal those of knnBatch() on that snapshot, whatever is enrolled, retired or
+ * compacted meanwhile. It pins the epoch only while constructing; afterwards it keeps that version
+ * alive by sharing ownership of its segments and of the Individuals of the scanned runs, so a long
+ * scan does not hold back the reclamation of anything else. The searcher must outlive the scan.
+ */
+template <typename T, typename DistanceFunc>
+class SequentialSearcher<T, DistanceFunc>::BatchScan
+{
+public:
+    /**
+     * @brief Prepares the scan of the current snapshot.
+     *
+     * @param searcher The searcher to scan.
+     * @param queries The query objects.
+     * @param ks The number of nearest neighbors of each query.
+     * @param filter Restricts the searched Individuals.
+     */
+    BatchScan(const SequentialSearcher &searcher, std::vector<T> queries, const std::vector<size_t> &ks, const SearchFilter &filter = SearchFilter())
+        : searcher(&searcher), queries(std::move(queries))
+    {
+        if (ks.size() != this->queries.size())
+            throw std::invalid_argument("BatchScan needs one k per query");
+
+        {
+            EpochGuard guard(EpochManager::global());
+            const Snapshot *snap = searcher.snapshot();
+            segments = snap->segments;
+            runs = individualRuns(*snap, filter);
+            for (const auto &r : runs)
+            {
+                // An Individual split across two segments gives two consecutive runs
+                if (r.representative && (owners.empty() || owners.back().get() != r.representative))
+                    owners.push_back(r.representative->weak_from_this().lock());
+            }
+        }
+
+        lists.reserve(ks.size());
+        for (size_t k : ks)
+        {
+            lists.emplace_back(k);
+        }
+        for (const auto &r : runs)
+        {
+            total += r.end - r.begin;
+        }
+    }
+
+    /**
+     * @brief Scans up to maxObjects more objects (at least one).
+     *
+     * @return bool True once every object was scanned.
+     */
+    bool advance(size_t maxObjects)
+    {
+        size_t budget = std::max<size_t>(maxObjects, 1);
+        while (run < runs.size() && budget > 0)
+        {
+            const Run &r = runs[run];
+            size_t begin = r.begin + offset;
+            size_t end = std::min(r.end, begin + budget);
+            searcher->scanBatch(queries, lists, *r.objects, begin, end);
+
+            budget -= end - begin;
+            scanned += end - begin;
+            offset += end - begin;
+            if (end == r.end)
+            {
+                ++run;
+                offset = 0;
+            }
+        }
+        return done();
+    }
+
+    /**
+     * @brief Returns true once every object was scanned.
+     */
+    bool done() const
+    {
+        return run == runs.size();
+    }
+
+    /**
+     * @brief Returns the number of objects scanned so far.
+     */
+    size_t scannedObjects() const
+    {
+        return scanned;
+    }
+
+    /**
+     * @brief Returns the number of objects the scan covers.
+     */
+    size_t totalObjects() const
+    {
+        return total;
+    }
+
+    /**
+     * @brief Returns the neighbors of each query found so far (final once done()).
+     *
+     * The neighbors stay valid while the scan lives.
+     */
+    std::vector<NNList<T>> &results()
+    {
+        return lists;
+    }
+
+private:
+    using Run = typename SequentialSearcher<T, DistanceFunc>::Run;
+    using Snapshot = typename SequentialSearcher<T, DistanceFunc>::Snapshot;
+    using Segment = typename SequentialSearcher<T, DistanceFunc>::Segment;
+
+    const SequentialSearcher *searcher;                                     ///< Scanned searcher
+    std::vector<std::shared_ptr<const Segment>> segments;                   ///< Segments of the scanned snapshot, kept alive
+    std::vector<std::shared_ptr<const Individual<ParentedFeature>>> owners; ///< Individuals of the scanned runs, kept alive
+    std::vector<Run> runs;                                                  ///< Runs of the scanned snapshot allowed by the filter
+    std::vector<T> queries;                                                 ///< Query objects
+    std::vector<NNList<T>> lists;                                           ///< Neighbors of each query
+    size_t run = 0;                                                         ///< Next run to scan
+    size_t offset = 0;                                                      ///< Objects of the next run already scanned
+    size_t scanned = 0;                                                     ///< Objects scanned
+    size_t total = 0;                                                       ///< Objects to scan
 };
 
-#endif // SEQUENTIAL_SEARCHER_HPP
\ No newline at end of file
+#endif // SEQUENTIAL_SEARCHER_HPP
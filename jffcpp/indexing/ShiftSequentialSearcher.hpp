@@ -31,21 +31,32 @@ public:
      */
     static F shift(F &feature, Individual<F> *representative)
     {
+        F shifted_feature; // Default constructed: the ID is copied, no new one is taken
+        shiftInto(feature, representative, shifted_feature);
+        return shifted_feature;
+    }
 
-        F mean = representative->mean;
-        F std = representative->stddev;
-        F shifted_feature(feature.size());
+    /**
+     * @brief Writes the shifted and scaled feature into out, reusing the storage of its values.
+     *
+     * @param feature The feature to shift.
+     * @param representative The representative individual.
+     * @param out Receives the shifted values, the ID of feature and the representative.
+     */
+    static void shiftInto(const F &feature, Individual<F> *representative, F &out)
+    {
+        const F &mean = representative->mean;
+        const F &std = representative->stddev;
+        out.values.resize(feature.size());
 
         // f = f * std + mean
         for (size_t i = 0; i < feature.size(); ++i)
         {
-            shifted_feature[i] = feature[i] * std[i] + mean[i];
+            out.values[i] = feature.values[i] * std.values[i] + mean.values[i];
         }
 
-        shifted_feature.id = feature.id;
-        shifted_feature.representative = representative;
-
-        return shifted_feature;
+        out.id = feature.id;
+        out.representative = representative;
     }
 
     /**
@@ -62,27 +73,36 @@ public:
     }
 
     /**
-     * @brief Performs k-nearest neighbors search.
-     *
-     * @param query The query object.
-     * @param k The number of nearest neighbors to find.
-     * @return NNList<F> The list of k-nearest neighbors.
+     * @brief Returns the name of the searcher type. Its saved objects are already shifted.
      */
-    NNList<F> knn(F &query, size_t k) const override
+    std::string kind() const override
     {
-        NNList<F> nnList(k);
-
-        // Sequentially calculate the distance between the query object and all objects in dataObjects
-        // Takes O(n) distance calculations
-        for (const auto &obj : this->dataObjects)
-        {
-            F shiftQuery = shift(query, obj.representative);
-            double dist = this->distanceFunc(shiftQuery, obj);
+        return "ShiftSequentialSearcher";
+    }
 
-            nnList.insert(obj, dist);
-        }
+    /**
+     * @brief Adds the objects enrolled in an attached Gallery, shifted like shiftAll does.
+     *
+     * @param objs The enrolled objects.
+     */
+    void onEnroll(const std::vector<F> &objs) override
+    {
+        std::vector<F> shifted(objs);
+        shiftAll(shifted);
+        this->addAll(shifted);
+    }
 
-        return nnList;
+protected:
+    /**
+     * @brief Distance between the query, shifted like the object's Individual, and the object.
+     * The sequential scan of the base class uses it for every object.
+     */
+    double objectDistance(F &query, const F &obj) const override
+    {
+        // One scratch query per thread, so the scan neither allocates nor takes feature IDs
+        thread_local F shiftQuery;
+        shiftInto(query, obj.representative, shiftQuery);
+        return this->distanceFunc(shiftQuery, obj);
     }
 };
 
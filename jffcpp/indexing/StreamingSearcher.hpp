@@ -0,0 +1,483 @@
+#ifndef STREAMING_SEARCHER_HPP
+#define STREAMING_SEARCHER_HPP
+
+#include <vector>
+#include <string>
+#include <thread>             // For std::thread
+#include <mutex>              // For std::mutex, std::unique_lock
+#include <condition_variable> // For std::condition_variable
+#include <exception>          // For std::exception_ptr
+#include <chrono>             // For std::chrono::steady_clock
+#include <algorithm>          // For std::min, std::max
+#include <cstring>            // For std::memcpy
+#include <cerrno>             // For errno, EINTR
+#include <stdexcept>          // For std::runtime_error
+#include <fstream>            // For std::ifstream
+#include "NNList.hpp"
+#include "SearchFilter.hpp"
+#include "../data/BinaryFile.hpp"
+#include "../data/Persistence.hpp"
+#include "../concurrency/Parallel.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>  // For open
+#include <unistd.h> // For pread, close
+#endif
+
+/**
+ * @brief Settings of a StreamingSearcher.
+ */
+struct StreamingOptions
+{
+    size_t chunkBytes = 16 << 20; ///< Bytes read per chunk (rounded to whole features)
+    unsigned buffers = 3;         ///< Chunks in memory at once: 2 double-buffers, 3 triple-buffers
+    unsigned ioThreads = 2;       ///< Threads reading chunks ahead of the search
+    unsigned searchThreads = 1;   ///< Threads searching a chunk, the queries split between them (0 means hardware concurrency)
+    size_t residentFeatures = 0;  ///< Leading features read once and kept in memory, only the rest is streamed
+};
+
+/**
+ * @brief Counters of the last search of a StreamingSearcher.
+ */
+struct StreamingStats
+{
+    size_t chunks = 0;          ///< Chunks searched
+    uint64_t bytesRead = 0;     ///< Bytes read from the file
+    double readMs = 0;          ///< Time spent reading, summed over the I/O threads
+    double searchMs = 0;        ///< Time spent computing distances
+    double stallMs = 0;         ///< Time the search waited for a chunk to land
+    double wallMs = 0;          ///< Duration of the search
+    size_t peakBufferBytes = 0; ///< Memory held by the chunk buffers (the resident features excluded)
+};
+
+/**
+ * @brief Exact k-nearest neighbor search over features streamed from a file, for galleries
+ * larger than memory.
+ *
+ * The features section of a file written by Gallery::save (or a searcher's objects section) is
+ * read in chunks of about chunkBytes into a fixed ring of buffers. I/O threads read the next
+ * chunks with positioned reads while the calling thread searches the chunk that landed, so disk
+ * and CPU work overlap; a search stalls only when the disk is slower than the distances. Every
+ * query minutia keeps its running top-k across chunks, and chunks are searched in file order, so
+ * the lists are the ones SequentialSearcher::knnBatch returns over the same features, ties
+ * included. Memory is bounded by the buffers (see StreamingStats::peakBufferBytes), not by the
+ * gallery: nothing is kept between searches, except the first residentFeatures features, which
+ * are read once at construction and searched from memory before the streamed rest (see
+ * MemoryBudget, which sizes this prefix to the RAM left over by the buffers).
+ *
+ * Features keep their IDs, and their representative is resolved through a resolver, typically of
+ * a Gallery loaded without features (Gallery::load with withFeatures = false). Features of
+ * retired Individuals are skipped.
+ *
+ * @tparam T The type of the features (ParentedFeature).
+ * @tparam DistanceFunc The distance function.
+ */
+template <typename T, typename DistanceFunc>
+class StreamingSearcher
+{
+public:
+    /**
+     * @brief Opens a features section, reading only its header.
+     *
+     * @param filename The file holding the section.
+     * @param distanceFunc The distance function.
+     * @param resolve Maps saved Individual IDs to Individuals (see Gallery::resolver).
+     * @param section Name of the features section ("gallery.features" or "searcher.objects").
+     * @param options Buffer sizes and thread counts.
+     * @throws std::runtime_error if the file or the section cannot be read.
+     */
+    StreamingSearcher(const std::string &filename, DistanceFunc &distanceFunc, IndividualResolver resolve,
+                      const std::string &section = "gallery.features", StreamingOptions options = StreamingOptions())
+        : filename(filename), distanceFunc(distanceFunc), resolve(std::move(resolve)), options(options)
+    {
+        if (this->options.buffers == 0 || this->options.ioThreads == 0)
+            throw std::invalid_argument("A StreamingSearcher needs at least one buffer and one I/O thread");
+
+        auto sections = BinaryFile::locateSections(filename);
+        auto it = sections.find(section);
+        if (it == sections.end())
+            throw std::runtime_error("Missing section: " + section);
+
+        char header[12];
+        if (it->second.size < sizeof(header))
+            throw std::runtime_error("Section " + section + " is truncated in " + filename);
+        File file(filename);
+        file.read(it->second.offset, header, sizeof(header));
+        std::memcpy(&count, header, sizeof(count));
+        std::memcpy(&dim, header + sizeof(count), sizeof(dim));
+        sectionOffset = it->second.offset + sizeof(header);
+
+        // Divide rather than multiply: a corrupt count must not wrap around
+        size_t rowBytes = 2 * sizeof(uint32_t) + static_cast<size_t>(dim) * sizeof(float);
+        if (count > (it->second.size - sizeof(header)) / rowBytes)
+            throw std::runtime_error("Section " + section + " is truncated in " + filename);
+
+        chunkRows = std::max<size_t>(1, this->options.chunkBytes / rowBytes);
+        residentRows = static_cast<size_t>(std::min<uint64_t>(this->options.residentFeatures, count));
+        if (residentRows > 0)
+        {
+            loadRows(file, resident, 0, residentRows);
+            resident.bytes = std::vector<char>();
+        }
+    }
+
+    /**
+     * @brief Returns the number of features in the file.
+     */
+    size_t size() const
+    {
+        return static_cast<size_t>(count);
+    }
+
+    uint32_t dimension() const
+    {
+        return dim;
+    }
+
+    /**
+     * @brief Searches the k-nearest neighbors of several queries in one pass over the file.
+     *
+     * @param queries The query objects.
+     * @param ks The number of nearest neighbors of each query.
+     * @param filter Restricts the searched Individuals.
+     * @return std::vector<NNList<T>> The neighbor list of each query.
+     * @throws std::runtime_error if reading the file fails.
+     */
+    std::vector<NNList<T>> knnBatch(std::vector<T> &queries, const std::vector<size_t> &ks, const SearchFilter &filter = SearchFilter())
+    {
+        if (ks.size() != queries.size())
+            throw std::invalid_argument("One k per query is required");
+
+        auto start = std::chrono::steady_clock::now();
+        stats = StreamingStats();
+
+        std::vector<NNList<T>> lists;
+        lists.reserve(queries.size());
+        for (size_t k : ks)
+        {
+            lists.emplace_back(k);
+        }
+
+        // The resident prefix comes first in file order, so the lists match a single pass
+        if (residentRows > 0)
+        {
+            for (size_t i = 0; i < residentRows; ++i)
+            {
+                resident.live[i] = !isRetired(resident.objects[i]);
+            }
+            auto searchStart = std::chrono::steady_clock::now();
+            searchChunk(queries, lists, resident, filter);
+            stats.searchMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - searchStart).count();
+        }
+
+        size_t nChunks = static_cast<size_t>((count - residentRows + chunkRows - 1) / chunkRows);
+        size_t nBuffers = std::min<size_t>(options.buffers, std::max<size_t>(nChunks, 1));
+        Pipeline pipeline(nBuffers);
+        File file(filename);
+
+        std::vector<std::thread> readers;
+        for (unsigned t = 0; t < std::min<size_t>(options.ioThreads, nBuffers); ++t)
+        {
+            readers.emplace_back([&]
+                                 { readLoop(pipeline, file, nChunks); });
+        }
+
+        for (size_t c = 0; c < nChunks; ++c)
+        {
+            Buffer &buffer = pipeline.buffers[c % nBuffers];
+            {
+                auto waitStart = std::chrono::steady_clock::now();
+                std::unique_lock<std::mutex> lock(pipeline.mutex);
+                pipeline.changed.wait(lock, [&]
+                                      { return pipeline.failure || (buffer.state == Buffer::Ready && buffer.chunk == c); });
+                stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+                if (pipeline.failure)
+                    break;
+            }
+
+            auto searchStart = std::chrono::steady_clock::now();
+            searchChunk(queries, lists, buffer, filter);
+            stats.searchMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - searchStart).count();
+            ++stats.chunks;
+
+            {
+                std::lock_guard<std::mutex> lock(pipeline.mutex);
+                buffer.state = Buffer::Free;
+                pipeline.consumed = c + 1;
+            }
+            pipeline.changed.notify_all();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pipeline.mutex);
+            pipeline.stopping = true;
+        }
+        pipeline.changed.notify_all();
+        for (auto &reader : readers)
+        {
+            reader.join();
+        }
+        if (pipeline.failure)
+            std::rethrow_exception(pipeline.failure);
+
+        for (const auto &buffer : pipeline.buffers)
+        {
+            stats.peakBufferBytes += buffer.bytes.capacity() + buffer.objects.capacity() * (sizeof(T) + dim * sizeof(float));
+        }
+        stats.bytesRead = pipeline.bytesRead;
+        stats.readMs = pipeline.readMs;
+        stats.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return lists;
+    }
+
+    /**
+     * @brief Searches the k-nearest neighbors of several queries with the same k in one pass over the file.
+     */
+    std::vector<NNList<T>> knnBatch(std::vector<T> &queries, size_t k, const SearchFilter &filter = SearchFilter())
+    {
+        return knnBatch(queries, std::vector<size_t>(queries.size(), k), filter);
+    }
+
+    /**
+     * @brief Returns the counters of the last search.
+     */
+    const StreamingStats &lastStats() const
+    {
+        return stats;
+    }
+
+private:
+    /**
+     * @brief Read-only file with positioned reads, safe to share between threads.
+     */
+    class File
+    {
+    public:
+        explicit File(const std::string &filename) : filename(filename)
+        {
+#ifndef _WIN32
+            fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("Could not open file: " + filename);
+#endif
+        }
+
+        ~File()
+        {
+#ifndef _WIN32
+            ::close(fd);
+#endif
+        }
+
+        File(const File &) = delete;
+        File &operator=(const File &) = delete;
+
+        /**
+         * @brief Reads exactly size bytes at offset.
+         */
+        void read(uint64_t offset, char *out, size_t size) const
+        {
+#ifndef _WIN32
+            while (size > 0)
+            {
+                ssize_t got = ::pread(fd, out, size, static_cast<off_t>(offset));
+                if (got < 0 && errno == EINTR)
+                    continue;
+                if (got <= 0)
+                    throw std::runtime_error("Could not read " + filename);
+                out += got;
+                offset += static_cast<uint64_t>(got);
+                size -= static_cast<size_t>(got);
+            }
+#else
+            // One stream per read: positioned reads are not shared between threads
+            std::ifstream file(filename, std::ios::binary);
+            file.seekg(static_cast<std::streamoff>(offset));
+            if (!file.read(out, static_cast<std::streamsize>(size)))
+                throw std::runtime_error("Could not read " + filename);
+#endif
+        }
+
+    private:
+        std::string filename;
+#ifndef _WIN32
+        int fd; ///< File descriptor
+#endif
+    };
+
+    /**
+     * @brief One slot of the ring: the raw bytes of a chunk and the features decoded from them.
+     */
+    struct Buffer
+    {
+        enum State
+        {
+            Free,
+            Loading,
+            Ready
+        };
+
+        State state = Free;
+        size_t chunk = 0;        ///< Chunk held once Ready
+        std::vector<char> bytes; ///< IDs, representative IDs and descriptors as read
+        std::vector<T> objects;  ///< Decoded features, reused from chunk to chunk
+        std::vector<char> live;  ///< Objects whose Individual is not retired
+    };
+
+    /**
+     * @brief State shared by the search and the I/O threads during one knnBatch.
+     */
+    struct Pipeline
+    {
+        explicit Pipeline(size_t nBuffers) : buffers(nBuffers) {}
+
+        std::vector<Buffer> buffers;
+        std::mutex mutex;                  ///< Guards every member
+        std::condition_variable changed;   ///< Signaled when a buffer changes state
+        size_t nextChunk = 0;              ///< Next chunk to read
+        size_t consumed = 0;               ///< Chunks searched so far
+        bool stopping = false;             ///< The search is over
+        std::exception_ptr failure;        ///< First I/O error
+        uint64_t bytesRead = 0;            ///< Bytes read by all I/O threads
+        double readMs = 0;                 ///< Read time summed over the I/O threads
+    };
+
+    /**
+     * @brief Body of an I/O thread: reads chunks into their buffer as soon as the buffer is free.
+     *
+     * Chunk c goes to buffer c % buffers, which is free once chunk c - buffers was searched, so
+     * at most buffers chunks are in memory.
+     */
+    void readLoop(Pipeline &pipeline, const File &file, size_t nChunks)
+    {
+        size_t nBuffers = pipeline.buffers.size();
+        while (true)
+        {
+            size_t c;
+            {
+                std::unique_lock<std::mutex> lock(pipeline.mutex);
+                pipeline.changed.wait(lock, [&]
+                                      { return pipeline.stopping || pipeline.failure || pipeline.nextChunk >= nChunks ||
+                                               (pipeline.nextChunk < pipeline.consumed + nBuffers && pipeline.buffers[pipeline.nextChunk % nBuffers].state == Buffer::Free); });
+                if (pipeline.stopping || pipeline.failure || pipeline.nextChunk >= nChunks)
+                    return;
+                c = pipeline.nextChunk++;
+                pipeline.buffers[c % nBuffers].state = Buffer::Loading;
+            }
+
+            Buffer &buffer = pipeline.buffers[c % nBuffers];
+            auto readStart = std::chrono::steady_clock::now();
+            try
+            {
+                uint64_t read = loadChunk(file, buffer, c);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - readStart).count();
+                std::lock_guard<std::mutex> lock(pipeline.mutex);
+                buffer.chunk = c;
+                buffer.state = Buffer::Ready;
+                pipeline.bytesRead += read;
+                pipeline.readMs += ms;
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(pipeline.mutex);
+                if (!pipeline.failure)
+                    pipeline.failure = std::current_exception();
+            }
+            pipeline.changed.notify_all();
+        }
+    }
+
+    /**
+     * @brief Reads chunk c and decodes its features into the buffer; returns the bytes read.
+     */
+    uint64_t loadChunk(const File &file, Buffer &buffer, size_t c) const
+    {
+        size_t begin = residentRows + c * chunkRows;
+        return loadRows(file, buffer, begin, static_cast<size_t>(std::min<uint64_t>(chunkRows, count - begin)));
+    }
+
+    /**
+     * @brief Reads the features [begin, begin + rows) and decodes them into the buffer; returns the bytes read.
+     */
+    uint64_t loadRows(const File &file, Buffer &buffer, size_t begin, size_t rows) const
+    {
+        size_t idBytes = rows * sizeof(uint32_t);
+        size_t valueBytes = rows * dim * sizeof(float);
+
+        // Layout of writeFeatures: all IDs, all representative IDs, then the descriptor matrix
+        buffer.bytes.resize(2 * idBytes + valueBytes);
+        char *ids = buffer.bytes.data();
+        char *owners = ids + idBytes;
+        char *values = owners + idBytes;
+        file.read(sectionOffset + begin * sizeof(uint32_t), ids, idBytes);
+        file.read(sectionOffset + count * sizeof(uint32_t) + begin * sizeof(uint32_t), owners, idBytes);
+        file.read(sectionOffset + 2 * count * sizeof(uint32_t) + begin * dim * sizeof(float), values, valueBytes);
+
+        buffer.objects.resize(rows);
+        buffer.live.resize(rows);
+        uint32_t lastOwner = 0;
+        Individual<ParentedFeature> *representative = nullptr;
+        for (size_t i = 0; i < rows; ++i)
+        {
+            T &f = buffer.objects[i];
+            f.values.resize(dim);
+            std::memcpy(f.values.data(), values + i * dim * sizeof(float), dim * sizeof(float));
+            std::memcpy(&f.id, ids + i * sizeof(uint32_t), sizeof(uint32_t));
+
+            // Features of one Individual are consecutive: resolve once per run
+            uint32_t owner;
+            std::memcpy(&owner, owners + i * sizeof(uint32_t), sizeof(uint32_t));
+            if (owner != lastOwner)
+            {
+                representative = owner != 0 && resolve ? resolve(owner) : nullptr;
+                if (owner != 0 && representative == nullptr)
+                    throw std::runtime_error("Unknown individual " + std::to_string(owner) + " in " + filename);
+                lastOwner = owner;
+            }
+            setRepresentative(f, owner != 0 ? representative : nullptr);
+            buffer.live[i] = representative == nullptr || !representative->isRetired();
+        }
+        return buffer.bytes.size();
+    }
+
+    /**
+     * @brief Adds the features of a landed chunk to the running lists, in file order.
+     */
+    void searchChunk(std::vector<T> &queries, std::vector<NNList<T>> &lists, const Buffer &buffer, const SearchFilter &filter) const
+    {
+        const std::vector<T> &objects = buffer.objects;
+        std::vector<char> allowed(buffer.live);
+        if (filter.active())
+        {
+            for (size_t i = 0; i < objects.size(); ++i)
+            {
+                allowed[i] = allowed[i] && filter.allows(representativeOf(objects[i]));
+            }
+        }
+
+        parallelFor(queries.size(), options.searchThreads, [&](size_t begin, size_t end)
+                    {
+            for (size_t q = begin; q < end; ++q)
+            {
+                for (size_t i = 0; i < objects.size(); ++i)
+                {
+                    if (allowed[i])
+                        lists[q].insert(objects[i], distanceFunc(queries[q], objects[i]));
+                }
+            } });
+    }
+
+    std::string filename;        ///< File holding the features
+    DistanceFunc &distanceFunc;  ///< Distance function
+    IndividualResolver resolve;  ///< Resolves representative IDs
+    StreamingOptions options;    ///< Buffer sizes and thread counts
+    uint64_t count = 0;          ///< Number of features in the section
+    uint32_t dim = 0;            ///< Descriptor dimension
+    uint64_t sectionOffset = 0;  ///< File offset of the IDs, right after the section header
+    size_t chunkRows = 1;        ///< Features per chunk
+    size_t residentRows = 0;     ///< Leading features kept in memory
+    Buffer resident;             ///< The resident features, decoded once
+    StreamingStats stats;        ///< Counters of the last search
+};
+
+#endif // STREAMING_SEARCHER_HPP
@@ -0,0 +1,441 @@
+#ifndef TRIPLET_INDEX_HPP
+#define TRIPLET_INDEX_HPP
+
+#include <vector>
+#include <memory>    // For std::shared_ptr
+#include <cmath>     // For std::sqrt, std::atan2, std::floor
+#include <algorithm> // For std::sort, std::unique, std::partial_sort
+#include <array>
+#include <stdexcept> // For std::runtime_error
+#include "VoteAggregator.hpp"
+#include "../data/Minutiae.hpp"
+#include "../data/Individual.hpp"
+#include "../data/ParentedFeature.hpp"
+#include "../data/BinaryFile.hpp"
+#include "../concurrency/Parallel.hpp"
+
+/**
+ * @brief Geometric-hashing candidate generator over minutia triplets.
+ *
+ * Every minutia forms triangles with pairs of its nearest neighbors. A triangle is described by
+ * values that do not change under rotation and translation: its side lengths, longest first, and
+ * the direction of each minutia relative to the direction towards the triangle centroid. The
+ * quantized values are packed into one key, and the keys of all gallery prints are stored with
+ * their Individual in an open-addressing (linear probing) hash table. A latent votes for the
+ * Individuals sharing keys with its own triangles, independently of its descriptors.
+ *
+ * The table is two flat arrays, so a saved table is used in place from the memory-mapped file.
+ * Every vote probes random slots, so a large table benefits from huge pages (setHugePages).
+ * Directions are expected in the orientation of atan2(dy, dx) in image coordinates.
+ */
+class TripletIndex
+{
+public:
+    /**
+     * @brief Constructs an empty index.
+     *
+     * @param lengthBin Quantization step of the side lengths, in pixels.
+     * @param angleBins Number of bins of the relative directions (at most 32).
+     * @param neighbors Number of nearest neighbors each minutia forms triangles with.
+     * @param fullTurn Value of a full turn in theta units (2 pi for radians, 360 for degrees).
+     */
+    TripletIndex(float lengthBin = 10.0f, uint32_t angleBins = 12, uint32_t neighbors = 4, float fullTurn = 6.2831853f)
+        : lengthBin(lengthBin), angleBins(std::min<uint32_t>(angleBins, 32)), neighbors(neighbors), fullTurn(fullTurn) {}
+
+    /**
+     * @brief Places the table of the next build() or load(filename) on huge pages.
+     *
+     * @param mode The preferred page size; falls back to smaller pages when unavailable.
+     */
+    void setHugePages(HugePageMode mode)
+    {
+        hugePages = mode;
+    }
+
+    /**
+     * @brief Returns how much of the table is held in huge pages.
+     */
+    HugePageUsage hugePageUsage() const
+    {
+        if (mapping)
+            return mapping->hugePageUsage();
+        HugePageUsage keyPages = hugePageUsageOf(ownedKeys);
+        HugePageUsage valuePages = hugePageUsageOf(ownedValues);
+        keyPages.anonymousBytes += valuePages.anonymousBytes;
+        keyPages.explicitBytes += valuePages.explicitBytes;
+        return keyPages;
+    }
+
+    /**
+     * @brief Builds the table from the gallery geometry, in parallel.
+     *
+     * Keys are computed per Individual on all threads. The table is then split into contiguous
+     * regions and each thread inserts the keys whose home slot lies in its regions; the few probe
+     * sequences running past the end of a region are inserted afterwards on one thread.
+     *
+     * @param individuals The Individuals to index (retired ones are skipped).
+     * @param geometry Gallery minutiae, row = feature ID (see loadIndividuals); rows without
+     * geometry are skipped.
+     * @param nThreads The number of threads (0 means hardware concurrency).
+     */
+    void build(const std::vector<std::shared_ptr<Individual<ParentedFeature>>> &individuals, const Minutiae &geometry, unsigned nThreads = 0)
+    {
+        // 1. Keys of every Individual
+        std::vector<std::vector<uint64_t>> keysOf(individuals.size());
+        parallelFor(individuals.size(), nThreads, [&](size_t begin, size_t end)
+                    {
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (individuals[i]->isRetired())
+                    continue;
+
+                // Rows never written are NaN, which would break the sort and the key quantization
+                std::vector<size_t> rows;
+                for (uint32_t featureId : individuals[i]->features)
+                {
+                    if (geometry.has(featureId))
+                        rows.push_back(featureId);
+                }
+                keysOf[i] = tripletKeys(geometry, rows);
+            } });
+
+        size_t total = 0;
+        for (const auto &keys : keysOf)
+        {
+            total += keys.size();
+        }
+
+        // 2. Group the entries by the region of their home slot
+        capacity = 16;
+        while (capacity < 2 * total)
+        {
+            capacity *= 2;
+        }
+        size_t nRegions = std::min<size_t>(capacity / 16, 1024);
+        size_t regionSize = capacity / nRegions;
+
+        std::vector<size_t> regionStart(nRegions + 1, 0);
+        for (const auto &keys : keysOf)
+        {
+            for (uint64_t key : keys)
+            {
+                ++regionStart[home(key) / regionSize + 1];
+            }
+        }
+        for (size_t r = 0; r < nRegions; ++r)
+        {
+            regionStart[r + 1] += regionStart[r];
+        }
+        std::vector<std::pair<uint64_t, uint32_t>> entries(total);
+        std::vector<size_t> fill(regionStart.begin(), regionStart.end() - 1);
+        for (size_t i = 0; i < individuals.size(); ++i)
+        {
+            for (uint64_t key : keysOf[i])
+            {
+                entries[fill[home(key) / regionSize]++] = {key, individuals[i]->getId()};
+            }
+        }
+        keysOf.clear();
+
+        // 3. Insert each region on its own thread, deferring probes that leave the region
+        ownedKeys = HugeVector<uint64_t>(capacity, 0, HugePageAllocator<uint64_t>(hugePages));
+        ownedValues = HugeVector<uint32_t>(capacity, 0, HugePageAllocator<uint32_t>(hugePages));
+        std::vector<std::vector<std::pair<uint64_t, uint32_t>>> overflow(nRegions);
+        parallelFor(nRegions, nThreads, [&](size_t begin, size_t end)
+                    {
+            for (size_t r = begin; r < end; ++r)
+            {
+                size_t regionEnd = (r + 1) * regionSize;
+                for (size_t e = regionStart[r]; e < regionStart[r + 1]; ++e)
+                {
+                    size_t slot = home(entries[e].first);
+                    while (slot < regionEnd && ownedKeys[slot] != 0)
+                        ++slot;
+                    if (slot == regionEnd)
+                    {
+                        overflow[r].push_back(entries[e]);
+                        continue;
+                    }
+                    ownedKeys[slot] = entries[e].first;
+                    ownedValues[slot] = entries[e].second;
+                }
+            } });
+
+        for (const auto &deferred : overflow)
+        {
+            for (const auto &entry : deferred)
+            {
+                size_t slot = home(entry.first);
+                while (ownedKeys[slot] != 0)
+                    slot = (slot + 1) & (capacity - 1);
+                ownedKeys[slot] = entry.first;
+                ownedValues[slot] = entry.second;
+            }
+        }
+
+        count = total;
+        keys = ownedKeys.data();
+        values = ownedValues.data();
+        mapping.reset();
+    }
+
+    /**
+     * @brief Adds one vote per query triangle to every Individual having a triangle with the same key.
+     *
+     * @param query The latent minutiae.
+     * @param votes The aggregator receiving the votes.
+     */
+    void vote(const Minutiae &query, VoteAggregator<FrequencyVote> &votes) const
+    {
+        if (count == 0)
+            return;
+
+        std::vector<size_t> rows(query.size());
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            rows[i] = i;
+        }
+
+        std::vector<uint32_t> voted;
+        for (uint64_t key : tripletKeys(query, rows))
+        {
+            voted.clear();
+            // Bounded by the capacity in case a corrupt file has no empty slot left
+            size_t slot = home(key);
+            for (size_t probe = 0; probe < capacity && keys[slot] != 0; ++probe, slot = (slot + 1) & (capacity - 1))
+            {
+                if (keys[slot] == key && std::find(voted.begin(), voted.end(), values[slot]) == voted.end())
+                {
+                    voted.push_back(values[slot]);
+                    votes.add(values[slot], 0.0, 0);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the n most voted Individuals (ID, votes), best first.
+     *
+     * @param query The latent minutiae.
+     * @param n The number of candidates.
+     */
+    std::vector<std::pair<uint32_t, double>> candidates(const Minutiae &query, size_t n) const
+    {
+        VoteAggregator<FrequencyVote> votes;
+        vote(query, votes);
+        return votes.top(n);
+    }
+
+    /**
+     * @brief Returns the number of indexed triangles.
+     */
+    size_t size() const
+    {
+        return count;
+    }
+
+    /**
+     * @brief Returns the size of the table, in bytes.
+     */
+    size_t memoryUsage() const
+    {
+        return capacity * (sizeof(uint64_t) + sizeof(uint32_t));
+    }
+
+    /**
+     * @brief Saves the parameters and the table as one section.
+     *
+     * @param writer The writer.
+     * @param prefix Name of the section.
+     */
+    void save(BinaryWriter &writer, const std::string &prefix = "triplets") const
+    {
+        writer.beginSection(prefix);
+        writer.write(lengthBin);
+        writer.write(angleBins);
+        writer.write(neighbors);
+        writer.write(fullTurn);
+        writer.write(uint64_t(count));
+        writer.write(uint64_t(capacity));
+        writer.writeArray(keys, capacity);
+        writer.writeArray(values, capacity);
+        writer.endSection();
+    }
+
+    /**
+     * @brief Saves the index to its own file.
+     */
+    void save(const std::string &filename) const
+    {
+        BinaryWriter writer(filename);
+        save(writer);
+        writer.close();
+    }
+
+    /**
+     * @brief Uses a saved table in place, without copying it. The reader is kept alive by the index.
+     *
+     * @param reader The reader of the file.
+     * @param prefix Name of the section.
+     */
+    void load(std::shared_ptr<const BinaryReader> reader, const std::string &prefix = "triplets")
+    {
+        SectionReader section = reader->section(prefix);
+        float savedLengthBin = section.read<float>();
+        uint32_t savedAngleBins = section.read<uint32_t>();
+        uint32_t savedNeighbors = section.read<uint32_t>();
+        float savedFullTurn = section.read<float>();
+        uint64_t savedCount = section.read<uint64_t>();
+        uint64_t savedCapacity = section.read<uint64_t>();
+        // Keys pack angle bins in 5 bits, and the bins divide the full turn and the side lengths
+        if (savedAngleBins == 0 || savedAngleBins > 32 || !(savedFullTurn > 0.0f) || !(savedLengthBin > 0.0f))
+            throw std::runtime_error("Invalid triplet quantization in section " + prefix);
+        // Probes stop at an empty slot, so an empty or full table would loop forever
+        if (savedCapacity == 0 || (savedCapacity & (savedCapacity - 1)) != 0)
+            throw std::runtime_error("Invalid triplet table capacity in section " + prefix);
+        if (savedCount > savedCapacity / 2)
+            throw std::runtime_error("Triplet table of section " + prefix + " is too full");
+        // Checked by division, so the byte sizes of the views below cannot wrap
+        if (savedCapacity > section.remaining() / (sizeof(uint64_t) + sizeof(uint32_t)))
+            throw std::runtime_error("Triplet table of section " + prefix + " is truncated");
+
+        // The payload is aligned and the header is 32 bytes, so both arrays are naturally aligned
+        keys = reinterpret_cast<const uint64_t *>(section.view(savedCapacity * sizeof(uint64_t)));
+        values = reinterpret_cast<const uint32_t *>(section.view(savedCapacity * sizeof(uint32_t)));
+        lengthBin = savedLengthBin;
+        angleBins = savedAngleBins;
+        neighbors = savedNeighbors;
+        fullTurn = savedFullTurn;
+        count = savedCount;
+        capacity = savedCapacity;
+
+        ownedKeys.clear();
+        ownedKeys.shrink_to_fit();
+        ownedValues.clear();
+        ownedValues.shrink_to_fit();
+        mapping = std::move(reader);
+    }
+
+    /**
+     * @brief Maps an index saved to its own file, on the pages chosen by setHugePages. Checksums are
+     * skipped by default, as they would read the whole table.
+     */
+    void load(const std::string &filename, bool verify = false)
+    {
+        load(std::make_shared<const BinaryReader>(filename, verify, hugePages));
+    }
+
+private:
+    /**
+     * @brief Mixes a key into its home slot (splitmix64 finalizer).
+     */
+    size_t home(uint64_t key) const
+    {
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        return static_cast<size_t>(key & (capacity - 1));
+    }
+
+    /**
+     * @brief Returns the keys of the triangles formed by the given rows and their nearest neighbors.
+     */
+    std::vector<uint64_t> tripletKeys(const Minutiae &m, const std::vector<size_t> &rows) const
+    {
+        size_t n = rows.size();
+        std::vector<std::array<size_t, 3>> triangles;
+        std::vector<std::pair<float, size_t>> byDistance;
+        for (size_t i = 0; i < n; ++i)
+        {
+            byDistance.clear();
+            for (size_t j = 0; j < n; ++j)
+            {
+                if (j == i)
+                    continue;
+                float dx = m.x[rows[j]] - m.x[rows[i]], dy = m.y[rows[j]] - m.y[rows[i]];
+                byDistance.emplace_back(dx * dx + dy * dy, j);
+            }
+            size_t nearest = std::min<size_t>(neighbors, byDistance.size());
+            std::partial_sort(byDistance.begin(), byDistance.begin() + nearest, byDistance.end());
+
+            for (size_t a = 0; a < nearest; ++a)
+            {
+                for (size_t b = a + 1; b < nearest; ++b)
+                {
+                    std::array<size_t, 3> triangle = {i, byDistance[a].second, byDistance[b].second};
+                    std::sort(triangle.begin(), triangle.end());
+                    triangles.push_back(triangle);
+                }
+            }
+        }
+        std::sort(triangles.begin(), triangles.end());
+        triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+        std::vector<uint64_t> result;
+        result.reserve(triangles.size());
+        for (const auto &triangle : triangles)
+        {
+            uint64_t key;
+            if (tripletKey(m, rows[triangle[0]], rows[triangle[1]], rows[triangle[2]], key))
+                result.push_back(key);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Computes the invariant key of one triangle. Returns false for degenerate triangles.
+     */
+    bool tripletKey(const Minutiae &m, size_t r0, size_t r1, size_t r2, uint64_t &key) const
+    {
+        const size_t rows[3] = {r0, r1, r2};
+        float side[3];
+        for (int v = 0; v < 3; ++v)
+        {
+            size_t p = rows[(v + 1) % 3], q = rows[(v + 2) % 3];
+            float dx = m.x[p] - m.x[q], dy = m.y[p] - m.y[q];
+            side[v] = std::sqrt(dx * dx + dy * dy); // Side opposite to vertex v
+        }
+
+        // Vertices in decreasing order of their opposite side
+        int order[3] = {0, 1, 2};
+        std::sort(order, order + 3, [&side](int a, int b)
+                  { return side[a] > side[b]; });
+        if (side[order[2]] < lengthBin)
+            return false;
+
+        float cx = (m.x[r0] + m.x[r1] + m.x[r2]) / 3, cy = (m.y[r0] + m.y[r1] + m.y[r2]) / 3;
+        key = uint64_t(1) << 63;
+        for (int v = 0; v < 3; ++v)
+        {
+            size_t row = rows[order[v]];
+            uint64_t length = std::min<uint64_t>(1023, static_cast<uint64_t>(side[order[v]] / lengthBin));
+            float towardsCentroid = std::atan2(cy - m.y[row], cx - m.x[row]) / 6.2831853f * fullTurn;
+            float relative = m.theta[row] - towardsCentroid;
+            relative -= std::floor(relative / fullTurn) * fullTurn;
+            uint64_t angle = std::min<uint64_t>(angleBins - 1, static_cast<uint64_t>(relative / fullTurn * angleBins));
+
+            key |= length << (10 * v);
+            key |= angle << (30 + 5 * v);
+        }
+        return true;
+    }
+
+    float lengthBin;    ///< Side length quantization step
+    uint32_t angleBins; ///< Relative direction bins
+    uint32_t neighbors; ///< Neighbors per minutia
+    float fullTurn;     ///< A full turn in theta units
+
+    size_t count = 0;                 ///< Number of entries
+    size_t capacity = 0;              ///< Number of slots (a power of two)
+    const uint64_t *keys = nullptr;   ///< Key per slot (0 = empty)
+    const uint32_t *values = nullptr; ///< Individual ID per slot
+
+    HugeVector<uint64_t> ownedKeys;              ///< Storage of a built table
+    HugeVector<uint32_t> ownedValues;            ///< Storage of a built table
+    std::shared_ptr<const BinaryReader> mapping; ///< File of a loaded table
+    HugePageMode hugePages = HugePageMode::Off;  ///< Pages of the next table
+};
+
+#endif // TRIPLET_INDEX_HPP
@@ -0,0 +1,246 @@
+#ifndef VOTE_AGGREGATOR_HPP
+#define VOTE_AGGREGATOR_HPP
+
+#include <vector>
+#include <algorithm> // For std::partial_sort
+#include <limits>    // For std::numeric_limits
+#include <cstdint>   // For uint32_t
+#include <unordered_map>
+#include "NNList.hpp"
+#include "../data/ParentedFeature.hpp" // For representativeId
+
+/**
+ * @brief Voting policy: an Individual scores one vote per neighbor (higher is better).
+ */
+struct FrequencyVote
+{
+    static constexpr double initial = 0.0;
+    static constexpr bool higherIsBetter = true;
+
+    static void update(double &score, double distance, size_t rank)
+    {
+        (void)distance;
+        (void)rank;
+        score += 1.0;
+    }
+
+    /// Largest score an Individual can gain from one list of k neighbors
+    static double maxGain(size_t k)
+    {
+        return static_cast<double>(k);
+    }
+};
+
+/**
+ * @brief Voting policy: an Individual scores its smallest neighbor distance (lower is better).
+ */
+struct DistanceVote
+{
+    static constexpr double initial = std::numeric_limits<double>::infinity();
+    static constexpr bool higherIsBetter = false;
+
+    static void update(double &score, double distance, size_t rank)
+    {
+        (void)rank;
+        score = std::min(score, distance);
+    }
+};
+
+/**
+ * @brief Voting policy: a neighbor at rank r (0 = nearest) is worth 1 / (r + 1) (higher is better).
+ *
+ * Unlike FrequencyVote, an Individual that is the nearest neighbor of a few minutiae beats one
+ * that only shows up at the tail of many lists.
+ */
+struct WeightedVote
+{
+    static constexpr double initial = 0.0;
+    static constexpr bool higherIsBetter = true;
+
+    static void update(double &score, double distance, size_t rank)
+    {
+        (void)distance;
+        score += 1.0 / static_cast<double>(rank + 1);
+    }
+
+    /// Largest score an Individual can gain from one list of k neighbors
+    static double maxGain(size_t k)
+    {
+        double gain = 0.0;
+        for (size_t rank = 0; rank < k; ++rank)
+        {
+            gain += 1.0 / static_cast<double>(rank + 1);
+        }
+        return gain;
+    }
+};
+
+/**
+ * @brief Accumulates neighbor votes per Individual as they are produced.
+ *
+ * Scores live in a dense array indexed by Individual ID (IDs are small consecutive integers), so
+ * each vote is a single array update and no neighbor list has to be kept. The policy is a
+ * template parameter, resolved at compile time.
+ *
+ * @tparam Policy FrequencyVote, DistanceVote, WeightedVote or any type with the same interface.
+ */
+template <typename Policy>
+class VoteAggregator
+{
+public:
+    /**
+     * @brief Constructs an aggregator.
+     *
+     * @param maxIndividualId Largest expected Individual ID; the array grows past it if needed.
+     */
+    explicit VoteAggregator(uint32_t maxIndividualId = 0) : scores(maxIndividualId + 1, Policy::initial), voted(maxIndividualId + 1, 0) {}
+
+    /**
+     * @brief Adds one vote.
+     *
+     * @param individualId ID of the Individual voted for (0 is ignored).
+     * @param distance Distance of the neighbor.
+     * @param rank Rank of the neighbor in its list (0 = nearest).
+     */
+    void add(uint32_t individualId, double distance, size_t rank)
+    {
+        if (individualId == 0)
+            return;
+        if (individualId >= scores.size())
+        {
+            scores.resize(individualId + 1, Policy::initial);
+            voted.resize(individualId + 1, 0);
+        }
+
+        if (!voted[individualId])
+        {
+            voted[individualId] = 1;
+            touched.push_back(individualId);
+        }
+        Policy::update(scores[individualId], distance, rank);
+    }
+
+    /**
+     * @brief Adds the votes of a neighbor list.
+     *
+     * @param list The k-nearest neighbors of one query object.
+     */
+    template <typename T>
+    void add(const NNList<T> &list)
+    {
+        size_t rank = 0;
+        for (const auto &entry : list)
+        {
+            add(representativeId(entry.element), entry.distance, rank++);
+        }
+    }
+
+    /**
+     * @brief Returns the score of an Individual (Policy::initial if it got no vote).
+     */
+    double score(uint32_t individualId) const
+    {
+        return individualId < scores.size() ? scores[individualId] : Policy::initial;
+    }
+
+    /**
+     * @brief Returns the k best Individuals with their scores, best first (ties by smaller ID).
+     *
+     * Only Individuals that received votes are ranked, with a partial sort.
+     *
+     * @param k The number of Individuals.
+     */
+    std::vector<std::pair<uint32_t, double>> top(size_t k) const
+    {
+        std::vector<uint32_t> candidates(touched);
+        auto better = [this](uint32_t a, uint32_t b)
+        {
+            if (scores[a] != scores[b])
+                return Policy::higherIsBetter ? scores[a] > scores[b] : scores[a] < scores[b];
+            return a < b;
+        };
+        k = std::min(k, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(), better);
+
+        std::vector<std::pair<uint32_t, double>> best;
+        best.reserve(k);
+        for (size_t i = 0; i < k; ++i)
+        {
+            best.emplace_back(candidates[i], scores[candidates[i]]);
+        }
+        return best;
+    }
+
+    /**
+     * @brief Returns the number of Individuals that received at least one vote.
+     */
+    size_t numVoted() const
+    {
+        return touched.size();
+    }
+
+    /**
+     * @brief Clears the votes, touching only the Individuals that received one.
+     */
+    void reset()
+    {
+        for (uint32_t individualId : touched)
+        {
+            scores[individualId] = Policy::initial;
+            voted[individualId] = 0;
+        }
+        touched.clear();
+    }
+
+private:
+    std::vector<double> scores;    ///< Score per Individual ID
+    std::vector<uint8_t> voted;    ///< 1 if the Individual received a vote
+    std::vector<uint32_t> touched; ///< Individuals with at least one vote
+};
+
+/**
+ * @brief Fuses two rankings of Individuals (ID, score, higher is better), e.g. NNResult votes
+ * and TripletIndex votes.
+ *
+ * Each ranking is divided by its best score so both count the same whatever their scale, then
+ * the normalized scores of each Individual are summed, the second weighted by weightB.
+ *
+ * @param a The first ranking.
+ * @param b The second ranking.
+ * @param weightB Weight of the second ranking (the first has weight 1).
+ * @param k The number of Individuals returned.
+ * @return std::vector<std::pair<uint32_t, double>> The k best Individuals by fused score (ties by smaller ID).
+ */
+inline std::vector<std::pair<uint32_t, double>> fuseScores(const std::vector<std::pair<uint32_t, double>> &a, const std::vector<std::pair<uint32_t, double>> &b,
+                                                           double weightB = 1.0, size_t k = std::numeric_limits<size_t>::max())
+{
+    std::unordered_map<uint32_t, double> fused;
+    auto addRanking = [&fused](const std::vector<std::pair<uint32_t, double>> &ranking, double weight)
+    {
+        double best = 0.0;
+        for (const auto &entry : ranking)
+        {
+            best = std::max(best, entry.second);
+        }
+        if (best <= 0.0)
+            return;
+        for (const auto &entry : ranking)
+        {
+            fused[entry.first] += weight * entry.second / best;
+        }
+    };
+    addRanking(a, 1.0);
+    addRanking(b, weightB);
+
+    std::vector<std::pair<uint32_t, double>> ranking(fused.begin(), fused.end());
+    auto better = [](const std::pair<uint32_t, double> &x, const std::pair<uint32_t, double> &y)
+    {
+        return x.second != y.second ? x.second > y.second : x.first < y.first;
+    };
+    k = std::min(k, ranking.size());
+    std::partial_sort(ranking.begin(), ranking.begin() + k, ranking.end(), better);
+    ranking.resize(k);
+    return ranking;
+}
+
+#endif // VOTE_AGGREGATOR_HPP
@@ -6,18 +6,22 @@
 #include <cmath> // For std::sqrt, std::abs
 #include <numeric> // For std::inner_product
 #include <stdexcept> // For std::invalid_argument
+#include <atomic> // For std::atomic
+#include <mutex> // For std::mutex, std::lock_guard
 #include "LinAlg.hpp" // For linear algebra operations
 
 /**
  * @brief Base class for distance functions.
+ *
+ * Every evaluation is counted in a counter of the calling thread, written only by that thread,
+ * so searches running on many threads (or sockets) do not share a cache line per distance; calls()
+ * sums the counters when asked.
  * 
  * @tparam F Vector type.
  */
 template <typename F>
 class DistanceFunction {
 public:
-    static unsigned long int distanceFunctionCalls;
-
     /**
      * @brief Computes the distance between two vectors.
      * 
@@ -29,20 +33,119 @@ public:
     virtual float operator()(const F& a, const F& b) const = 0;
 
     /**
-     * @brief Resets the distance function call counter.
+     * @brief Returns the number of distances computed by all threads since the last reset.
+     */
+    static unsigned long int calls() {
+        Registry &registry = counters();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        unsigned long int total = registry.finished;
+        for (const Counter *counter : registry.live) {
+            total += counter->count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    /**
+     * @brief Resets the distance function call counter (while no search is running).
      */
     static void resetCounter() {
-        distanceFunctionCalls = 0;
+        Registry &registry = counters();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.finished = 0;
+        for (Counter *counter : registry.live) {
+            counter->count.store(0, std::memory_order_relaxed);
+        }
     }
-};
 
-/**
- * @brief Static member initialization for distance function calls.
- * 
- * @tparam T The type of the elements in the vectors.
- */
-template <typename F>
-unsigned long int DistanceFunction<F>::distanceFunctionCalls = 0;
+    /**
+     * @brief Adds n evaluations to the counter of the calling thread.
+     *
+     * Kernels computing distances without the operator (e.g. LinAlg::squaredDistance in a scan
+     * loop) report their evaluations here once, at the end of their work.
+     */
+    static void countCalls(unsigned long int n = 1) {
+        std::atomic<unsigned long int> &count = localCounter().count;
+        count.store(count.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); // Single writer: no locked instruction
+    }
+
+    /**
+     * @brief Stand-in for the former counter variable, forwarding to calls(), resetCounter() and countCalls().
+     */
+    struct CallCounter {
+        operator unsigned long int() const { return calls(); }
+
+        CallCounter &operator=(unsigned long int value) {
+            resetCounter();
+            countCalls(value);
+            return *this;
+        }
+
+        CallCounter &operator+=(unsigned long int n) {
+            countCalls(n);
+            return *this;
+        }
+
+        CallCounter &operator++() { return *this += 1; }
+        unsigned long int operator++(int) {
+            unsigned long int before = calls();
+            countCalls();
+            return before;
+        }
+    };
+
+    /**
+     * @brief Number of distances computed, kept so existing code reading, resetting or incrementing
+     * it still compiles. Each access sums the per-thread counters.
+     *
+     * @deprecated Use calls(), resetCounter() and countCalls().
+     */
+    [[deprecated("use calls(), resetCounter() and countCalls()")]] static inline CallCounter distanceFunctionCalls{};
+
+private:
+    struct Registry;
+
+    /**
+     * @brief Evaluations of one thread, folded into the registry when the thread exits.
+     */
+    struct Counter {
+        std::atomic<unsigned long int> count{0}; ///< Written by the owning thread only
+
+        Counter() {
+            Registry &registry = counters();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.live.push_back(this);
+        }
+
+        ~Counter() {
+            Registry &registry = counters();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.finished += count.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < registry.live.size(); ++i) {
+                if (registry.live[i] == this) {
+                    registry.live[i] = registry.live.back();
+                    registry.live.pop_back();
+                    break;
+                }
+            }
+        }
+    };
+
+    struct Registry {
+        std::mutex mutex;               ///< Guards live and finished
+        std::vector<Counter *> live;    ///< Counters of running threads
+        unsigned long int finished = 0; ///< Evaluations of exited threads
+    };
+
+    static Registry &counters() {
+        static Registry registry;
+        return registry;
+    }
+
+    static Counter &localCounter() {
+        thread_local Counter counter;
+        return counter;
+    }
+};
 
 /**
  * @brief Class for computing Euclidean distance.
@@ -57,14 +160,16 @@ unsigned long int DistanceFunction<F>::distanceFunctionCalls = 0;
 template <typename F>
 class EuclideanDistance : public DistanceFunction<F> {
 public:
+    static constexpr const char *name = "euclidean"; ///< Name stored in persisted indexes
+
     float operator()(const F& a, const F& b) const override {
-        DistanceFunction<F>::distanceFunctionCalls++;
+        DistanceFunction<F>::countCalls();
         if (a.size() != b.size()) {
             throw std::invalid_argument("Vectors must be of the same size");
         }
 
-        F diff = LinAlg::vecSum<F>(a, LinAlg::scalarProd(b, -1.0f));
-        return LinAlg::norm<F>(diff);
+        // Same sum as the kernels calling LinAlg::squaredDistance directly, so their distances are equal
+        return a.size() == 0 ? 0.0f : std::sqrt(LinAlg::squaredDistance(&a[0], &b[0], a.size()));
     }
 };
 
@@ -81,8 +186,10 @@ public:
 template <typename F>
 class ManhattanDistance : public DistanceFunction<F> {
 public:
+    static constexpr const char *name = "manhattan"; ///< Name stored in persisted indexes
+
     float operator()(const F& a, const F& b) const override {
-        DistanceFunction<F>::distanceFunctionCalls++;
+        DistanceFunction<F>::countCalls();
         if (a.size() != b.size()) {
             throw std::invalid_argument("Vectors must be of the same size");
         }
@@ -108,8 +215,10 @@ public:
 template <typename F>
 class ChebyshevDistance : public DistanceFunction<F> {
 public:
+    static constexpr const char *name = "chebyshev"; ///< Name stored in persisted indexes
+
     float operator()(const F& a, const F& b) const override {
-        DistanceFunction<F>::distanceFunctionCalls++;
+        DistanceFunction<F>::countCalls();
         if (a.size() != b.size()) {
             throw std::invalid_argument("Vectors must be of the same size");
         }
@@ -138,8 +247,10 @@ public:
 template <typename F>
 class CosineDistance : public DistanceFunction<F> {
 public:
+    static constexpr const char *name = "cosine"; ///< Name stored in persisted indexes
+
     float operator()(const F& a, const F& b) const override {
-        DistanceFunction<F>::distanceFunctionCalls++;
+        DistanceFunction<F>::countCalls();
         if (a.size() != b.size()) {
             throw std::invalid_argument("Vectors must be of the same size");
         }
@@ -170,8 +281,10 @@ public:
 template <typename F>
 class NormalizedCosineDistance : public DistanceFunction<F> {
 public:
+    static constexpr const char *name = "normalized_cosine"; ///< Name stored in persisted indexes
+
     float operator()(const F& a, const F& b) const override {
-        DistanceFunction<F>::distanceFunctionCalls++;
+        DistanceFunction<F>::countCalls();
         if (a.size() != b.size()) {
             throw std::invalid_argument("Vectors must be of the same size");
         }
@@ -4,6 +4,9 @@
 #include <vector>
 #include <cmath>
 #include <numeric>
+#include <algorithm> // For std::sort, std::fill
+#include <string>    // For std::to_string
+#include <stdexcept> // For std::invalid_argument
 
 /**
  * @brief Namespace for linear algebra operations.
@@ -132,6 +135,203 @@ F vecPairwiseProd(const F &feature1, const F &feature2)
     return result;
 }
 
+/**
+ * @brief Squared Euclidean distance between two raw descriptors.
+ *
+ * Eight independent partial sums let the compiler vectorize the loop without reordering a
+ * single floating-point reduction.
+ */
+inline float squaredDistance(const float *a, const float *b, size_t dim)
+{
+    float partial[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    size_t j = 0;
+    for (; j + 8 <= dim; j += 8)
+    {
+        for (size_t l = 0; l < 8; ++l)
+        {
+            float d = a[j + l] - b[j + l];
+            partial[l] += d * d;
+        }
+    }
+    for (; j < dim; ++j)
+    {
+        float d = a[j] - b[j];
+        partial[0] += d * d;
+    }
+    return ((partial[0] + partial[1]) + (partial[2] + partial[3])) + ((partial[4] + partial[5]) + (partial[6] + partial[7]));
+}
+
+/**
+ * @brief Transposes a row-major matrix: out = m^T.
+ *
+ * @param m Matrix of rows x cols.
+ * @param out Matrix of cols x rows, overwritten.
+ */
+inline void transpose(const float *m, size_t rows, size_t cols, float *out)
+{
+    for (size_t r = 0; r < rows; ++r)
+    {
+        for (size_t c = 0; c < cols; ++c)
+        {
+            out[c * rows + r] = m[r * cols + c];
+        }
+    }
+}
+
+/**
+ * @brief Multiplies a row-major matrix by another given transposed: out = a * b^T, from bT = b^T.
+ *
+ * The output is computed in blocks of blockRows x blockCols: for every j, each row of the block
+ * accumulates a[r][j] times a contiguous slice of row j of bT. That inner loop has no dependency
+ * between its iterations and the compiler vectorizes it, the output block stays in L1 and the
+ * dim x blockCols slab of bT is reused by every row block while it is in L2. Transpose b once
+ * (transpose) when it multiplies several matrices, e.g. a projection applied to every query.
+ *
+ * @param a Matrix of rows x dim.
+ * @param bT Matrix of dim x cols (b transposed).
+ * @param out Matrix of rows x cols, overwritten.
+ */
+inline void matMulPreTransposed(const float *a, size_t rows, const float *bT, size_t cols, size_t dim, float *out)
+{
+    const size_t blockRows = 8, blockCols = 256;
+    for (size_t c0 = 0; c0 < cols; c0 += blockCols)
+    {
+        size_t c1 = std::min(cols, c0 + blockCols);
+        for (size_t r0 = 0; r0 < rows; r0 += blockRows)
+        {
+            size_t r1 = std::min(rows, r0 + blockRows);
+            for (size_t r = r0; r < r1; ++r)
+            {
+                std::fill(out + r * cols + c0, out + r * cols + c1, 0.0f);
+            }
+            for (size_t j = 0; j < dim; ++j)
+            {
+                const float *bRow = bT + j * cols;
+                for (size_t r = r0; r < r1; ++r)
+                {
+                    const float x = a[r * dim + j];
+                    float *outRow = out + r * cols;
+                    for (size_t c = c0; c < c1; ++c)
+                    {
+                        outRow[c] += x * bRow[c];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Multiplies a row-major matrix by the transpose of another: out = a * b^T.
+ *
+ * Transposes b into a temporary and runs matMulPreTransposed; callers multiplying by the same b
+ * repeatedly should keep b^T instead.
+ *
+ * @param a Matrix of rows x dim.
+ * @param b Matrix of cols x dim.
+ * @param out Matrix of rows x cols, overwritten.
+ */
+inline void matMulTransposed(const float *a, size_t rows, const float *b, size_t cols, size_t dim, float *out)
+{
+    std::vector<float> bT(dim * cols);
+    transpose(b, cols, dim, bT.data());
+    matMulPreTransposed(a, rows, bT.data(), cols, dim, out);
+}
+
+/**
+ * @brief Eigendecomposition of a symmetric matrix by cyclic Jacobi rotations.
+ *
+ * @param a Row-major n x n symmetric matrix; destroyed.
+ * @param n The order of the matrix.
+ * @param eigenvalues Receives the n eigenvalues, in decreasing order.
+ * @param eigenvectors Receives the matching unit eigenvectors, one per row (n x n row-major).
+ * @param maxSweeps Largest number of sweeps over the off-diagonal elements.
+ */
+inline void symmetricEigen(std::vector<double> &a, size_t n, std::vector<double> &eigenvalues, std::vector<double> &eigenvectors, int maxSweeps = 64)
+{
+    if (a.size() != n * n)
+    {
+        throw std::invalid_argument("Matrix must be " + std::to_string(n) + "x" + std::to_string(n));
+    }
+
+    // v accumulates the rotations; its columns converge to the eigenvectors
+    std::vector<double> v(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        v[i * n + i] = 1.0;
+    }
+
+    double scale = 0.0;
+    for (double x : a)
+    {
+        scale += x * x;
+    }
+
+    for (int sweep = 0; sweep < maxSweeps; ++sweep)
+    {
+        double off = 0.0;
+        for (size_t p = 0; p < n; ++p)
+        {
+            for (size_t q = p + 1; q < n; ++q)
+            {
+                off += a[p * n + q] * a[p * n + q];
+            }
+        }
+        if (off <= 1e-24 * scale)
+            break;
+
+        for (size_t p = 0; p < n; ++p)
+        {
+            for (size_t q = p + 1; q < n; ++q)
+            {
+                double apq = a[p * n + q];
+                if (apq == 0.0)
+                    continue;
+
+                // Rotation zeroing a[p][q]: t is the smaller root of t^2 + 2 theta t - 1 = 0
+                double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+
+                for (size_t k = 0; k < n; ++k)
+                {
+                    double akp = a[k * n + p], akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (size_t k = 0; k < n; ++k)
+                {
+                    double apk = a[p * n + k], aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (size_t k = 0; k < n; ++k)
+                {
+                    double vkp = v[k * n + p], vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(), [&a, n](size_t i, size_t j)
+              { return a[i * n + i] > a[j * n + j]; });
+
+    eigenvalues.resize(n);
+    eigenvectors.resize(n * n);
+    for (size_t r = 0; r < n; ++r)
+    {
+        eigenvalues[r] = a[order[r] * n + order[r]];
+        for (size_t k = 0; k < n; ++k)
+        {
+            eigenvectors[r * n + k] = v[k * n + order[r]];
+        }
+    }
+}
+
 } // namespace LinAlg
 
 #endif // LINALG_HPP
\ No newline at end of file
@@ -0,0 +1,350 @@
+#ifndef PCA_HPP
+#define PCA_HPP
+
+#include <vector>
+#include <memory>        // For std::shared_ptr
+#include <string>
+#include <cmath>         // For std::sqrt
+#include <algorithm>     // For std::min
+#include <unordered_map> // For std::unordered_map
+#include <mutex>         // For std::mutex, std::lock_guard
+#include <stdexcept>     // For std::invalid_argument, std::logic_error, std::runtime_error
+#include "LinAlg.hpp"
+#include "../concurrency/Parallel.hpp"
+#include "../data/BinaryFile.hpp"
+#include "../data/FeatureStats.hpp"
+#include "../data/Individual.hpp"
+
+/**
+ * @brief Principal component analysis of descriptors, to search in fewer dimensions.
+ *
+ * fit() estimates the mean and the covariance of a sample of descriptors on several threads,
+ * each accumulating its rows block by block into its own matrix, and keeps the eigenvectors of
+ * the largest eigenvalues (LinAlg::symmetricEigen). Projection subtracts the mean and multiplies
+ * blocks of descriptors by the component matrix, kept transposed once fitted or loaded
+ * (LinAlg::matMulPreTransposed); with whitening, each component is also divided by its standard
+ * deviation.
+ *
+ * Project the gallery before attaching searchers, and every query with the same fitted PCA.
+ */
+class PCA
+{
+public:
+    /**
+     * @brief Constructs an unfitted PCA.
+     *
+     * @param components Number of dimensions kept.
+     * @param whiten If true, scale the components to unit variance.
+     * @param epsilon Added to the variances before whitening, to bound the gain of weak components.
+     */
+    PCA(size_t components = 32, bool whiten = false, float epsilon = 1e-6f)
+        : nComponents(components), whiten(whiten), epsilon(epsilon) {}
+
+    /**
+     * @brief Fits the transform to a sample of descriptors.
+     *
+     * @param sample The descriptors, all of the same dimension.
+     * @param nThreads The number of threads (0 means hardware concurrency).
+     * @param maxSamples If the sample is larger, only evenly spaced descriptors are used.
+     */
+    template <typename F>
+    void fit(const std::vector<F> &sample, unsigned nThreads = 0, size_t maxSamples = 200000)
+    {
+        if (sample.empty())
+            throw std::invalid_argument("Cannot fit a PCA without descriptors");
+
+        std::vector<const float *> rows;
+        size_t stride = std::max<size_t>(1, (sample.size() + maxSamples - 1) / maxSamples);
+        for (size_t i = 0; i < sample.size(); i += stride)
+        {
+            if (sample[i].size() != sample[0].size())
+                throw std::invalid_argument("Descriptors of the sample have different dimensions");
+            rows.push_back(sample[i].values.data());
+        }
+        inputDim = sample[0].size();
+        nComponents = std::min(nComponents, inputDim);
+        const size_t d = inputDim;
+
+        // 1. Mean, as merged per-thread statistics
+        FeatureStats stats;
+        std::mutex mergeMutex;
+        parallelFor(rows.size(), nThreads, [&](size_t begin, size_t end)
+                    {
+            FeatureStats partial;
+            for (size_t r = begin; r < end; ++r)
+                partial.add(rows[r], d);
+            std::lock_guard<std::mutex> lock(mergeMutex);
+            stats.merge(partial); });
+        means = stats.mean();
+
+        // 2. Covariance: each thread sums the outer products of its rows, blockRows at a time
+        const size_t blockRows = 64;
+        std::vector<double> cov(d * d, 0.0);
+        parallelFor(rows.size(), nThreads, [&](size_t begin, size_t end)
+                    {
+            std::vector<double> partial(d * d, 0.0);
+            std::vector<double> block(blockRows * d);
+            for (size_t b0 = begin; b0 < end; b0 += blockRows)
+            {
+                size_t b1 = std::min(end, b0 + blockRows);
+                for (size_t r = b0; r < b1; ++r)
+                {
+                    for (size_t j = 0; j < d; ++j)
+                        block[(r - b0) * d + j] = static_cast<double>(rows[r][j]) - means[j];
+                }
+                for (size_t r = 0; r < b1 - b0; ++r)
+                {
+                    const double *x = &block[r * d];
+                    for (size_t i = 0; i < d; ++i)
+                    {
+                        double xi = x[i];
+                        double *covRow = &partial[i * d];
+                        for (size_t j = i; j < d; ++j)
+                            covRow[j] += xi * x[j];
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(mergeMutex);
+            for (size_t i = 0; i < partial.size(); ++i)
+                cov[i] += partial[i]; });
+
+        for (size_t i = 0; i < d; ++i)
+        {
+            for (size_t j = i; j < d; ++j)
+            {
+                cov[i * d + j] /= static_cast<double>(rows.size());
+                cov[j * d + i] = cov[i * d + j];
+            }
+        }
+
+        // 3. Keep the eigenvectors of the largest eigenvalues
+        std::vector<double> eigenvalues, eigenvectors;
+        LinAlg::symmetricEigen(cov, d, eigenvalues, eigenvectors);
+
+        totalVariance = 0.0;
+        for (double value : eigenvalues)
+        {
+            totalVariance += std::max(value, 0.0);
+        }
+        variances.resize(nComponents);
+        matrix.resize(nComponents * d);
+        for (size_t c = 0; c < nComponents; ++c)
+        {
+            variances[c] = static_cast<float>(std::max(eigenvalues[c], 0.0));
+            double gain = whiten ? 1.0 / std::sqrt(variances[c] + static_cast<double>(epsilon)) : 1.0;
+            for (size_t j = 0; j < d; ++j)
+            {
+                matrix[c * d + j] = static_cast<float>(eigenvectors[c * d + j] * gain);
+            }
+        }
+        transposeMatrix();
+    }
+
+    /**
+     * @brief Replaces the values of a descriptor (e.g. a query) by its projection; the ID is kept.
+     */
+    template <typename F>
+    void project(F &feature) const
+    {
+        checkInput(feature.size());
+        std::vector<float> centered(inputDim);
+        for (size_t j = 0; j < inputDim; ++j)
+        {
+            centered[j] = feature.values[j] - means[j];
+        }
+        std::vector<float> projected(nComponents);
+        LinAlg::matMulPreTransposed(centered.data(), 1, matrixT.data(), nComponents, inputDim, projected.data());
+        feature.values.swap(projected);
+    }
+
+    /**
+     * @brief Projects descriptors in place, in blocks, on several threads. IDs and representatives are kept.
+     *
+     * @param features The descriptors.
+     * @param nThreads The number of threads (0 means hardware concurrency).
+     */
+    template <typename F>
+    void projectAll(std::vector<F> &features, unsigned nThreads = 0) const
+    {
+        for (const auto &f : features)
+        {
+            checkInput(f.size());
+        }
+
+        const size_t blockRows = 256;
+        parallelFor(features.size(), nThreads, [&](size_t begin, size_t end)
+                    {
+            std::vector<float> block(blockRows * inputDim), projected(blockRows * nComponents);
+            for (size_t b0 = begin; b0 < end; b0 += blockRows)
+            {
+                size_t n = std::min(end, b0 + blockRows) - b0;
+                for (size_t r = 0; r < n; ++r)
+                {
+                    const float *x = features[b0 + r].values.data();
+                    for (size_t j = 0; j < inputDim; ++j)
+                        block[r * inputDim + j] = x[j] - means[j];
+                }
+                LinAlg::matMulPreTransposed(block.data(), n, matrixT.data(), nComponents, inputDim, projected.data());
+                for (size_t r = 0; r < n; ++r)
+                    features[b0 + r].values.assign(projected.begin() + r * nComponents, projected.begin() + (r + 1) * nComponents);
+            } });
+    }
+
+    /**
+     * @brief Projects the gallery descriptors in place and recomputes the mean and standard
+     * deviation of every Individual in the reduced space.
+     *
+     * @param individuals The Individuals owning the descriptors.
+     * @param features The descriptors.
+     * @param nThreads The number of threads (0 means hardware concurrency).
+     */
+    template <typename F>
+    void projectAll(const std::vector<std::shared_ptr<Individual<F>>> &individuals, std::vector<F> &features, unsigned nThreads = 0) const
+    {
+        projectAll(features, nThreads);
+
+        std::unordered_map<const Individual<F> *, FeatureStats> stats;
+        for (const auto &f : features)
+        {
+            if (f.representative != nullptr)
+                stats[f.representative].add(f.values);
+        }
+        for (const auto &individual : individuals)
+        {
+            individual->mean.values.clear();
+            individual->stddev.values.clear();
+            individual->statisticsCount = 0;
+            individual->setStatistics(stats[individual.get()]);
+        }
+    }
+
+    /**
+     * @brief Returns true once fit() or load() has run.
+     */
+    bool fitted() const
+    {
+        return inputDim != 0;
+    }
+
+    /**
+     * @brief Returns the dimension of the descriptors before projection.
+     */
+    size_t inputDimension() const
+    {
+        return inputDim;
+    }
+
+    /**
+     * @brief Returns the dimension of the projected descriptors.
+     */
+    size_t outputDimension() const
+    {
+        return nComponents;
+    }
+
+    /**
+     * @brief Returns the fraction of the sample variance kept by the components.
+     */
+    double explainedVariance() const
+    {
+        double kept = 0.0;
+        for (float value : variances)
+        {
+            kept += value;
+        }
+        return totalVariance > 0.0 ? kept / totalVariance : 0.0;
+    }
+
+    /**
+     * @brief Saves the fitted transform as one section, e.g. in the file of the gallery.
+     *
+     * @param writer The writer.
+     * @param name Name of the section.
+     */
+    void save(BinaryWriter &writer, const std::string &name = "pca") const
+    {
+        if (!fitted())
+            throw std::logic_error("Cannot save an unfitted PCA");
+
+        writer.beginSection(name);
+        writer.write(uint32_t(inputDim));
+        writer.write(uint32_t(nComponents));
+        writer.write(uint32_t(whiten ? 1 : 0));
+        writer.write(epsilon);
+        writer.write(totalVariance);
+        writer.writeArray(means.data(), inputDim);
+        writer.writeArray(variances.data(), nComponents);
+        writer.writeArray(matrix.data(), nComponents * inputDim);
+        writer.endSection();
+    }
+
+    /**
+     * @brief Loads a transform saved by save().
+     *
+     * @param reader The reader.
+     * @param name Name of the section.
+     * @throws std::runtime_error if the dimensions are invalid or exceed the section.
+     */
+    void load(const BinaryReader &reader, const std::string &name = "pca")
+    {
+        SectionReader section = reader.section(name);
+        uint32_t savedInputDim = section.read<uint32_t>();
+        uint32_t savedComponents = section.read<uint32_t>();
+        bool savedWhiten = section.read<uint32_t>() != 0;
+        float savedEpsilon = section.read<float>();
+        double savedVariance = section.read<double>();
+
+        // Both dimensions are 32-bit, so the matrix size cannot overflow 64 bits
+        uint64_t floats = uint64_t(savedInputDim) + savedComponents + uint64_t(savedComponents) * savedInputDim;
+        if (savedComponents == 0 || savedComponents > savedInputDim)
+            throw std::runtime_error("Invalid PCA dimensions in section " + name);
+        if (floats > section.remaining() / sizeof(float))
+            throw std::runtime_error("Section " + name + " is truncated");
+
+        inputDim = savedInputDim;
+        nComponents = savedComponents;
+        whiten = savedWhiten;
+        epsilon = savedEpsilon;
+        totalVariance = savedVariance;
+        means.resize(inputDim);
+        variances.resize(nComponents);
+        matrix.resize(nComponents * inputDim);
+        section.readArray(means.data(), means.size());
+        section.readArray(variances.data(), variances.size());
+        section.readArray(matrix.data(), matrix.size());
+        transposeMatrix();
+    }
+
+private:
+    /**
+     * @brief Refreshes matrixT from matrix.
+     */
+    void transposeMatrix()
+    {
+        matrixT.resize(matrix.size());
+        LinAlg::transpose(matrix.data(), nComponents, inputDim, matrixT.data());
+    }
+
+    /**
+     * @brief Throws if the PCA is unfitted or the descriptor has the wrong dimension.
+     */
+    void checkInput(size_t size) const
+    {
+        if (!fitted())
+            throw std::logic_error("PCA used before fit() or load()");
+        if (size != inputDim)
+            throw std::invalid_argument("Descriptor of size " + std::to_string(size) + ", PCA fitted on " + std::to_string(inputDim));
+    }
+
+    size_t nComponents;           ///< Number of components kept
+    bool whiten;                  ///< Scale components to unit variance
+    float epsilon;                ///< Variance regularization of whitening
+    size_t inputDim = 0;          ///< Dimension of the descriptors (0 = unfitted)
+    double totalVariance = 0.0;   ///< Sum of all variances of the sample
+    std::vector<float> means;     ///< Sample mean, inputDim values
+    std::vector<float> variances; ///< Variance of each kept component
+    std::vector<float> matrix;    ///< Components (whitened if enabled), nComponents x inputDim row-major
+    std::vector<float> matrixT;   ///< The same components transposed, inputDim x nComponents, for projection
+};
+
+#endif // PCA_HPP
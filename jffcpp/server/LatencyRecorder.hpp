@@ -0,0 +1,98 @@
+#ifndef LATENCY_RECORDER_HPP
+#define LATENCY_RECORDER_HPP
+
+#include <vector>
+#include <mutex>     // For std::mutex, std::lock_guard
+#include <algorithm> // For std::max, std::nth_element
+#include <cstdint>   // For uint64_t
+
+/**
+ * @brief Thread-safe latency counters with percentiles over the most recent samples.
+ *
+ * Count, mean and maximum cover every recorded sample; percentiles are computed on demand over a
+ * window of the last samples, so they follow the current load and memory stays bounded.
+ */
+class LatencyRecorder
+{
+public:
+    /**
+     * @brief Constructs a recorder keeping the last window samples for percentiles.
+     */
+    explicit LatencyRecorder(size_t window = 8192) : window(std::max<size_t>(window, 1)) {}
+
+    /**
+     * @brief Records one latency, in milliseconds.
+     */
+    void record(double ms)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++total;
+        sum += ms;
+        maximum = std::max(maximum, ms);
+        if (recent.size() < window)
+        {
+            recent.push_back(ms);
+        }
+        else
+        {
+            recent[next] = ms;
+            next = (next + 1) % window;
+        }
+    }
+
+    /**
+     * @brief Returns the number of recorded samples.
+     */
+    uint64_t count() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return total;
+    }
+
+    /**
+     * @brief Returns the mean of all samples (0 if none).
+     */
+    double mean() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return total > 0 ? sum / static_cast<double>(total) : 0.0;
+    }
+
+    /**
+     * @brief Returns the largest sample (0 if none).
+     */
+    double max() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return maximum;
+    }
+
+    /**
+     * @brief Returns the p-th percentile (p in [0, 1]) of the recent samples (0 if none).
+     */
+    double percentile(double p) const
+    {
+        std::vector<double> samples;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            samples = recent;
+        }
+        if (samples.empty())
+            return 0.0;
+
+        size_t rank = static_cast<size_t>(std::min(std::max(p, 0.0), 1.0) * static_cast<double>(samples.size() - 1) + 0.5);
+        std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+        return samples[rank];
+    }
+
+private:
+    size_t window;              ///< Number of samples kept for percentiles
+    std::vector<double> recent; ///< Ring buffer of the last samples
+    size_t next = 0;            ///< Slot overwritten by the next sample once full
+    uint64_t total = 0;         ///< Number of samples
+    double sum = 0;             ///< Sum of all samples
+    double maximum = 0;         ///< Largest sample
+    mutable std::mutex mutex;   ///< Guards every member
+};
+
+#endif // LATENCY_RECORDER_HPP
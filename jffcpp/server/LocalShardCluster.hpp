@@ -0,0 +1,247 @@
+#ifndef LOCAL_SHARD_CLUSTER_HPP
+#define LOCAL_SHARD_CLUSTER_HPP
+
+#include <vector>
+#include <string>
+#include <iostream>  // For std::cout, std::cerr
+#include <thread>    // For std::this_thread::sleep_for
+#include <chrono>    // For std::chrono::steady_clock
+#include <stdexcept> // For std::runtime_error
+#include "SearchServer.hpp"
+#include "SearchClient.hpp"
+#include "ShardRouter.hpp"
+#include "../data/Persistence.hpp"
+
+#ifndef _WIN32
+#include <sys/types.h> // For pid_t
+#include <sys/wait.h>  // For waitpid
+#include <signal.h>    // For kill, SIGKILL, SIGSTOP, SIGCONT
+#include <unistd.h>    // For fork, pause, _exit, getpid, unlink
+#endif
+
+/**
+ * @brief Runs shard servers as child processes on this machine, to test a ShardRouter end to end.
+ *
+ * Each shard is a file holding a gallery and its searcher (as saved by saveLoadIndex.cpp, e.g.
+ * one per gallery returned by splitGallery). start() forks one process per shard, which loads its
+ * file, serves it on a Unix domain socket and runs until it is killed. Shards can be killed,
+ * paused (SIGSTOP, so they accept connections but never answer) and resumed to exercise the
+ * partial results and timeouts of the router.
+ *
+ * Only POSIX systems are supported. start() forks, so it must be called before the calling
+ * process starts threads of its own (a forked child only keeps the forking thread).
+ */
+class LocalShardCluster
+{
+public:
+    LocalShardCluster() = default;
+
+    LocalShardCluster(const LocalShardCluster &) = delete;
+    LocalShardCluster &operator=(const LocalShardCluster &) = delete;
+
+    ~LocalShardCluster()
+    {
+        stop();
+    }
+
+    /**
+     * @brief Starts one server process per shard file and waits until every one answers Health.
+     *
+     * @tparam Searcher The searcher type saved in the files (a SequentialSearcher of ParentedFeature).
+     * @param shardFiles One file per shard holding a gallery and its searcher.
+     * @param distance The distance of the searchers.
+     * @param options Options of every shard server.
+     * @param readyTimeout Time given to each shard to load its file.
+     * @throws std::runtime_error if a shard exits or does not answer in time.
+     */
+    template <typename Searcher, typename DistanceFunc>
+    void start(const std::vector<std::string> &shardFiles, DistanceFunc &distance, const ServerOptions &options = ServerOptions(),
+               std::chrono::milliseconds readyTimeout = std::chrono::milliseconds(60000))
+    {
+#ifndef _WIN32
+        if (!shards.empty())
+            throw std::logic_error("The cluster is already running");
+
+        for (size_t i = 0; i < shardFiles.size(); ++i)
+        {
+            Shard shard;
+            shard.path = "/tmp/jff-shard-" + std::to_string(::getpid()) + "-" + std::to_string(i) + ".sock";
+
+            // Buffered output would be written again by the child
+            std::cout.flush();
+            std::cerr.flush();
+            shard.pid = ::fork();
+            if (shard.pid < 0)
+            {
+                stop();
+                throw std::runtime_error("Could not fork a shard process");
+            }
+            if (shard.pid == 0)
+                serve<Searcher>(shardFiles[i], shard.path, distance, options);
+            shards.push_back(shard);
+        }
+
+        for (size_t i = 0; i < shards.size(); ++i)
+        {
+            waitReady(i, readyTimeout);
+        }
+#else
+        (void)shardFiles;
+        (void)distance;
+        (void)options;
+        (void)readyTimeout;
+        throw std::runtime_error("LocalShardCluster is only implemented on POSIX systems");
+#endif
+    }
+
+    /**
+     * @brief Returns the endpoint of every shard, in file order.
+     */
+    std::vector<ShardEndpoint> endpoints() const
+    {
+        std::vector<ShardEndpoint> result;
+        for (const auto &shard : shards)
+        {
+            result.push_back(ShardEndpoint::unixSocket(shard.path));
+        }
+        return result;
+    }
+
+    size_t size() const
+    {
+        return shards.size();
+    }
+
+    /**
+     * @brief Kills a shard, as if its machine went down.
+     */
+    void kill(size_t i)
+    {
+#ifndef _WIN32
+        Shard &shard = shards.at(i);
+        if (shard.pid > 0)
+        {
+            ::kill(shard.pid, SIGKILL);
+            ::waitpid(shard.pid, nullptr, 0);
+            ::unlink(shard.path.c_str());
+            shard.pid = -1;
+        }
+#else
+        (void)i;
+#endif
+    }
+
+    /**
+     * @brief Freezes a shard: it keeps accepting connections but answers nothing until resume().
+     */
+    void pause(size_t i)
+    {
+#ifndef _WIN32
+        if (shards.at(i).pid > 0)
+            ::kill(shards[i].pid, SIGSTOP);
+#else
+        (void)i;
+#endif
+    }
+
+    /**
+     * @brief Resumes a paused shard; the requests it received meanwhile are answered.
+     */
+    void resume(size_t i)
+    {
+#ifndef _WIN32
+        if (shards.at(i).pid > 0)
+            ::kill(shards[i].pid, SIGCONT);
+#else
+        (void)i;
+#endif
+    }
+
+    /**
+     * @brief Kills every shard.
+     */
+    void stop()
+    {
+        for (size_t i = 0; i < shards.size(); ++i)
+        {
+            kill(i);
+        }
+        shards.clear();
+    }
+
+private:
+    struct Shard
+    {
+        int pid = -1;     ///< Process ID (-1 once killed)
+        std::string path; ///< Unix socket the shard listens on
+    };
+
+#ifndef _WIN32
+    /**
+     * @brief Body of a shard process: loads the file and serves it until killed.
+     */
+    template <typename Searcher, typename DistanceFunc>
+    [[noreturn]] static void serve(const std::string &file, const std::string &path, DistanceFunc &distance, const ServerOptions &options)
+    {
+        try
+        {
+            BinaryReader reader(file);
+            Gallery<ParentedFeature> gallery;
+            gallery.load(reader);
+
+            Searcher searcher(distance);
+            searcher.load(reader, gallery.resolver());
+
+            SearchServer<Searcher> server(gallery, searcher, options);
+            server.listenUnix(path);
+            while (true)
+            {
+                ::pause();
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Shard " << file << ": " << e.what() << std::endl;
+        }
+        ::_exit(1);
+    }
+
+    /**
+     * @brief Polls a shard with Health requests until it answers.
+     */
+    void waitReady(size_t i, std::chrono::milliseconds readyTimeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + readyTimeout;
+        while (true)
+        {
+            if (::waitpid(shards[i].pid, nullptr, WNOHANG) == shards[i].pid)
+            {
+                shards[i].pid = -1;
+                stop();
+                throw std::runtime_error("Shard " + std::to_string(i) + " exited while starting");
+            }
+            try
+            {
+                SearchClient client = SearchClient::connectUnix(shards[i].path);
+                client.setTimeout(1000);
+                if (client.health())
+                    return;
+            }
+            catch (const std::exception &)
+            {
+                // Not listening yet
+            }
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                stop();
+                throw std::runtime_error("Shard " + std::to_string(i) + " did not start in time");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+#endif
+
+    std::vector<Shard> shards; ///< Running shards, in file order
+};
+
+#endif // LOCAL_SHARD_CLUSTER_HPP
@@ -0,0 +1,463 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <vector>
+#include <string>
+#include <cstring>   // For std::memcpy
+#include <cstdint>   // For uint32_t
+#include <stdexcept> // For std::runtime_error
+
+/**
+ * @brief Binary protocol of the search server.
+ *
+ * Every message is a 16-byte header followed by its payload, all little-endian as in memory:
+ *
+ *     uint32 magic | uint16 version | uint16 type | uint32 request ID | uint32 payload size
+ *
+ * A Search payload is: uint32 k (neighbors per minutia), uint32 nBest, uint8 method
+ * (see VoteMethod), uint8 format (see QueryFormat), uint8 priority (see Priority), then the query. A .tpt query is the file
+ * content as a string; a matrix query is uint32 rows, uint32 dimension and rows x dimension floats.
+ * The Result payload is uint32 count, then per Individual: uint32 ID, float64 score, string name.
+ * A Neighbors request has the Search payload and returns the raw neighbor lists instead of votes
+ * (see NeighborLists), so that a router can merge the lists of several shards.
+ * Strings are a uint32 length followed by the bytes. Health and Stats requests have no payload.
+ */
+namespace Protocol
+{
+    constexpr uint32_t magic = 0x5146464A; ///< "JFFQ"
+    constexpr uint16_t version = 2;
+    constexpr uint32_t maxPayload = 64u << 20; ///< Largest accepted payload (64 MiB)
+
+    /**
+     * @brief Message types. Responses reuse the type of their request, or Error.
+     */
+    enum class MessageType : uint16_t
+    {
+        Search = 1,
+        Health = 2,
+        Stats = 3,
+        Neighbors = 4,
+        Error = 255
+    };
+
+    /**
+     * @brief Voting policy of a Search (see DynamicNNResult).
+     */
+    enum class VoteMethod : uint8_t
+    {
+        Frequency = 0,
+        Distance = 1,
+        Weighted = 2
+    };
+
+    /**
+     * @brief Encoding of the query minutiae of a Search.
+     */
+    enum class QueryFormat : uint8_t
+    {
+        Tpt = 0,   ///< Content of a .tpt file
+        Matrix = 1 ///< Raw descriptor matrix
+    };
+
+    /**
+     * @brief Scheduling class of a Search.
+     */
+    enum class Priority : uint8_t
+    {
+        Interactive = 0, ///< One-off searches, answered first
+        Bulk = 1         ///< Background re-matching, run in preemptible chunks
+    };
+
+    /**
+     * @brief Header of every message.
+     */
+    struct Header
+    {
+        uint32_t magic = Protocol::magic;
+        uint16_t version = Protocol::version;
+        uint16_t type = 0;
+        uint32_t requestId = 0;
+        uint32_t payloadSize = 0;
+    };
+    static_assert(sizeof(Header) == 16, "The protocol header must be 16 bytes");
+
+    /**
+     * @brief Returns the name of a voting method, as accepted by DynamicNNResult.
+     */
+    inline std::string methodName(VoteMethod method)
+    {
+        switch (method)
+        {
+        case VoteMethod::Frequency:
+            return "frequency";
+        case VoteMethod::Distance:
+            return "distance";
+        case VoteMethod::Weighted:
+            return "weighted";
+        }
+        throw std::runtime_error("Unknown vote method " + std::to_string(static_cast<int>(method)));
+    }
+
+    /**
+     * @brief Appends values to a payload.
+     */
+    class PayloadWriter
+    {
+    public:
+        template <typename T>
+        void write(const T &value)
+        {
+            writeArray(&value, 1);
+        }
+
+        template <typename T>
+        void writeArray(const T *values, size_t count)
+        {
+            const char *bytes = reinterpret_cast<const char *>(values);
+            buffer.insert(buffer.end(), bytes, bytes + count * sizeof(T));
+        }
+
+        void writeString(const std::string &value)
+        {
+            write(uint32_t(value.size()));
+            buffer.insert(buffer.end(), value.begin(), value.end());
+        }
+
+        const std::vector<char> &data() const
+        {
+            return buffer;
+        }
+
+    private:
+        std::vector<char> buffer; ///< Encoded payload
+    };
+
+    /**
+     * @brief Reads values from a received payload, checking its bounds.
+     */
+    class PayloadReader
+    {
+    public:
+        PayloadReader(const char *data, size_t size) : data(data), size(size), offset(0) {}
+
+        template <typename T>
+        T read()
+        {
+            T value;
+            readArray(&value, 1);
+            return value;
+        }
+
+        template <typename T>
+        void readArray(T *out, size_t count)
+        {
+            if (count > (size - offset) / sizeof(T))
+                throw std::runtime_error("Truncated payload");
+            std::memcpy(out, data + offset, count * sizeof(T));
+            offset += count * sizeof(T);
+        }
+
+        /**
+         * @brief Reads an element count, checking that the payload can hold count elements of minSize bytes.
+         */
+        uint32_t readCount(size_t minSize)
+        {
+            uint32_t count = read<uint32_t>();
+            if (count > (size - offset) / minSize)
+                throw std::runtime_error("Truncated payload");
+            return count;
+        }
+
+        /**
+         * @brief Returns the number of bytes left to read.
+         */
+        size_t remaining() const
+        {
+            return size - offset;
+        }
+
+        std::string readString()
+        {
+            uint32_t length = read<uint32_t>();
+            if (length > size - offset)
+                throw std::runtime_error("Truncated payload");
+            std::string value(data + offset, length);
+            offset += length;
+            return value;
+        }
+
+    private:
+        const char *data; ///< Payload bytes
+        size_t size;      ///< Payload size
+        size_t offset;    ///< Next byte to read
+    };
+
+    /**
+     * @brief Decoded Search request.
+     */
+    struct SearchRequest
+    {
+        uint32_t k = 5;                            ///< Neighbors per query minutia
+        uint32_t nBest = 10;                       ///< Individuals returned
+        VoteMethod method = VoteMethod::Frequency; ///< Voting policy
+        QueryFormat format = QueryFormat::Matrix;  ///< Encoding of the query
+        Priority priority = Priority::Interactive; ///< Scheduling class
+        std::string tpt;                           ///< .tpt content (Tpt format)
+        uint32_t rows = 0;                         ///< Number of descriptors (Matrix format)
+        uint32_t dimension = 0;                    ///< Descriptor dimension (Matrix format)
+        std::vector<float> values;                 ///< rows x dimension descriptors (Matrix format)
+
+        void encode(PayloadWriter &writer) const
+        {
+            writer.write(k);
+            writer.write(nBest);
+            writer.write(static_cast<uint8_t>(method));
+            writer.write(static_cast<uint8_t>(format));
+            writer.write(static_cast<uint8_t>(priority));
+            if (format == QueryFormat::Tpt)
+            {
+                writer.writeString(tpt);
+                return;
+            }
+            writer.write(rows);
+            writer.write(dimension);
+            writer.writeArray(values.data(), values.size());
+        }
+
+        static SearchRequest decode(PayloadReader &reader)
+        {
+            SearchRequest request;
+            request.k = reader.read<uint32_t>();
+            request.nBest = reader.read<uint32_t>();
+            request.method = static_cast<VoteMethod>(reader.read<uint8_t>());
+            request.format = static_cast<QueryFormat>(reader.read<uint8_t>());
+            request.priority = static_cast<Priority>(reader.read<uint8_t>());
+            if (request.priority != Priority::Interactive && request.priority != Priority::Bulk)
+                throw std::runtime_error("Unknown priority " + std::to_string(static_cast<int>(request.priority)));
+            if (request.format == QueryFormat::Tpt)
+            {
+                request.tpt = reader.readString();
+            }
+            else if (request.format == QueryFormat::Matrix)
+            {
+                request.rows = reader.read<uint32_t>();
+                request.dimension = reader.read<uint32_t>();
+                if (request.dimension == 0)
+                    throw std::runtime_error("Query dimension must be positive");
+                if (request.rows > reader.remaining() / sizeof(float) / request.dimension)
+                    throw std::runtime_error("Truncated payload");
+                request.values.resize(static_cast<size_t>(request.rows) * request.dimension);
+                reader.readArray(request.values.data(), request.values.size());
+            }
+            else
+            {
+                throw std::runtime_error("Unknown query format " + std::to_string(static_cast<int>(request.format)));
+            }
+            return request;
+        }
+    };
+
+    /**
+     * @brief One Individual of a Result.
+     */
+    struct Candidate
+    {
+        uint32_t id = 0;  ///< Individual ID
+        double score = 0; ///< Score under the requested voting method
+        std::string name; ///< Name of the Individual
+    };
+
+    /**
+     * @brief Encodes the payload of a Result.
+     */
+    inline void encodeCandidates(PayloadWriter &writer, const std::vector<Candidate> &candidates)
+    {
+        writer.write(uint32_t(candidates.size()));
+        for (const auto &candidate : candidates)
+        {
+            writer.write(candidate.id);
+            writer.write(candidate.score);
+            writer.writeString(candidate.name);
+        }
+    }
+
+    /**
+     * @brief Decodes the payload of a Result.
+     */
+    inline std::vector<Candidate> decodeCandidates(PayloadReader &reader)
+    {
+        std::vector<Candidate> candidates(reader.readCount(2 * sizeof(uint32_t) + sizeof(double)));
+        for (auto &candidate : candidates)
+        {
+            candidate.id = reader.read<uint32_t>();
+            candidate.score = reader.read<double>();
+            candidate.name = reader.readString();
+        }
+        return candidates;
+    }
+
+    /**
+     * @brief One neighbor of a query minutia.
+     */
+    struct Neighbor
+    {
+        uint32_t id = 0;     ///< ID of the Individual owning the neighbor
+        double distance = 0; ///< Distance to the query minutia
+    };
+
+    /**
+     * @brief Payload of a Neighbors response.
+     *
+     * Encoded as uint32 rows, then per row uint32 count and count x (uint32 ID, float64 distance),
+     * then uint32 count and count x (uint32 ID, string name) for the Individuals that appear.
+     */
+    struct NeighborLists
+    {
+        std::vector<std::vector<Neighbor>> rows;             ///< Neighbors of each query minutia, nearest first
+        std::vector<std::pair<uint32_t, std::string>> names; ///< Name of every Individual in rows
+
+        void encode(PayloadWriter &writer) const
+        {
+            writer.write(uint32_t(rows.size()));
+            for (const auto &row : rows)
+            {
+                writer.write(uint32_t(row.size()));
+                for (const auto &neighbor : row)
+                {
+                    writer.write(neighbor.id);
+                    writer.write(neighbor.distance);
+                }
+            }
+            writer.write(uint32_t(names.size()));
+            for (const auto &name : names)
+            {
+                writer.write(name.first);
+                writer.writeString(name.second);
+            }
+        }
+
+        static NeighborLists decode(PayloadReader &reader)
+        {
+            NeighborLists lists;
+            lists.rows.resize(reader.readCount(sizeof(uint32_t)));
+            for (auto &row : lists.rows)
+            {
+                row.resize(reader.readCount(sizeof(uint32_t) + sizeof(double)));
+                for (auto &neighbor : row)
+                {
+                    neighbor.id = reader.read<uint32_t>();
+                    neighbor.distance = reader.read<double>();
+                }
+            }
+            lists.names.resize(reader.readCount(2 * sizeof(uint32_t)));
+            for (auto &name : lists.names)
+            {
+                name.first = reader.read<uint32_t>();
+                name.second = reader.readString();
+            }
+            return lists;
+        }
+    };
+
+    /**
+     * @brief Counters of one scheduling class.
+     */
+    struct ClassStats
+    {
+        uint64_t searches = 0;    ///< Searches answered
+        uint64_t queueDepth = 0;  ///< Searches waiting (or, for bulk, started and waiting for their next chunk)
+        double busyMs = 0;        ///< Worker time spent on the class
+        double meanLatencyMs = 0; ///< Mean time from arrival to response
+        double p50LatencyMs = 0;  ///< Median time from arrival to response (recent searches)
+        double p99LatencyMs = 0;  ///< 99th percentile time from arrival to response (recent searches)
+        double maxLatencyMs = 0;  ///< Largest time from arrival to response
+
+        void encode(PayloadWriter &writer) const
+        {
+            writer.write(searches);
+            writer.write(queueDepth);
+            writer.write(busyMs);
+            writer.write(meanLatencyMs);
+            writer.write(p50LatencyMs);
+            writer.write(p99LatencyMs);
+            writer.write(maxLatencyMs);
+        }
+
+        static ClassStats decode(PayloadReader &reader)
+        {
+            ClassStats stats;
+            stats.searches = reader.read<uint64_t>();
+            stats.queueDepth = reader.read<uint64_t>();
+            stats.busyMs = reader.read<double>();
+            stats.meanLatencyMs = reader.read<double>();
+            stats.p50LatencyMs = reader.read<double>();
+            stats.p99LatencyMs = reader.read<double>();
+            stats.maxLatencyMs = reader.read<double>();
+            return stats;
+        }
+    };
+
+    /**
+     * @brief Counters reported by the Stats endpoint.
+     */
+    struct ServerStats
+    {
+        uint64_t uptimeMs = 0;          ///< Time since the server started
+        uint64_t searches = 0;          ///< Searches answered (both classes)
+        uint64_t errors = 0;            ///< Requests answered with an Error
+        uint64_t rejected = 0;          ///< Searches refused because their queue was full
+        uint64_t activeConnections = 0; ///< Open client connections
+        uint64_t workers = 0;           ///< Size of the worker pool
+        uint64_t individuals = 0;       ///< Individuals in the gallery
+        uint64_t features = 0;          ///< Features in the gallery
+        uint64_t batches = 0;           ///< Batched gallery passes run for interactive searches
+        double meanBatchRequests = 0;   ///< Searches per interactive batch
+        double meanBatchRows = 0;       ///< Query minutiae per interactive batch
+        uint64_t bulkChunks = 0;        ///< Gallery chunks scanned for bulk searches
+        double throughput = 0;          ///< Searches answered per second since the start
+        ClassStats interactive;         ///< Interactive searches
+        ClassStats bulk;                ///< Bulk searches
+
+        void encode(PayloadWriter &writer) const
+        {
+            writer.write(uptimeMs);
+            writer.write(searches);
+            writer.write(errors);
+            writer.write(rejected);
+            writer.write(activeConnections);
+            writer.write(workers);
+            writer.write(individuals);
+            writer.write(features);
+            writer.write(batches);
+            writer.write(meanBatchRequests);
+            writer.write(meanBatchRows);
+            writer.write(bulkChunks);
+            writer.write(throughput);
+            interactive.encode(writer);
+            bulk.encode(writer);
+        }
+
+        static ServerStats decode(PayloadReader &reader)
+        {
+            ServerStats stats;
+            stats.uptimeMs = reader.read<uint64_t>();
+            stats.searches = reader.read<uint64_t>();
+            stats.errors = reader.read<uint64_t>();
+            stats.rejected = reader.read<uint64_t>();
+            stats.activeConnections = reader.read<uint64_t>();
+            stats.workers = reader.read<uint64_t>();
+            stats.individuals = reader.read<uint64_t>();
+            stats.features = reader.read<uint64_t>();
+            stats.batches = reader.read<uint64_t>();
+            stats.meanBatchRequests = reader.read<double>();
+            stats.meanBatchRows = reader.read<double>();
+            stats.bulkChunks = reader.read<uint64_t>();
+            stats.throughput = reader.read<double>();
+            stats.interactive = ClassStats::decode(reader);
+            stats.bulk = ClassStats::decode(reader);
+            return stats;
+        }
+    };
+} // namespace Protocol
+
+#endif // PROTOCOL_HPP
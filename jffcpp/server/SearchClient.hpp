@@ -0,0 +1,134 @@
+#ifndef SEARCH_CLIENT_HPP
+#define SEARCH_CLIENT_HPP
+
+#include <vector>
+#include <string>
+#include <stdexcept> // For std::runtime_error
+#include "Protocol.hpp"
+#include "Socket.hpp"
+
+/**
+ * @brief Blocking client of a SearchServer.
+ *
+ * Sends one request at a time and waits for its response. Use one client per thread.
+ */
+class SearchClient
+{
+public:
+    /**
+     * @brief Connects to a server listening on a Unix domain socket.
+     */
+    static SearchClient connectUnix(const std::string &path)
+    {
+        return SearchClient(Socket::connectUnix(path));
+    }
+
+    /**
+     * @brief Connects to a server listening on TCP.
+     */
+    static SearchClient connectTcp(const std::string &host, uint16_t port)
+    {
+        return SearchClient(Socket::connectTcp(host, port));
+    }
+
+    explicit SearchClient(Socket socket) : socket(std::move(socket)), nextRequestId(1) {}
+
+    /**
+     * @brief Sets the time to wait for a response (0 waits forever).
+     */
+    void setTimeout(int milliseconds)
+    {
+        socket.setTimeout(milliseconds);
+    }
+
+    /**
+     * @brief Searches the gallery.
+     *
+     * @return std::vector<Protocol::Candidate> The best Individuals, best first.
+     * @throws std::runtime_error with the server message if the search failed.
+     */
+    std::vector<Protocol::Candidate> search(const Protocol::SearchRequest &request)
+    {
+        Protocol::PayloadWriter writer;
+        request.encode(writer);
+        std::vector<char> payload = call(Protocol::MessageType::Search, writer.data());
+        Protocol::PayloadReader reader(payload.data(), payload.size());
+        return Protocol::decodeCandidates(reader);
+    }
+
+    /**
+     * @brief Searches with the descriptors of a query, one row per minutia.
+     */
+    std::vector<Protocol::Candidate> search(const std::vector<std::vector<float>> &descriptors, uint32_t k = 5, uint32_t nBest = 10,
+                                            Protocol::VoteMethod method = Protocol::VoteMethod::Frequency)
+    {
+        Protocol::SearchRequest request;
+        request.k = k;
+        request.nBest = nBest;
+        request.method = method;
+        request.format = Protocol::QueryFormat::Matrix;
+        request.rows = static_cast<uint32_t>(descriptors.size());
+        request.dimension = descriptors.empty() ? 0 : static_cast<uint32_t>(descriptors[0].size());
+        for (const auto &row : descriptors)
+        {
+            if (row.size() != request.dimension)
+                throw std::invalid_argument("All descriptors must have the same dimension");
+            request.values.insert(request.values.end(), row.begin(), row.end());
+        }
+        return search(request);
+    }
+
+    /**
+     * @brief Returns true if the server answers.
+     */
+    bool health()
+    {
+        try
+        {
+            return !call(Protocol::MessageType::Health, {}).empty();
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    }
+
+    /**
+     * @brief Returns the counters of the server.
+     */
+    Protocol::ServerStats stats()
+    {
+        std::vector<char> payload = call(Protocol::MessageType::Stats, {});
+        Protocol::PayloadReader reader(payload.data(), payload.size());
+        return Protocol::ServerStats::decode(reader);
+    }
+
+private:
+    /**
+     * @brief Sends a request and returns the payload of its response.
+     */
+    std::vector<char> call(Protocol::MessageType type, const std::vector<char> &payload)
+    {
+        uint32_t requestId = nextRequestId++;
+        if (!sendMessage(socket, type, requestId, payload))
+            throw std::runtime_error("Connection to the search server lost");
+
+        Protocol::Header header;
+        std::vector<char> response;
+        if (!receiveMessage(socket, header, response))
+            throw std::runtime_error("No response from the search server");
+        if (header.requestId != requestId)
+            throw std::runtime_error("Response does not match the request");
+        if (header.type == static_cast<uint16_t>(Protocol::MessageType::Error))
+        {
+            Protocol::PayloadReader reader(response.data(), response.size());
+            throw std::runtime_error("Search server error: " + reader.readString());
+        }
+        return response;
+    }
+
+    Socket socket;          ///< Connection to the server
+    uint32_t nextRequestId; ///< ID of the next request
+};
+
+#endif // SEARCH_CLIENT_HPP
@@ -0,0 +1,820 @@
+#ifndef SEARCH_SERVER_HPP
+#define SEARCH_SERVER_HPP
+
+#include <vector>
+#include <deque>
+#include <list>
+#include <memory>             // For std::shared_ptr, std::unique_ptr
+#include <string>
+#include <sstream>            // For std::istringstream
+#include <thread>             // For std::thread
+#include <mutex>              // For std::mutex, std::lock_guard
+#include <condition_variable> // For std::condition_variable
+#include <atomic>             // For std::atomic
+#include <chrono>             // For std::chrono::steady_clock
+#include <algorithm>          // For std::max, std::count
+#include <iterator>           // For std::make_move_iterator
+#include <unordered_map>      // For std::unordered_map
+#include "Protocol.hpp"
+#include "Socket.hpp"
+#include "LatencyRecorder.hpp"
+#include "../data/Gallery.hpp"
+#include "../data/loaders.hpp"
+#include "../indexing/NNResults.hpp"
+#include "../concurrency/EpochManager.hpp"
+
+/**
+ * @brief Settings of a SearchServer.
+ */
+struct ServerOptions
+{
+    unsigned workers = 0;                         ///< Threads running searches (0 means hardware concurrency)
+    size_t maxQueue = 1024;                       ///< Searches waiting beyond this are refused with an Error
+    size_t maxConnections = 256;                  ///< Further connections are closed right away
+    uint32_t maxK = 100;                          ///< Largest neighbors per minutia accepted
+    uint32_t maxBest = 1000;                      ///< Largest number of Individuals returned
+    uint32_t dimension = 0;                       ///< Expected descriptor dimension (0 takes it from the gallery means)
+    size_t maxBatchRows = 1024;                   ///< Query minutiae searched in one gallery pass (1 disables batching)
+    std::chrono::microseconds maxBatchWait{2000}; ///< Longest a worker waits for more searches to fill a batch
+    size_t maxBulkQueue = 4096;                   ///< Bulk searches waiting beyond this are refused with an Error
+    unsigned maxBulkWorkers = 0;                  ///< Workers running bulk chunks at once (0 means all but one)
+    size_t bulkChunkDistances = 1 << 18;          ///< Distances computed by a bulk chunk before its worker looks for interactive work
+    double bulkShare = 0.1;                       ///< Share of the worker time given to bulk work while interactive searches wait
+};
+
+/**
+ * @brief Long-running search service over a gallery loaded once.
+ *
+ * Clients connect over a Unix domain socket or localhost TCP and exchange Protocol messages.
+ * Each connection has a reader thread that decodes requests: Health and Stats are answered at
+ * once, so they stay responsive under load, and Search requests are queued for a fixed pool of
+ * workers. A worker runs knn for every query minutia, votes like NNResult and writes the response
+ * on the connection; several requests of one connection may be in flight and are matched by
+ * their request ID.
+ *
+ * Concurrent searches are micro-batched: a worker takes every queued search that fits in
+ * maxBatchRows query minutiae, waits up to maxBatchWait for more while the batch is not full, and
+ * runs them all in one knnBatch() pass over the gallery. Larger batches stream the gallery fewer
+ * times (more throughput) but hold the first search of a batch longer; stats() reports the
+ * throughput and the p50/p99 latencies to tune the trade-off.
+ *
+ * A Neighbors request runs like a Search but is answered with the neighbor lists of every query
+ * minutia instead of votes, for a ShardRouter to merge across shards.
+ *
+ * Searches have a Priority. Interactive searches run as above. Bulk searches are batched too, but
+ * their gallery pass is a BatchScan split into chunks of about bulkChunkDistances distances; after
+ * each chunk the worker goes back to the scheduler, so an interactive search waits at most one
+ * chunk. At most maxBulkWorkers workers run bulk chunks, leaving by default one worker for
+ * interactive searches. While both classes have work, workers pick bulk chunks only while bulk
+ * has received less than bulkShare of the worker time spent under contention, so bulk work is
+ * slowed down but never starved. stats() reports the queue depth, busy time and latencies of each class.
+ *
+ * The gallery and the searcher are only read, so they may be shared with other threads and
+ * updated through the Gallery (enroll, retire, compact) while the server runs.
+ *
+ * @tparam Searcher A SequentialSearcher of ParentedFeature (or a derived searcher): knnBatch() and BatchScan are used.
+ */
+template <typename Searcher>
+class SearchServer
+{
+public:
+    using feature = ParentedFeature;
+
+    /**
+     * @brief Constructs a stopped server.
+     *
+     * @param gallery The gallery, used for Individual names and sizes.
+     * @param searcher The searcher answering the queries.
+     * @param options The server settings.
+     */
+    SearchServer(const Gallery<feature> &gallery, const Searcher &searcher, ServerOptions options = ServerOptions())
+        : gallery(gallery), searcher(searcher), options(options), running(false)
+    {
+        for (const auto &individual : gallery.getIndividuals())
+        {
+            if (this->options.dimension != 0)
+                break;
+            this->options.dimension = static_cast<uint32_t>(individual->mean.size());
+        }
+    }
+
+    ~SearchServer()
+    {
+        stop();
+    }
+
+    SearchServer(const SearchServer &) = delete;
+    SearchServer &operator=(const SearchServer &) = delete;
+
+    /**
+     * @brief Starts serving on a Unix domain socket.
+     */
+    void listenUnix(const std::string &path)
+    {
+        start(Socket::listenUnix(path));
+    }
+
+    /**
+     * @brief Starts serving on a TCP port (localhost by default); returns the bound port.
+     */
+    uint16_t listenTcp(uint16_t port, const std::string &host = "127.0.0.1")
+    {
+        Socket socket = Socket::listenTcp(port, host);
+        uint16_t bound = socket.localPort();
+        start(std::move(socket));
+        return bound;
+    }
+
+    /**
+     * @brief Starts the acceptor and the worker pool on a listening socket.
+     */
+    void start(Socket socket)
+    {
+        if (running.exchange(true))
+            throw std::logic_error("The server is already running");
+
+        listener = std::move(socket);
+        startTime = std::chrono::steady_clock::now();
+        unsigned nWorkers = options.workers != 0 ? options.workers : std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < nWorkers; ++i)
+        {
+            workers.emplace_back(&SearchServer::workerLoop, this);
+        }
+        acceptor = std::thread(&SearchServer::acceptLoop, this);
+    }
+
+    /**
+     * @brief Stops accepting, closes the connections and joins every thread. Queued searches are dropped.
+     */
+    void stop()
+    {
+        if (!running.exchange(false))
+            return;
+
+        listener.shutdown();
+        acceptor.join();
+        listener.close();
+
+        {
+            std::lock_guard<std::mutex> lock(connectionMutex);
+            for (auto &connection : connections)
+            {
+                connection->socket.shutdown();
+            }
+        }
+        for (auto &connection : connections)
+        {
+            connection->reader.join();
+        }
+        connections.clear();
+
+        // A worker may have seen running before the exchange and not be waiting yet: taking the
+        // lock makes it block first, so the notification cannot be lost
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+        }
+        queueReady.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        workers.clear();
+        queue.clear();
+        bulkQueue.clear();
+        bulkTasks.clear();
+    }
+
+    /**
+     * @brief Returns the current counters, as sent by the Stats endpoint.
+     */
+    Protocol::ServerStats stats() const
+    {
+        Protocol::ServerStats result;
+        result.uptimeMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count());
+        result.errors = errors;
+        result.rejected = rejected;
+        result.activeConnections = activeConnections;
+        result.workers = workers.size();
+        result.individuals = gallery.size();
+        result.features = gallery.numFeatures();
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            result.interactive.queueDepth = queue.size();
+            result.interactive.busyMs = busyMs[0];
+            result.bulk.queueDepth = bulkQueue.size() + bulkTasks.size();
+            result.bulk.busyMs = busyMs[1];
+        }
+        classStats(interactiveLatencies, result.interactive);
+        classStats(bulkLatencies, result.bulk);
+        result.searches = result.interactive.searches + result.bulk.searches;
+        result.bulkChunks = bulkChunks;
+        result.batches = batches;
+        if (result.batches > 0)
+        {
+            result.meanBatchRequests = batchedRequests / static_cast<double>(result.batches);
+            result.meanBatchRows = batchedRows / static_cast<double>(result.batches);
+        }
+        if (result.uptimeMs > 0)
+            result.throughput = result.searches * 1000.0 / static_cast<double>(result.uptimeMs);
+        return result;
+    }
+
+    /**
+     * @brief Runs one search in the calling thread, without batching.
+     *
+     * @param request The decoded request.
+     * @return std::vector<Protocol::Candidate> The best Individuals, best first.
+     */
+    std::vector<Protocol::Candidate> search(const Protocol::SearchRequest &request) const
+    {
+        std::vector<feature> queries = parseQueries(request);
+
+        // Neighbors point to Individuals that a concurrent compaction may release
+        EpochManager::Guard guard(EpochManager::global());
+        std::vector<NNList<feature>> lists = searcher.knnBatch(queries, request.k, SearchFilter());
+        return rank(request, lists.begin(), lists.end());
+    }
+
+private:
+    /**
+     * @brief An accepted client and its reader thread.
+     */
+    struct Connection
+    {
+        Socket socket;                 ///< The client socket
+        std::mutex writeMutex;         ///< Serializes responses
+        std::thread reader;            ///< Decodes the requests
+        std::atomic<bool> done{false}; ///< Set when the reader exits
+    };
+
+    /**
+     * @brief A queued search.
+     */
+    struct Job
+    {
+        std::shared_ptr<Connection> connection;        ///< Where to answer
+        uint32_t requestId = 0;                        ///< ID echoed in the response
+        Protocol::SearchRequest request;               ///< The decoded request
+        size_t rows = 0;                               ///< Query minutiae (estimated from the lines of a .tpt)
+        std::chrono::steady_clock::time_point arrival; ///< When the request was read
+        Protocol::MessageType type{};                  ///< Search, or Neighbors to answer with the neighbor lists
+    };
+
+    /**
+     * @brief Bulk searches scanned together, one chunk at a time.
+     */
+    struct BulkTask
+    {
+        std::vector<Job> jobs;                              ///< Searches of the task
+        std::vector<size_t> ends;                           ///< End of the lists of each search
+        size_t chunkObjects = 1;                            ///< Objects scanned per chunk
+        std::unique_ptr<typename Searcher::BatchScan> scan; ///< Resumable gallery pass
+    };
+
+    /**
+     * @brief What a worker runs next: a batch of interactive searches, a bulk task to start, or a bulk chunk.
+     */
+    struct Work
+    {
+        std::vector<Job> batch;         ///< Interactive searches, or bulk searches to start
+        std::shared_ptr<BulkTask> task; ///< Started bulk task to advance
+        bool bulk = false;              ///< True for bulk work
+        bool contended = false;         ///< Both classes had work when this was picked
+    };
+
+    /**
+     * @brief Accepts connections until the listener is shut down, reaping finished ones.
+     */
+    void acceptLoop()
+    {
+        while (running)
+        {
+            Socket client = listener.accept();
+            if (!client.valid())
+                break;
+
+            std::lock_guard<std::mutex> lock(connectionMutex);
+            for (auto it = connections.begin(); it != connections.end();)
+            {
+                if ((*it)->done)
+                {
+                    (*it)->reader.join();
+                    it = connections.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            if (!running || connections.size() >= options.maxConnections)
+                continue; // Closes the client
+
+            auto connection = std::make_shared<Connection>();
+            connection->socket = std::move(client);
+            ++activeConnections;
+            connection->reader = std::thread(&SearchServer::readLoop, this, connection);
+            connections.push_back(std::move(connection));
+        }
+    }
+
+    /**
+     * @brief Reads the requests of one connection until it closes.
+     */
+    void readLoop(std::shared_ptr<Connection> connection)
+    {
+        Protocol::Header header;
+        std::vector<char> payload;
+        while (running)
+        {
+            try
+            {
+                if (!receiveMessage(connection->socket, header, payload))
+                    break;
+            }
+            catch (const std::exception &)
+            {
+                break; // Not a protocol stream: drop the connection
+            }
+
+            auto type = static_cast<Protocol::MessageType>(header.type);
+            if (type == Protocol::MessageType::Health)
+            {
+                Protocol::PayloadWriter writer;
+                writer.write(uint8_t(1));
+                respond(*connection, type, header.requestId, writer.data());
+            }
+            else if (type == Protocol::MessageType::Stats)
+            {
+                Protocol::PayloadWriter writer;
+                stats().encode(writer);
+                respond(*connection, type, header.requestId, writer.data());
+            }
+            else if (type == Protocol::MessageType::Search || type == Protocol::MessageType::Neighbors)
+            {
+                try
+                {
+                    Protocol::PayloadReader reader(payload.data(), payload.size());
+                    Job job{connection, header.requestId, Protocol::SearchRequest::decode(reader), 0, std::chrono::steady_clock::now(), type};
+                    job.rows = queryRows(job.request);
+                    enqueue(std::move(job));
+                }
+                catch (const std::exception &e)
+                {
+                    respondError(*connection, header.requestId, e.what());
+                }
+            }
+            else
+            {
+                respondError(*connection, header.requestId, "Unknown message type " + std::to_string(header.type));
+            }
+        }
+        --activeConnections;
+        connection->done = true;
+    }
+
+    /**
+     * @brief Queues a search in the queue of its class, refusing it if that queue is full.
+     */
+    void enqueue(Job job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            bool bulk = job.request.priority == Protocol::Priority::Bulk;
+            std::deque<Job> &target = bulk ? bulkQueue : queue;
+            if (target.size() < (bulk ? options.maxBulkQueue : options.maxQueue))
+            {
+                target.push_back(std::move(job));
+                queueReady.notify_one();
+                return;
+            }
+        }
+        ++rejected;
+        respondError(*job.connection, job.requestId, "Server busy");
+    }
+
+    /**
+     * @brief Runs interactive batches and bulk chunks until the server stops.
+     */
+    void workerLoop()
+    {
+        Work work;
+        while (nextWork(work))
+        {
+            auto start = std::chrono::steady_clock::now();
+            bool requeue = false;
+            if (!work.bulk)
+                runBatch(work.batch);
+            else if (!work.task)
+                requeue = (work.task = startBulk(work.batch)) != nullptr && runChunk(*work.task);
+            else
+                requeue = runChunk(*work.task);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard<std::mutex> lock(queueMutex);
+            busyMs[work.bulk] += ms;
+            if (work.contended)
+                contendedMs[work.bulk] += ms;
+            if (work.bulk)
+            {
+                --runningBulk;
+                if (requeue)
+                    bulkTasks.push_back(std::move(work.task));
+                else
+                    --startedBulk;
+                queueReady.notify_one();
+            }
+        }
+    }
+
+    /**
+     * @brief Returns true if a worker may run bulk work now. Requires queueMutex.
+     */
+    bool bulkReady() const
+    {
+        return runningBulk < maxBulkWorkers() && (!bulkTasks.empty() || (!bulkQueue.empty() && startedBulk < maxBulkWorkers()));
+    }
+
+    /**
+     * @brief Returns the number of workers that may run bulk chunks at once.
+     */
+    size_t maxBulkWorkers() const
+    {
+        if (options.maxBulkWorkers != 0)
+            return options.maxBulkWorkers;
+        return std::max<size_t>(workers.size(), 2) - 1;
+    }
+
+    /**
+     * @brief Waits for work and picks it: interactive searches first, unless bulk is owed its share.
+     *
+     * @return bool False once the server stops.
+     */
+    bool nextWork(Work &work)
+    {
+        work.batch.clear();
+        work.task.reset();
+
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueReady.wait(lock, [this]
+                        { return !running || !queue.empty() || bulkReady(); });
+        if (!running)
+            return false;
+
+        bool interactive = !queue.empty();
+        bool bulk = bulkReady();
+        work.contended = interactive && bulk;
+        work.bulk = bulk && (!interactive || contendedMs[1] < options.bulkShare * (contendedMs[0] + contendedMs[1]));
+        if (!work.bulk)
+            return takeBatch(lock, work.batch);
+
+        ++runningBulk;
+        if (!bulkTasks.empty())
+        {
+            work.task = std::move(bulkTasks.front());
+            bulkTasks.pop_front();
+            return true;
+        }
+
+        // Start a new task with the bulk searches that fit in one batch
+        ++startedBulk;
+        size_t rows = 0;
+        while (!bulkQueue.empty() && (work.batch.empty() || rows + bulkQueue.front().rows <= options.maxBatchRows))
+        {
+            rows += bulkQueue.front().rows;
+            work.batch.push_back(std::move(bulkQueue.front()));
+            bulkQueue.pop_front();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Takes a batch of interactive searches. Requires queueMutex, held by lock.
+     *
+     * The first queued search is always taken, then following ones while their minutiae fit in
+     * maxBatchRows. If the batch is not full, waits up to maxBatchWait for more searches.
+     *
+     * @return bool False once the server stops.
+     */
+    bool takeBatch(std::unique_lock<std::mutex> &lock, std::vector<Job> &batch)
+    {
+        auto deadline = std::chrono::steady_clock::now() + options.maxBatchWait;
+        size_t rows = 0;
+        while (running)
+        {
+            while (!queue.empty() && (batch.empty() || rows + queue.front().rows <= options.maxBatchRows))
+            {
+                rows += queue.front().rows;
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            if (rows >= options.maxBatchRows || !queue.empty())
+                return true; // Full, or the next search does not fit
+
+            if (!queueReady.wait_until(lock, deadline, [this]
+                                       { return !running || !queue.empty(); }))
+                return true; // Waited long enough
+        }
+        return false;
+    }
+
+    /**
+     * @brief Parses the queries of a batch, answering the requests that fail with an Error.
+     *
+     * @return std::vector<Job *> The accepted searches; ends receives the end of the queries of each one.
+     */
+    std::vector<Job *> parseBatch(std::vector<Job> &batch, std::vector<feature> &queries, std::vector<size_t> &ks, std::vector<size_t> &ends)
+    {
+        std::vector<Job *> accepted;
+        for (auto &job : batch)
+        {
+            try
+            {
+                std::vector<feature> parsed = parseQueries(job.request);
+                queries.insert(queries.end(), std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+                ks.insert(ks.end(), parsed.size(), job.request.k);
+                ends.push_back(queries.size());
+                accepted.push_back(&job);
+            }
+            catch (const std::exception &e)
+            {
+                respondError(*job.connection, job.requestId, e.what());
+            }
+        }
+        return accepted;
+    }
+
+    /**
+     * @brief Searches the minutiae of an interactive batch in one gallery pass and answers each search.
+     */
+    void runBatch(std::vector<Job> &batch)
+    {
+        // Requests that fail to parse are answered alone, the others are searched together
+        std::vector<feature> queries;
+        std::vector<size_t> ks;
+        std::vector<size_t> ends;
+        std::vector<Job *> accepted = parseBatch(batch, queries, ks, ends);
+        if (accepted.empty())
+            return;
+
+        ++batches;
+        batchedRequests += accepted.size();
+        batchedRows += queries.size();
+
+        EpochManager::Guard guard(EpochManager::global());
+        std::vector<NNList<feature>> lists;
+        try
+        {
+            lists = searcher.knnBatch(queries, ks, SearchFilter());
+        }
+        catch (const std::exception &e)
+        {
+            for (Job *job : accepted)
+            {
+                respondError(*job->connection, job->requestId, e.what());
+            }
+            return;
+        }
+        answer(accepted, ends, lists, interactiveLatencies);
+    }
+
+    /**
+     * @brief Prepares the gallery pass of bulk searches.
+     *
+     * @return std::shared_ptr<BulkTask> The task, or nullptr if no search was accepted.
+     */
+    std::shared_ptr<BulkTask> startBulk(std::vector<Job> &batch)
+    {
+        std::vector<feature> queries;
+        std::vector<size_t> ks;
+        std::vector<size_t> ends;
+        std::vector<Job *> accepted = parseBatch(batch, queries, ks, ends);
+        if (accepted.empty())
+            return nullptr;
+
+        auto task = std::make_shared<BulkTask>();
+        for (Job *job : accepted)
+        {
+            task->jobs.push_back(std::move(*job));
+        }
+        task->ends = std::move(ends);
+        task->chunkObjects = std::max<size_t>(options.bulkChunkDistances / std::max<size_t>(queries.size(), 1), 1);
+        task->scan.reset(new typename Searcher::BatchScan(searcher, std::move(queries), ks));
+        return task;
+    }
+
+    /**
+     * @brief Scans the next chunk of a bulk task, answering its searches once the scan is complete.
+     *
+     * @return bool True if the task has chunks left.
+     */
+    bool runChunk(BulkTask &task)
+    {
+        ++bulkChunks;
+        if (!task.scan->advance(task.chunkObjects))
+            return true;
+
+        std::vector<Job *> jobs;
+        for (auto &job : task.jobs)
+        {
+            jobs.push_back(&job);
+        }
+        answer(jobs, task.ends, task.scan->results(), bulkLatencies);
+        return false;
+    }
+
+    /**
+     * @brief Ranks and sends the result of each search of a batch.
+     *
+     * @param jobs The searches, in the order of their lists.
+     * @param ends The end of the lists of each search.
+     * @param lists The neighbors of every query minutia of the batch.
+     * @param latencies Records the latency of the class of the searches.
+     */
+    void answer(const std::vector<Job *> &jobs, const std::vector<size_t> &ends, const std::vector<NNList<feature>> &lists, LatencyRecorder &latencies)
+    {
+        size_t begin = 0;
+        for (size_t j = 0; j < jobs.size(); ++j)
+        {
+            Job &job = *jobs[j];
+            try
+            {
+                Protocol::PayloadWriter writer;
+                if (job.type == Protocol::MessageType::Neighbors)
+                    neighborLists(lists.begin() + begin, lists.begin() + ends[j]).encode(writer);
+                else
+                    Protocol::encodeCandidates(writer, rank(job.request, lists.begin() + begin, lists.begin() + ends[j]));
+                latencies.record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job.arrival).count());
+                respond(*job.connection, job.type, job.requestId, writer.data());
+            }
+            catch (const std::exception &e)
+            {
+                respondError(*job.connection, job.requestId, e.what());
+            }
+            begin = ends[j];
+        }
+    }
+
+    /**
+     * @brief Fills the latency counters of a class.
+     */
+    static void classStats(const LatencyRecorder &latencies, Protocol::ClassStats &stats)
+    {
+        stats.searches = latencies.count();
+        stats.meanLatencyMs = latencies.mean();
+        stats.p50LatencyMs = latencies.percentile(0.50);
+        stats.p99LatencyMs = latencies.percentile(0.99);
+        stats.maxLatencyMs = latencies.max();
+    }
+
+    /**
+     * @brief Validates a request and returns its query minutiae.
+     *
+     * @throws std::runtime_error if the request is out of the server limits or malformed.
+     */
+    std::vector<feature> parseQueries(const Protocol::SearchRequest &request) const
+    {
+        if (request.k == 0 || request.k > options.maxK || request.nBest == 0 || request.nBest > options.maxBest)
+            throw std::runtime_error("k or nBest out of range");
+        Protocol::methodName(request.method); // Throws on an unknown method
+
+        std::vector<feature> queries;
+        if (request.format == Protocol::QueryFormat::Tpt)
+        {
+            std::istringstream stream(request.tpt);
+            queries = parseTpt<feature>(stream);
+        }
+        else
+        {
+            if (request.dimension == 0 || (options.dimension != 0 && request.dimension != options.dimension))
+                throw std::runtime_error("Query dimension " + std::to_string(request.dimension) + " does not match the gallery (" + std::to_string(options.dimension) + ")");
+            if (request.values.size() != static_cast<size_t>(request.rows) * request.dimension)
+                throw std::runtime_error("Query matrix holds " + std::to_string(request.values.size()) + " values, not rows x dimension");
+            queries.reserve(request.rows);
+            for (uint32_t r = 0; r < request.rows; ++r)
+            {
+                auto row = request.values.begin() + static_cast<size_t>(r) * request.dimension;
+                queries.emplace_back(std::vector<float>(row, row + request.dimension));
+            }
+        }
+
+        for (const auto &query : queries)
+        {
+            if (options.dimension != 0 && query.size() != options.dimension)
+                throw std::runtime_error("Query dimension " + std::to_string(query.size()) + " does not match the gallery (" + std::to_string(options.dimension) + ")");
+        }
+        return queries;
+    }
+
+    /**
+     * @brief Votes over the neighbor lists of one search and names the best Individuals.
+     */
+    template <typename It>
+    std::vector<Protocol::Candidate> rank(const Protocol::SearchRequest &request, It first, It last) const
+    {
+        DynamicNNResult<feature> votes(Protocol::methodName(request.method));
+        for (It it = first; it != last; ++it)
+        {
+            votes.add(*it);
+        }
+
+        std::vector<Protocol::Candidate> candidates;
+        for (const auto &best : votes.pickBest(request.nBest))
+        {
+            auto individual = gallery.getIndividual(best.first);
+            candidates.push_back({best.first, best.second, individual ? individual->name : std::string()});
+        }
+        return candidates;
+    }
+
+    /**
+     * @brief Converts the neighbor lists of one search for a Neighbors response, naming their Individuals.
+     */
+    template <typename It>
+    Protocol::NeighborLists neighborLists(It first, It last) const
+    {
+        Protocol::NeighborLists result;
+        std::unordered_map<uint32_t, std::string> names;
+        for (It it = first; it != last; ++it)
+        {
+            std::vector<Protocol::Neighbor> row;
+            for (const auto &entry : *it)
+            {
+                uint32_t id = representativeId(entry.element);
+                row.push_back({id, entry.distance});
+                if (names.count(id) == 0)
+                {
+                    auto individual = gallery.getIndividual(id);
+                    names[id] = individual ? individual->name : std::string();
+                }
+            }
+            result.rows.push_back(std::move(row));
+        }
+        result.names.assign(names.begin(), names.end());
+        return result;
+    }
+
+    /**
+     * @brief Returns the number of query minutiae of a request, counting the lines of a .tpt.
+     */
+    static size_t queryRows(const Protocol::SearchRequest &request)
+    {
+        if (request.format != Protocol::QueryFormat::Tpt)
+            return request.rows;
+        size_t lines = static_cast<size_t>(std::count(request.tpt.begin(), request.tpt.end(), '\n'));
+        return lines > 2 ? lines - 2 : 1; // Two header lines
+    }
+
+    /**
+     * @brief Sends a response on a connection.
+     */
+    void respond(Connection &connection, Protocol::MessageType type, uint32_t requestId, const std::vector<char> &payload)
+    {
+        std::lock_guard<std::mutex> lock(connection.writeMutex);
+        sendMessage(connection.socket, type, requestId, payload);
+    }
+
+    /**
+     * @brief Sends an Error response.
+     */
+    void respondError(Connection &connection, uint32_t requestId, const std::string &message)
+    {
+        ++errors;
+        Protocol::PayloadWriter writer;
+        writer.writeString(message);
+        respond(connection, Protocol::MessageType::Error, requestId, writer.data());
+    }
+
+    const Gallery<feature> &gallery; ///< Names and sizes
+    const Searcher &searcher;        ///< Answers the queries
+    ServerOptions options;           ///< Settings
+
+    std::atomic<bool> running;                          ///< False once stop() starts
+    Socket listener;                                    ///< Listening socket
+    std::thread acceptor;                               ///< Runs acceptLoop
+    std::vector<std::thread> workers;                   ///< Run workerLoop
+    std::list<std::shared_ptr<Connection>> connections; ///< Open connections
+    std::mutex connectionMutex;                         ///< Guards connections
+
+    std::deque<Job> queue;                           ///< Interactive searches waiting for a worker
+    std::deque<Job> bulkQueue;                       ///< Bulk searches not started yet
+    std::deque<std::shared_ptr<BulkTask>> bulkTasks; ///< Started bulk tasks waiting for their next chunk
+    size_t startedBulk = 0;                          ///< Started bulk tasks, waiting or running
+    size_t runningBulk = 0;                          ///< Workers running bulk work
+    double busyMs[2] = {0, 0};                       ///< Worker time per class (interactive, bulk)
+    double contendedMs[2] = {0, 0};                  ///< Worker time per class picked while both classes had work
+    mutable std::mutex queueMutex;                   ///< Guards the queues, tasks and times above
+    std::condition_variable queueReady;              ///< Signals queued work and stop
+
+    std::chrono::steady_clock::time_point startTime; ///< When start() ran
+    LatencyRecorder interactiveLatencies;            ///< Latency of every answered interactive search
+    LatencyRecorder bulkLatencies;                   ///< Latency of every answered bulk search
+    std::atomic<uint64_t> errors{0};                 ///< Error responses
+    std::atomic<uint64_t> rejected{0};               ///< Searches refused by a full queue
+    std::atomic<uint64_t> activeConnections{0};      ///< Open connections
+    std::atomic<uint64_t> batches{0};                ///< Interactive batches searched
+    std::atomic<uint64_t> batchedRequests{0};        ///< Searches over all interactive batches
+    std::atomic<uint64_t> batchedRows{0};            ///< Query minutiae over all interactive batches
+    std::atomic<uint64_t> bulkChunks{0};             ///< Bulk chunks scanned
+};
+
+#endif // SEARCH_SERVER_HPP
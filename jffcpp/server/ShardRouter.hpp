@@ -0,0 +1,348 @@
+#ifndef SHARD_ROUTER_HPP
+#define SHARD_ROUTER_HPP
+
+#include <vector>
+#include <string>
+#include <memory>        // For std::unique_ptr
+#include <thread>        // For std::thread
+#include <chrono>        // For std::chrono::steady_clock
+#include <algorithm>     // For std::partial_sort, std::none_of
+#include <unordered_map> // For std::unordered_map
+#include <stdexcept>     // For std::runtime_error
+#include "Protocol.hpp"
+#include "Socket.hpp"
+#include "../data/Gallery.hpp"
+#include "../indexing/NNResults.hpp"
+
+/**
+ * @brief Address of one shard server: a Unix domain socket path or a TCP host and port.
+ */
+struct ShardEndpoint
+{
+    std::string host;  ///< IPv4 address (empty for a Unix socket)
+    uint16_t port = 0; ///< TCP port
+    std::string path;  ///< Unix socket path (empty for TCP)
+
+    static ShardEndpoint tcp(const std::string &host, uint16_t port)
+    {
+        ShardEndpoint endpoint;
+        endpoint.host = host;
+        endpoint.port = port;
+        return endpoint;
+    }
+
+    static ShardEndpoint unixSocket(const std::string &path)
+    {
+        ShardEndpoint endpoint;
+        endpoint.path = path;
+        return endpoint;
+    }
+
+    std::string toString() const
+    {
+        return path.empty() ? host + ":" + std::to_string(port) : path;
+    }
+};
+
+/**
+ * @brief Outcome of one shard for a routed search.
+ */
+struct ShardStatus
+{
+    bool ok = false;      ///< The shard answered in time
+    std::string error;    ///< Why it did not (timeout, connection or server error)
+    double latencyMs = 0; ///< Time until its last response, or until it failed
+};
+
+/**
+ * @brief Result of a search routed to every shard.
+ */
+struct ShardedResult
+{
+    std::vector<Protocol::Candidate> candidates; ///< The best Individuals over the shards that answered, best first
+    bool partial = false;                        ///< At least one shard did not answer: candidates miss its Individuals
+    std::vector<ShardStatus> shards;             ///< Outcome of each shard, in endpoint order
+};
+
+/**
+ * @brief Scatter-gather client of a gallery split across several SearchServer shards.
+ *
+ * Every shard serves a disjoint part of the Individuals (see splitGallery). A batch of searches is
+ * sent to all shards at once, one thread per shard, as pipelined Neighbors requests on a
+ * persistent connection; each shard answers with the k nearest neighbors of every query minutia
+ * within its part. The router keeps, per query minutia, the k nearest over all shards, which is
+ * exactly the list a single server holding the whole gallery would find, and votes on it like
+ * NNResult. Individual IDs must therefore be unique across the shards.
+ *
+ * A shard that does not answer before the timeout, refuses the connection or returns an error is
+ * left out: the result is built from the other shards and flagged partial, with the reason in its
+ * ShardStatus. The connection of a failed shard is dropped and opened again by the next search, so
+ * a restarted shard rejoins on its own.
+ *
+ * A router is not thread-safe; use one per thread.
+ */
+class ShardRouter
+{
+public:
+    /**
+     * @brief Constructs a router; connections are opened by the first search.
+     *
+     * @param endpoints The shard servers.
+     * @param timeout Time given to every shard to answer a search or a batch.
+     */
+    explicit ShardRouter(std::vector<ShardEndpoint> endpoints, std::chrono::milliseconds timeout = std::chrono::milliseconds(2000))
+        : endpoints(std::move(endpoints)), connections(this->endpoints.size()), timeout(timeout), nextRequestId(1)
+    {
+        if (this->endpoints.empty())
+            throw std::invalid_argument("A ShardRouter needs at least one shard");
+    }
+
+    /**
+     * @brief Sets the time given to every shard to answer.
+     */
+    void setTimeout(std::chrono::milliseconds milliseconds)
+    {
+        timeout = milliseconds;
+    }
+
+    size_t numShards() const
+    {
+        return endpoints.size();
+    }
+
+    /**
+     * @brief Returns the shard holding an Individual under splitGallery.
+     */
+    static size_t shardOf(uint32_t individualId, size_t nShards)
+    {
+        return individualId % nShards;
+    }
+
+    /**
+     * @brief Searches every shard and merges their answers.
+     *
+     * @throws std::runtime_error if no shard answered.
+     */
+    ShardedResult search(const Protocol::SearchRequest &request)
+    {
+        return std::move(searchBatch({request})[0]);
+    }
+
+    /**
+     * @brief Searches a batch on every shard at once and merges the answers of each search.
+     *
+     * @return std::vector<ShardedResult> One result per request, in order.
+     * @throws std::runtime_error if no shard answered.
+     */
+    std::vector<ShardedResult> searchBatch(const std::vector<Protocol::SearchRequest> &requests)
+    {
+        if (requests.empty())
+            return {};
+
+        std::vector<std::vector<char>> payloads(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i)
+        {
+            Protocol::PayloadWriter writer;
+            requests[i].encode(writer);
+            payloads[i] = writer.data();
+        }
+        uint32_t firstId = nextRequestId;
+        nextRequestId += static_cast<uint32_t>(requests.size());
+
+        // Scatter: every shard works on the whole batch in its own thread
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        std::vector<std::vector<Protocol::NeighborLists>> answers(endpoints.size());
+        std::vector<ShardStatus> statuses(endpoints.size());
+        std::vector<std::thread> threads;
+        for (size_t s = 0; s < endpoints.size(); ++s)
+        {
+            threads.emplace_back([&, s]
+                                 { statuses[s] = queryShard(s, payloads, firstId, deadline, answers[s]); });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        bool partial = false;
+        std::string firstError;
+        for (size_t s = 0; s < endpoints.size(); ++s)
+        {
+            if (!statuses[s].ok)
+            {
+                partial = true;
+                if (firstError.empty())
+                    firstError = endpoints[s].toString() + ": " + statuses[s].error;
+            }
+        }
+        if (std::none_of(statuses.begin(), statuses.end(), [](const ShardStatus &status)
+                         { return status.ok; }))
+            throw std::runtime_error("No shard answered (" + firstError + ")");
+
+        // Gather
+        std::vector<ShardedResult> results(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i)
+        {
+            results[i].candidates = merge(requests[i], answers, statuses, i);
+            results[i].partial = partial;
+            results[i].shards = statuses;
+        }
+        return results;
+    }
+
+private:
+    /**
+     * @brief Sends the batch to one shard and reads its answers, all before the deadline.
+     */
+    ShardStatus queryShard(size_t s, const std::vector<std::vector<char>> &payloads, uint32_t firstId,
+                           std::chrono::steady_clock::time_point deadline, std::vector<Protocol::NeighborLists> &answers)
+    {
+        auto start = std::chrono::steady_clock::now();
+        ShardStatus status;
+        Socket &socket = connections[s];
+        try
+        {
+            if (!socket.valid())
+            {
+                const ShardEndpoint &endpoint = endpoints[s];
+                socket = endpoint.path.empty() ? Socket::connectTcp(endpoint.host, endpoint.port, std::max(1, remainingMs(deadline)))
+                                               : Socket::connectUnix(endpoint.path);
+            }
+
+            for (size_t i = 0; i < payloads.size(); ++i)
+            {
+                socket.setTimeout(std::max(1, remainingMs(deadline))); // 0 would wait forever
+                if (!sendMessage(socket, Protocol::MessageType::Neighbors, firstId + static_cast<uint32_t>(i), payloads[i]))
+                    throw std::runtime_error("Connection lost");
+            }
+
+            // Responses of one connection may come back in any order
+            answers.assign(payloads.size(), Protocol::NeighborLists());
+            for (size_t received = 0; received < payloads.size(); ++received)
+            {
+                int remaining = remainingMs(deadline);
+                if (remaining <= 0)
+                    throw std::runtime_error("Timed out");
+                socket.setTimeout(remaining);
+
+                Protocol::Header header;
+                std::vector<char> response;
+                if (!receiveMessage(socket, header, response))
+                    throw std::runtime_error(std::chrono::steady_clock::now() >= deadline ? "Timed out" : "Connection lost");
+                if (header.requestId < firstId || header.requestId - firstId >= payloads.size())
+                    throw std::runtime_error("Response does not match the request");
+
+                Protocol::PayloadReader reader(response.data(), response.size());
+                if (header.type == static_cast<uint16_t>(Protocol::MessageType::Error))
+                    throw std::runtime_error("Search server error: " + reader.readString());
+                answers[header.requestId - firstId] = Protocol::NeighborLists::decode(reader);
+            }
+            status.ok = true;
+        }
+        catch (const std::exception &e)
+        {
+            // Late answers would be taken for the next batch: start over on a new connection
+            socket.close();
+            answers.clear();
+            status.error = e.what();
+        }
+        status.latencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return status;
+    }
+
+    /**
+     * @brief Returns the milliseconds left before the deadline, rounded up.
+     */
+    static int remainingMs(std::chrono::steady_clock::time_point deadline)
+    {
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        return static_cast<int>(std::max<std::chrono::milliseconds::rep>(left.count(), 0));
+    }
+
+    /**
+     * @brief Keeps the k nearest neighbors of every query minutia over the shards and votes on them.
+     */
+    static std::vector<Protocol::Candidate> merge(const Protocol::SearchRequest &request, const std::vector<std::vector<Protocol::NeighborLists>> &answers,
+                                                  const std::vector<ShardStatus> &statuses, size_t i)
+    {
+        size_t rows = 0;
+        std::unordered_map<uint32_t, std::string> names;
+        for (size_t s = 0; s < answers.size(); ++s)
+        {
+            if (!statuses[s].ok)
+                continue;
+            rows = std::max(rows, answers[s][i].rows.size());
+            names.insert(answers[s][i].names.begin(), answers[s][i].names.end());
+        }
+
+        DynamicNNResult<ParentedFeature> votes(Protocol::methodName(request.method));
+        std::vector<Protocol::Neighbor> row;
+        for (size_t r = 0; r < rows; ++r)
+        {
+            row.clear();
+            for (size_t s = 0; s < answers.size(); ++s)
+            {
+                if (statuses[s].ok && r < answers[s][i].rows.size())
+                    row.insert(row.end(), answers[s][i].rows[r].begin(), answers[s][i].rows[r].end());
+            }
+
+            size_t k = std::min<size_t>(request.k, row.size());
+            std::partial_sort(row.begin(), row.begin() + k, row.end(), [](const Protocol::Neighbor &a, const Protocol::Neighbor &b)
+                              { return a.distance < b.distance || (a.distance == b.distance && a.id < b.id); });
+            for (size_t rank = 0; rank < k; ++rank)
+            {
+                votes.add(row[rank].id, row[rank].distance, rank);
+            }
+        }
+
+        std::vector<Protocol::Candidate> candidates;
+        for (const auto &best : votes.pickBest(request.nBest))
+        {
+            auto it = names.find(best.first);
+            candidates.push_back({best.first, best.second, it == names.end() ? std::string() : it->second});
+        }
+        return candidates;
+    }
+
+    std::vector<ShardEndpoint> endpoints; ///< Shard servers
+    std::vector<Socket> connections;      ///< Open connection to each shard (invalid until needed or after a failure)
+    std::chrono::milliseconds timeout;    ///< Time given to every shard per batch
+    uint32_t nextRequestId;               ///< ID of the next request
+};
+
+/**
+ * @brief Splits a gallery into nShards galleries for shard servers, Individual i going to shard i % nShards.
+ *
+ * Only live Individuals are kept. The shards share the Individuals of the source gallery, so their
+ * IDs are preserved and unique across the shards, as ShardRouter requires; each shard is
+ * typically saved with its own searcher and served by its own process.
+ */
+template <typename F>
+std::vector<std::unique_ptr<Gallery<F>>> splitGallery(const Gallery<F> &gallery, size_t nShards)
+{
+    if (nShards == 0)
+        throw std::invalid_argument("nShards must be positive");
+
+    std::vector<std::vector<typename Gallery<F>::IndividualPtr>> individuals(nShards);
+    for (const auto &individual : gallery.getIndividuals())
+    {
+        if (!individual->isRetired())
+            individuals[ShardRouter::shardOf(individual->getId(), nShards)].push_back(individual);
+    }
+
+    std::vector<std::vector<F>> features(nShards);
+    for (const auto &f : gallery.getFeatures())
+    {
+        if (f.representative != nullptr && !f.representative->isRetired())
+            features[ShardRouter::shardOf(f.representative->getId(), nShards)].push_back(f);
+    }
+
+    std::vector<std::unique_ptr<Gallery<F>>> shards;
+    for (size_t s = 0; s < nShards; ++s)
+    {
+        shards.push_back(std::make_unique<Gallery<F>>(std::move(individuals[s]), std::move(features[s]), gallery.getPartitionNames()));
+    }
+    return shards;
+}
+
+#endif // SHARD_ROUTER_HPP
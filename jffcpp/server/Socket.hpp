@@ -0,0 +1,378 @@
+#ifndef SOCKET_HPP
+#define SOCKET_HPP
+
+#include <string>
+#include <vector>
+#include <stdexcept> // For std::runtime_error
+#include <cstring>   // For std::memset, std::strncpy
+#include <cerrno>    // For errno, EINTR, EINPROGRESS
+#include "Protocol.hpp"
+
+#ifndef _WIN32
+#include <sys/socket.h>  // For socket, bind, listen, accept, send, recv
+#include <sys/un.h>      // For sockaddr_un
+#include <netinet/in.h>  // For sockaddr_in
+#include <netinet/tcp.h> // For TCP_NODELAY
+#include <arpa/inet.h>   // For inet_pton
+#include <sys/time.h>    // For timeval
+#include <unistd.h>      // For close, unlink
+#include <fcntl.h>       // For fcntl, O_NONBLOCK
+#include <poll.h>        // For poll
+#endif
+
+/**
+ * @brief Owning handle of a stream socket (Unix domain or TCP).
+ *
+ * Only POSIX sockets are implemented; on Windows every factory throws, and the server and client
+ * cannot be used (the rest of the library is unaffected).
+ */
+class Socket
+{
+public:
+    Socket() : fd(-1) {}
+
+    explicit Socket(int fd) : fd(fd) {}
+
+    Socket(Socket &&other) noexcept : fd(other.fd)
+    {
+        other.fd = -1;
+    }
+
+    Socket &operator=(Socket &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            fd = other.fd;
+            other.fd = -1;
+        }
+        return *this;
+    }
+
+    Socket(const Socket &) = delete;
+    Socket &operator=(const Socket &) = delete;
+
+    ~Socket()
+    {
+        close();
+    }
+
+    /**
+     * @brief Listens on a Unix domain socket, replacing a stale socket file at the same path.
+     */
+    static Socket listenUnix(const std::string &path, int backlog = 64)
+    {
+#ifndef _WIN32
+        sockaddr_un address;
+        unixAddress(path, address);
+        Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (!socket.valid())
+            throw std::runtime_error("Could not create a Unix socket");
+        ::unlink(path.c_str());
+        if (::bind(socket.fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(socket.fd, backlog) != 0)
+            throw std::runtime_error("Could not listen on " + path + ": " + std::strerror(errno));
+        return socket;
+#else
+        (void)path;
+        (void)backlog;
+        throw std::runtime_error("Sockets are only implemented on POSIX systems");
+#endif
+    }
+
+    /**
+     * @brief Listens on a TCP port (localhost by default). Port 0 picks a free port, see localPort().
+     */
+    static Socket listenTcp(uint16_t port, const std::string &host = "127.0.0.1", int backlog = 64)
+    {
+#ifndef _WIN32
+        sockaddr_in address = tcpAddress(host, port);
+        Socket socket(::socket(AF_INET, SOCK_STREAM, 0));
+        if (!socket.valid())
+            throw std::runtime_error("Could not create a TCP socket");
+        int yes = 1;
+        ::setsockopt(socket.fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (::bind(socket.fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(socket.fd, backlog) != 0)
+            throw std::runtime_error("Could not listen on " + host + ":" + std::to_string(port) + ": " + std::strerror(errno));
+        return socket;
+#else
+        (void)port;
+        (void)host;
+        (void)backlog;
+        throw std::runtime_error("Sockets are only implemented on POSIX systems");
+#endif
+    }
+
+    /**
+     * @brief Connects to a Unix domain socket.
+     */
+    static Socket connectUnix(const std::string &path)
+    {
+#ifndef _WIN32
+        sockaddr_un address;
+        unixAddress(path, address);
+        Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (!socket.valid() || ::connect(socket.fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+            throw std::runtime_error("Could not connect to " + path + ": " + std::strerror(errno));
+        return socket;
+#else
+        (void)path;
+        throw std::runtime_error("Sockets are only implemented on POSIX systems");
+#endif
+    }
+
+    /**
+     * @brief Connects to a TCP server, giving up after timeoutMs milliseconds (0 waits as long as the system does).
+     */
+    static Socket connectTcp(const std::string &host, uint16_t port, int timeoutMs = 0)
+    {
+#ifndef _WIN32
+        sockaddr_in address = tcpAddress(host, port);
+        Socket socket(::socket(AF_INET, SOCK_STREAM, 0));
+        if (!socket.valid())
+            throw std::runtime_error("Could not create a TCP socket");
+
+        std::string target = host + ":" + std::to_string(port);
+        if (timeoutMs <= 0)
+        {
+            if (::connect(socket.fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+                throw std::runtime_error("Could not connect to " + target + ": " + std::strerror(errno));
+        }
+        else
+        {
+            // Non-blocking connect, so that an unreachable host fails after the timeout
+            int flags = ::fcntl(socket.fd, F_GETFL, 0);
+            ::fcntl(socket.fd, F_SETFL, flags | O_NONBLOCK);
+            if (::connect(socket.fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+            {
+                if (errno != EINPROGRESS)
+                    throw std::runtime_error("Could not connect to " + target + ": " + std::strerror(errno));
+
+                pollfd request{socket.fd, POLLOUT, 0};
+                int ready = ::poll(&request, 1, timeoutMs);
+                int error = 0;
+                socklen_t length = sizeof(error);
+                if (ready == 0)
+                    throw std::runtime_error("Timed out connecting to " + target);
+                if (ready < 0 || ::getsockopt(socket.fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0)
+                    throw std::runtime_error("Could not connect to " + target + ": " + std::strerror(error != 0 ? error : errno));
+            }
+            ::fcntl(socket.fd, F_SETFL, flags);
+        }
+        socket.setNoDelay();
+        return socket;
+#else
+        (void)host;
+        (void)port;
+        (void)timeoutMs;
+        throw std::runtime_error("Sockets are only implemented on POSIX systems");
+#endif
+    }
+
+    /**
+     * @brief Waits for a connection; returns an invalid socket once the listener is shut down.
+     */
+    Socket accept() const
+    {
+#ifndef _WIN32
+        while (true)
+        {
+            int client = ::accept(fd, nullptr, nullptr);
+            if (client >= 0)
+            {
+                Socket socket(client);
+                socket.setNoDelay();
+                return socket;
+            }
+            if (errno != EINTR)
+                return Socket();
+        }
+#else
+        return Socket();
+#endif
+    }
+
+    /**
+     * @brief Returns the port a TCP listener is bound to (0 for other sockets).
+     */
+    uint16_t localPort() const
+    {
+#ifndef _WIN32
+        sockaddr_in address;
+        socklen_t length = sizeof(address);
+        if (::getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) == 0 && address.sin_family == AF_INET)
+            return ntohs(address.sin_port);
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Sends all bytes; returns false if the peer is gone.
+     */
+    bool sendAll(const void *data, size_t size) const
+    {
+#ifndef _WIN32
+        const char *p = static_cast<const char *>(data);
+        while (size > 0)
+        {
+            ssize_t sent = ::send(fd, p, size, sendFlags);
+            if (sent < 0 && errno == EINTR)
+                continue;
+            if (sent <= 0)
+                return false;
+            p += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+#else
+        (void)data;
+        return size == 0;
+#endif
+    }
+
+    /**
+     * @brief Receives exactly size bytes; returns false on end of stream, error or timeout.
+     */
+    bool recvAll(void *data, size_t size) const
+    {
+#ifndef _WIN32
+        char *p = static_cast<char *>(data);
+        while (size > 0)
+        {
+            ssize_t received = ::recv(fd, p, size, 0);
+            if (received < 0 && errno == EINTR)
+                continue;
+            if (received <= 0)
+                return false;
+            p += received;
+            size -= static_cast<size_t>(received);
+        }
+        return true;
+#else
+        (void)data;
+        return size == 0;
+#endif
+    }
+
+    /**
+     * @brief Sets send and receive timeouts (0 disables them).
+     */
+    void setTimeout(int milliseconds) const
+    {
+#ifndef _WIN32
+        timeval timeout;
+        timeout.tv_sec = milliseconds / 1000;
+        timeout.tv_usec = (milliseconds % 1000) * 1000;
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#else
+        (void)milliseconds;
+#endif
+    }
+
+    /**
+     * @brief Shuts both directions down, waking up threads blocked on the socket.
+     */
+    void shutdown() const
+    {
+#ifndef _WIN32
+        if (fd >= 0)
+            ::shutdown(fd, SHUT_RDWR);
+#endif
+    }
+
+    /**
+     * @brief Closes the socket.
+     */
+    void close()
+    {
+#ifndef _WIN32
+        if (fd >= 0)
+            ::close(fd);
+#endif
+        fd = -1;
+    }
+
+    bool valid() const
+    {
+        return fd >= 0;
+    }
+
+private:
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+    static constexpr int sendFlags = MSG_NOSIGNAL; ///< A closed peer returns an error instead of raising SIGPIPE
+#else
+    static constexpr int sendFlags = 0;
+#endif
+
+    static void unixAddress(const std::string &path, sockaddr_un &address)
+    {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("Socket path too long: " + path);
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    }
+
+    static sockaddr_in tcpAddress(const std::string &host, uint16_t port)
+    {
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        if (::inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+            throw std::runtime_error("Invalid IPv4 address: " + host);
+        return address;
+    }
+
+    void setNoDelay() const
+    {
+        int yes = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes)); // Fails harmlessly on Unix sockets
+    }
+#endif
+
+    int fd; ///< File descriptor (-1 if none)
+};
+
+/**
+ * @brief Sends one message (header and payload).
+ *
+ * @return bool False if the peer is gone.
+ */
+inline bool sendMessage(const Socket &socket, Protocol::MessageType type, uint32_t requestId, const std::vector<char> &payload)
+{
+    Protocol::Header header;
+    header.type = static_cast<uint16_t>(type);
+    header.requestId = requestId;
+    header.payloadSize = static_cast<uint32_t>(payload.size());
+
+    // One buffer, so that small messages leave in a single segment
+    std::vector<char> message;
+    message.reserve(sizeof(header) + payload.size());
+    const char *bytes = reinterpret_cast<const char *>(&header);
+    message.insert(message.end(), bytes, bytes + sizeof(header));
+    message.insert(message.end(), payload.begin(), payload.end());
+    return socket.sendAll(message.data(), message.size());
+}
+
+/**
+ * @brief Receives one message.
+ *
+ * @return bool False on end of stream, error or timeout.
+ * @throws std::runtime_error if the header is not a valid message header.
+ */
+inline bool receiveMessage(const Socket &socket, Protocol::Header &header, std::vector<char> &payload)
+{
+    if (!socket.recvAll(&header, sizeof(header)))
+        return false;
+    if (header.magic != Protocol::magic || header.version != Protocol::version)
+        throw std::runtime_error("Not a search protocol message");
+    if (header.payloadSize > Protocol::maxPayload)
+        throw std::runtime_error("Payload of " + std::to_string(header.payloadSize) + " bytes exceeds the limit");
+
+    payload.resize(header.payloadSize);
+    return socket.recvAll(payload.data(), payload.size());
+}
+
+#endif // SOCKET_HPP